@@ -0,0 +1,896 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#include <zlib.h>
+
+#include "hdfy.h"
+
+
+//
+// Function to set the default options: 64k-row chunks, shuffle and deflate
+//
+
+void hdfy_InitOpts( struct hdfyOpts_s *o )
+{
+   o->chunk = 65536;
+   o->ishuffle = 1;
+   o->ideflate = 4;
+   o->nthreads = 0;
+   o->inbit = 0;
+   o->iscaleoffset = 0;
+   o->itune = 0;
+   o->tune_rows = 131072;
+   o->tune_speed = 10.0;
+   o->batch = 262144;
+   o->depth = 2;
+   o->tile = 256;
+   o->icorners = 0;
+}
+
+double hdfy_Time( void )
+{
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return( (double) tv.tv_sec + 1.0e-6 * (double) tv.tv_usec );
+}
+
+
+//
+// Function to create (truncate) a file and mark what it holds
+//
+
+hid_t hdfy_CreateFile( const char *filename, const char *format,
+                       const char *source )
+#define FUNC "hdfy_CreateFile"
+{
+   hid_t fid;
+
+   fid = H5Fcreate( filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT );
+   if( fid < 0 ) {
+      fprintf( stderr, " e [%s]  Could not create file: \"%s\"\n",
+               FUNC, filename );
+      return -1;
+   } else {
+      fprintf( stderr, " i [%s]  Writing file: \"%s\"\n", FUNC, filename );
+   }
+
+   if( format != NULL ) hdfy_WriteAttrString( fid, "format", format );
+   if( source != NULL ) hdfy_WriteAttrString( fid, "source", source );
+
+   return fid;
+}
+#undef FUNC
+
+
+//
+// Function to add the filters of the options to a chunked layout
+//
+
+static void hdfy_SetFilters( hid_t pid, hid_t ftype,
+                             const struct hdfyOpts_s *o )
+#define FUNC "hdfy_SetFilters"
+{
+   if( o->inbit && H5Tget_class( ftype ) == H5T_INTEGER ) {
+      H5Pset_nbit( pid );
+   }
+   if( o->iscaleoffset > 0 && H5Tget_class( ftype ) == H5T_FLOAT ) {
+      H5Pset_scaleoffset( pid, H5Z_SO_FLOAT_DSCALE, o->iscaleoffset );
+   }
+   if( o->ishuffle ) H5Pset_shuffle( pid );
+   if( o->ideflate > 0 ) {
+      if( H5Zfilter_avail( H5Z_FILTER_DEFLATE ) > 0 ) {
+         H5Pset_deflate( pid, (unsigned int) o->ideflate );
+      } else {
+         fprintf( stderr, " i [%s]  Deflate is not available \n", FUNC );
+      }
+   }
+}
+#undef FUNC
+
+
+//
+// Function to create a dataset for an array with the layout and filters of
+// the options; small arrays get a single chunk, and empty ones are left
+// contiguous because a chunk cannot be empty
+//
+
+hid_t hdfy_CreateArray( hid_t loc, const char *name, hid_t ftype,
+                        hsize_t nrow, hsize_t ncol,
+                        const struct hdfyOpts_s *o )
+#define FUNC "hdfy_CreateArray"
+{
+   struct hdfyOpts_s od;
+   hsize_t dims[2],cdims[2];
+   hid_t sid,pid,did;
+   int rank = ( ncol > 0 ? 2 : 1 );
+
+   if( o == NULL ) {
+      hdfy_InitOpts( &od );
+      o = &od;
+   }
+
+   dims[0] = nrow;
+   dims[1] = ncol;
+   sid = H5Screate_simple( rank, dims, NULL );
+   if( sid < 0 ) return -1;
+
+   pid = H5Pcreate( H5P_DATASET_CREATE );
+   if( o->chunk > 0 && nrow > 0 ) {
+      cdims[0] = ( nrow < (hsize_t) o->chunk ? nrow : (hsize_t) o->chunk );
+      cdims[1] = ncol;
+      H5Pset_chunk( pid, rank, cdims );
+      hdfy_SetFilters( pid, ftype, o );
+   }
+
+   did = H5Dcreate2( loc, name, ftype, sid, H5P_DEFAULT, pid, H5P_DEFAULT );
+   H5Pclose( pid );
+   H5Sclose( sid );
+   if( did < 0 ) {
+      fprintf( stderr, " e [%s]  Could not create dataset \"%s\"\n",
+               FUNC, name );
+   }
+
+   return did;
+}
+#undef FUNC
+
+
+//
+// Function to create a dataset that starts empty and grows by rows as they
+// are appended; such a dataset is always chunked
+//
+
+hid_t hdfy_CreateGrowing( hid_t loc, const char *name, hid_t ftype,
+                          hsize_t ncol, const struct hdfyOpts_s *o )
+#define FUNC "hdfy_CreateGrowing"
+{
+   struct hdfyOpts_s od;
+   hsize_t dims[2],mdims[2],cdims[2];
+   hid_t sid,pid,did;
+   int rank = ( ncol > 0 ? 2 : 1 );
+
+   if( o == NULL ) {
+      hdfy_InitOpts( &od );
+      o = &od;
+   }
+
+   dims[0] = 0;
+   dims[1] = ncol;
+   mdims[0] = H5S_UNLIMITED;
+   mdims[1] = ncol;
+   sid = H5Screate_simple( rank, dims, mdims );
+   if( sid < 0 ) return -1;
+
+   pid = H5Pcreate( H5P_DATASET_CREATE );
+   cdims[0] = (hsize_t) ( o->chunk > 0 ? o->chunk : 65536 );
+   cdims[1] = ncol;
+   H5Pset_chunk( pid, rank, cdims );
+   hdfy_SetFilters( pid, ftype, o );
+
+   did = H5Dcreate2( loc, name, ftype, sid, H5P_DEFAULT, pid, H5P_DEFAULT );
+   H5Pclose( pid );
+   H5Sclose( sid );
+   if( did < 0 ) {
+      fprintf( stderr, " e [%s]  Could not create dataset \"%s\"\n",
+               FUNC, name );
+   }
+
+   return did;
+}
+#undef FUNC
+
+
+//
+// Function to append rows (contiguous in memory) to a growing dataset
+//
+
+int hdfy_AppendRows( hid_t did, hid_t mtype, hsize_t nrow, hsize_t ncol,
+                     const void *buf )
+{
+   const size_t rsize = H5Tget_size( mtype ) * (size_t) ( ncol > 0 ? ncol : 1 );
+   hsize_t dims[2];
+   hid_t sid;
+
+   if( nrow == 0 ) return 0;
+
+   sid = H5Dget_space( did );
+   H5Sget_simple_extent_dims( sid, dims, NULL );
+   H5Sclose( sid );
+   dims[0] += nrow;
+   if( H5Dset_extent( did, dims ) < 0 ) return 1;
+
+   return hdfy_WriteSlab( did, mtype, dims[0] - nrow, nrow, ncol, buf, rsize,
+                          H5P_DEFAULT );
+}
+
+
+//
+// Work of a thread that prepares one chunk of spread rows for the file
+//
+
+struct hdfyChunk_s {
+   const char *base;    // first byte of the chunk's first row
+   size_t stride;       // bytes from one row to the next
+   size_t nrow;         // rows present (a chunk at the end is partial)
+   size_t rsize;        // bytes of a row in the chunk
+   size_t esize;        // bytes of an element
+   size_t csize;        // bytes of a full chunk
+   int ishuffle,ideflate;
+   unsigned char *raw,*tmp,*out;
+   size_t nout;
+   int ierr;
+};
+
+static void* hdfy_FilterChunk( void *arg )
+{
+   struct hdfyChunk_s *c = (struct hdfyChunk_s *) arg;
+   unsigned char *p = c->raw;
+   size_t i,j,n;
+
+   // gather the rows; the library keeps edge chunks whole, padded with zeros
+   for(i=0;i<c->nrow;++i) {
+      memcpy( &( c->raw[ i*c->rsize ] ), c->base + i*c->stride, c->rsize );
+   }
+   memset( &( c->raw[ c->nrow*c->rsize ] ), 0, c->csize - c->nrow*c->rsize );
+
+   // byte shuffle: the j-th bytes of all elements go together
+   if( c->ishuffle && c->esize > 1 ) {
+      n = c->csize / c->esize;
+      for(j=0;j<c->esize;++j) {
+         for(i=0;i<n;++i) c->tmp[ j*n + i ] = c->raw[ i*c->esize + j ];
+      }
+      p = c->tmp;
+   }
+
+   if( c->ideflate > 0 ) {
+      uLongf nz = (uLongf) compressBound( (uLong) c->csize );
+      c->ierr = ( compress2( c->out, &nz, p, (uLong) c->csize, c->ideflate )
+                  == Z_OK ? 0 : 1 );
+      c->nout = (size_t) nz;
+   } else {
+      if( p != c->out ) memcpy( c->out, p, c->csize );
+      c->nout = c->csize;
+      c->ierr = 0;
+   }
+
+   return NULL;
+}
+
+
+//
+// Function to make the file type of an array: a copy of the given type, cut
+// down to the bits that the largest value needs when n-bit packing is asked
+// for an unsigned integer
+//
+
+static hid_t hdfy_FileType( hid_t ftype, hid_t mtype, hsize_t nrow,
+                            hsize_t ncol, const void *base, size_t stride,
+                            const struct hdfyOpts_s *o )
+{
+   hid_t tid = H5Tcopy( ftype );
+   const size_t esize = H5Tget_size( mtype );
+   const size_t nc = (size_t) ( ncol > 0 ? ncol : 1 );
+   unsigned long long umax=0,u;
+   size_t i,j;
+   int nbit=1;
+
+   if( !o->inbit || o->chunk <= 0 || nrow == 0 ||
+       H5Tget_class( mtype ) != H5T_INTEGER ||
+       H5Tget_sign( mtype ) != H5T_SGN_NONE ) return tid;
+
+   for(i=0;i<(size_t) nrow;++i) {
+      const unsigned char *r = (const unsigned char *) base + i*stride;
+      for(j=0;j<nc;++j) {
+         switch( esize ) {
+          case 1: u = *( (const uint8_t *) ( r + j ) ); break;
+          case 2: u = *( (const uint16_t *) ( r + 2*j ) ); break;
+          case 4: u = *( (const uint32_t *) ( r + 4*j ) ); break;
+          case 8: u = *( (const uint64_t *) ( r + 8*j ) ); break;
+          default: return tid;
+         }
+         if( u > umax ) umax = u;
+      }
+   }
+   while( nbit < 64 && ( umax >> nbit ) != 0 ) ++nbit;
+   H5Tset_precision( tid, (size_t) nbit );
+
+   return tid;
+}
+
+
+//
+// Function to describe the filters of a set of options
+//
+
+static void hdfy_FilterName( const struct hdfyOpts_s *o, hid_t ftype,
+                             char *s, size_t n )
+{
+   size_t k=0;
+
+   s[0] = '\0';
+   if( o->chunk <= 0 ) {
+      snprintf( s, n, "none" );
+      return;
+   }
+   if( o->inbit && H5Tget_class( ftype ) == H5T_INTEGER ) {
+      k += snprintf( &( s[k] ), n-k, "nbit(%d)+",
+                     (int) H5Tget_precision( ftype ) );
+   }
+   if( o->iscaleoffset > 0 && H5Tget_class( ftype ) == H5T_FLOAT ) {
+      k += snprintf( &( s[k] ), n-k, "scaleoffset(%d)+", o->iscaleoffset );
+   }
+   if( o->ishuffle && k < n ) k += snprintf( &( s[k] ), n-k, "shuffle+" );
+   if( o->ideflate > 0 && k < n ) {
+      k += snprintf( &( s[k] ), n-k, "deflate(%d)+", o->ideflate );
+   }
+   if( k == 0 ) {
+      snprintf( s, n, "none" );
+   } else if( k < n ) {
+      s[k-1] = '\0';
+   }
+}
+
+
+//
+// Function to try settings on a sample of an array and pick the cheapest;
+// the trials are made in files in memory whose names are unique to the
+// process, the thread and the call, so that threads can tune at the same
+// time. With "igrow" the sample is the start of an array that grows, so
+// n-bit packing (which needs the range of all the rows) is not tried and
+// the partial last chunk is not counted. Returns non-zero when no trial
+// could be made, and then "best" has the settings given.
+//
+
+static long hdfy_ntune = 0;
+
+static int hdfy_Tune( const char *name, hid_t ftype, hid_t mtype,
+                       hsize_t nrow, hsize_t ncol,
+                       const void *base, size_t stride,
+                       const struct hdfyOpts_s *o,
+                       struct hdfyOpts_s *best, double *ratio, int igrow )
+#define FUNC "hdfy_Tune"
+{
+   static const long chunks[3] = { 8192, 32768, 131072 };
+   static const int stacks[8][3] = {   // shuffle, deflate, n-bit/scale-offset
+      {0,0,0}, {0,1,0}, {1,1,0}, {1,4,0}, {1,6,0}, {0,0,1}, {0,1,1}, {1,4,1}
+   };
+   const size_t esize = H5Tget_size( mtype );
+   const size_t rsize = esize * (size_t) ( ncol > 0 ? ncol : 1 );
+   const int iint = ( H5Tget_class( mtype ) == H5T_INTEGER &&
+                      H5Tget_sign( mtype ) == H5T_SGN_NONE && !igrow );
+   const int iflt = ( H5Tget_class( mtype ) == H5T_FLOAT &&
+                      o->iscaleoffset > 0 );
+   size_t ns,nblk,nb,b,i0,i;
+   unsigned char *sample,*rbuf;
+   double cbest=0.0,raw;
+   long clast=0;
+   hid_t fapl;
+   char fname[128];
+   int ic,is,ib=0;
+
+   *best = *o;
+   best->itune = 0;
+   *ratio = 1.0;
+
+   ns = (size_t) ( nrow < (hsize_t) o->tune_rows ? nrow : o->tune_rows );
+   if( ns == 0 ) return 1;
+   sample = (unsigned char *) malloc( ns * rsize );
+   rbuf = (unsigned char *) malloc( 256 * rsize );
+   if( sample == NULL || rbuf == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate sample of \"%s\" \n",
+               FUNC, name );
+      free( sample );
+      free( rbuf );
+      return 1;
+   }
+
+   // evenly spaced blocks of rows, so that a sorted array is seen throughout
+   nblk = ( ns < 8 ? 1 : 8 );
+   for(b=0;b<nblk;++b) {
+      const size_t s0 = b * ( ns / nblk );
+      nb = ( b == nblk-1 ? ns - s0 : ns / nblk );
+      i0 = ( nblk == 1 ? 0 :
+             b * ( (size_t) nrow - nb ) / ( nblk - 1 ) );
+      for(i=0;i<nb;++i) {
+         memcpy( &( sample[ ( s0 + i )*rsize ] ),
+                 (const unsigned char *) base + ( i0 + i )*stride, rsize );
+      }
+   }
+   raw = (double) ( ns * rsize );
+
+   fapl = H5Pcreate( H5P_FILE_ACCESS );
+   H5Pset_fapl_core( fapl, 1 << 20, 0 );
+   snprintf( fname, sizeof(fname), "hdfy_tune_%ld_%lu_%ld.h5",
+             (long) getpid(), (unsigned long) pthread_self(),
+             __atomic_fetch_add( &hdfy_ntune, 1, __ATOMIC_RELAXED ) );
+
+   for(ic=0;ic<3;++ic) {
+      const long nc = ( chunks[ic] < (long) ns ? chunks[ic] : (long) ns );
+      if( nc == clast ) continue;
+      clast = nc;
+
+      for(is=0;is<8;++is) {
+         struct hdfyOpts_s t = *o;
+         hsize_t off[2]={0,0},cnt[2];
+         double t0,t1,t2,cost;
+         hid_t fid,tid,did,dapl,fsid,msid;
+         unsigned int iseed=12345;
+         int k;
+
+         if( stacks[is][2] && !iint && !iflt ) continue;
+         if( stacks[is][1] && H5Zfilter_avail( H5Z_FILTER_DEFLATE ) <= 0 ) {
+            continue;
+         }
+         t.itune = 0;
+         t.chunk = nc;
+         t.ishuffle = stacks[is][0];
+         t.ideflate = stacks[is][1];
+         t.inbit = ( stacks[is][2] && iint );
+         t.iscaleoffset = ( stacks[is][2] && iflt ? o->iscaleoffset : 0 );
+
+         fid = H5Fcreate( fname, H5F_ACC_TRUNC, H5P_DEFAULT, fapl );
+         if( fid < 0 ) continue;
+         tid = hdfy_FileType( ftype, mtype, (hsize_t) ns, ncol,
+                              sample, rsize, &t );
+         t0 = hdfy_Time();
+         did = hdfy_CreateArray( fid, "a", tid, (hsize_t) ns, ncol, &t );
+         H5Dwrite( did, mtype, H5S_ALL, H5S_ALL, H5P_DEFAULT, sample );
+         H5Dclose( did );
+         H5Fflush( fid, H5F_SCOPE_LOCAL );
+
+         // small windows, each of which has to go through the filters
+         dapl = H5Pcreate( H5P_DATASET_ACCESS );
+         H5Pset_chunk_cache( dapl, 0, 0, 1.0 );
+         did = H5Dopen2( fid, "a", dapl );
+         cnt[0] = ( ns < 256 ? ns : 256 );
+         cnt[1] = ncol;
+         fsid = H5Dget_space( did );
+         msid = H5Screate_simple( ( ncol > 0 ? 2 : 1 ), cnt, NULL );
+         t1 = hdfy_Time();
+         for(k=0;k<16;++k) {
+            iseed = iseed * 1103515245u + 12345u;
+            off[0] = (hsize_t) ( ( iseed >> 8 ) % ( ns - cnt[0] + 1 ) );
+            H5Sselect_hyperslab( fsid, H5S_SELECT_SET, off, NULL, cnt, NULL );
+            H5Dread( did, mtype, msid, fsid, H5P_DEFAULT, rbuf );
+         }
+         t2 = hdfy_Time();
+
+         cost = (double) H5Dget_storage_size( did ) / raw;
+         cost += o->tune_speed * ( ( t1-t0 ) + ( t2-t1 ) ) / ( raw * 1.0e-6 );
+         // the whole array's last chunk is stored whole, which only the
+         // filters that compress can hide
+         if( !igrow && !t.ideflate && !t.inbit && !t.iscaleoffset ) {
+            const hsize_t nk = ( nrow + (hsize_t) nc - 1 ) / (hsize_t) nc;
+            cost += (double) ( nk * (hsize_t) nc - nrow ) / (double) nrow;
+         }
+#ifdef _DEBUG_
+         {
+            char fs[64];
+            hdfy_FilterName( &t, tid, fs, 64 );
+            fprintf( stderr, " i [%s]  %s: chunk %ld  %-28s  size %.3f  "
+                     "cost %.3f \n", FUNC, name, nc, fs,
+                     (double) H5Dget_storage_size( did ) / raw, cost );
+         }
+#endif
+         if( ib == 0 || cost < cbest ) {
+            ib = 1;
+            cbest = cost;
+            *best = t;
+            *ratio = (double) H5Dget_storage_size( did ) / raw;
+         }
+
+         H5Sclose( msid );
+         H5Sclose( fsid );
+         H5Dclose( did );
+         H5Pclose( dapl );
+         H5Tclose( tid );
+         H5Fclose( fid );
+      }
+   }
+
+   H5Pclose( fapl );
+   free( sample );
+   free( rbuf );
+
+   if( ib == 0 ) {
+      fprintf( stderr, " e [%s]  No trial could be made for \"%s\"; it is "
+               "written untuned \n", FUNC, name );
+      return 1;
+   }
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to create a growing dataset (see hdfy_CreateGrowing()) whose
+// chunk and filters are tuned, when the options ask for it, on its first
+// "nrow" rows, which are "stride" bytes apart in memory; the choice is
+// recorded in the attributes as for the arrays written whole
+//
+
+hid_t hdfy_CreateGrowingTuned( hid_t loc, const char *name,
+                               hid_t ftype, hid_t mtype,
+                               hsize_t ncol, hsize_t nrow,
+                               const void *base, size_t stride,
+                               const struct hdfyOpts_s *o )
+{
+   struct hdfyOpts_s od,ot;
+   double ratio=1.0;
+   int ituned=0;
+   hid_t did;
+
+   if( o == NULL ) {
+      hdfy_InitOpts( &od );
+   } else {
+      od = *o;
+   }
+   if( od.itune && nrow > 0 && base != NULL ) {
+      ot = od;
+      ituned = ( hdfy_Tune( name, ftype, mtype, nrow, ncol, base, stride,
+                            &ot, &od, &ratio, 1 ) == 0 );
+   }
+
+   did = hdfy_CreateGrowing( loc, name, ftype, ncol, &od );
+   if( did >= 0 && ituned ) {
+      char fs[64];
+      hdfy_FilterName( &od, ftype, fs, 64 );
+      hdfy_WriteAttrInt( did, "hdfy_chunk", od.chunk );
+      hdfy_WriteAttrString( did, "hdfy_filters", fs );
+      hdfy_WriteAttrDouble( did, "hdfy_ratio", ratio );
+   }
+
+   return did;
+}
+
+
+//
+// Function to store rows that are "stride" bytes apart in memory, each made
+// of "ncol" elements of the memory type (rank one when "ncol" is zero); with
+// "ipar" the chunks are filtered by our threads when the filters allow it,
+// otherwise the library does everything
+//
+
+static int hdfy_Write( hid_t loc, const char *name, hid_t ftype, hid_t mtype,
+                       hsize_t nrow, hsize_t ncol,
+                       const void *base, size_t stride,
+                       const struct hdfyOpts_s *o, int ipar )
+#define FUNC "hdfy_Write"
+{
+   struct hdfyOpts_s od;
+   struct hdfyChunk_s *c;
+   pthread_t *th;
+   hsize_t off[2] = {0,0};
+   size_t esize,rsize,crow,nchunk,k,m;
+   double ratio=0.0;
+   int nt,it,ierr=0,ituned=0;
+   hid_t did,tid;
+
+   if( o == NULL ) {
+      hdfy_InitOpts( &od );
+   } else {
+      od = *o;
+   }
+   if( od.ideflate > 0 && H5Zfilter_avail( H5Z_FILTER_DEFLATE ) <= 0 ) {
+      od.ideflate = 0;
+   }
+
+   esize = H5Tget_size( mtype );
+   rsize = esize * (size_t) ( ncol > 0 ? ncol : 1 );
+   if( stride % esize != 0 ) {
+      fprintf( stderr, " e [%s]  Rows of \"%s\" are not aligned \n",
+               FUNC, name );
+      return 1;
+   }
+
+   if( od.itune && nrow > 0 ) {
+      struct hdfyOpts_s ot = od;
+      ituned = ( hdfy_Tune( name, ftype, mtype, nrow, ncol, base, stride,
+                            &ot, &od, &ratio, 0 ) == 0 );
+   }
+
+   tid = hdfy_FileType( ftype, mtype, nrow, ncol, base, stride, &od );
+   did = hdfy_CreateArray( loc, name, tid, nrow, ncol, &od );
+   if( did < 0 ) {
+      H5Tclose( tid );
+      return 2;
+   }
+   if( ituned ) {
+      char fs[64];
+      hdfy_FilterName( &od, tid, fs, 64 );
+      hdfy_WriteAttrInt( did, "hdfy_chunk",
+                         ( od.chunk < (long) nrow ? od.chunk : (long) nrow ) );
+      hdfy_WriteAttrString( did, "hdfy_filters", fs );
+      hdfy_WriteAttrDouble( did, "hdfy_ratio", ratio );
+   }
+   H5Tclose( tid );
+   if( nrow == 0 ) {
+      H5Dclose( did );
+      return 0;
+   }
+
+   // let the library pick the columns out of the rows
+   if( !ipar || od.chunk <= 0 || od.inbit || od.iscaleoffset > 0 ) {
+      ierr = hdfy_WriteSlab( did, mtype, 0, nrow, ncol, base, stride,
+                             H5P_DEFAULT );
+      H5Dclose( did );
+      if( ierr ) {
+         fprintf( stderr, " e [%s]  Could not write \"%s\" \n", FUNC, name );
+      }
+      return ierr;
+   }
+
+   crow = (size_t) ( nrow < (hsize_t) od.chunk ? nrow : (hsize_t) od.chunk );
+   nchunk = ( (size_t) nrow + crow - 1 ) / crow;
+   nt = od.nthreads;
+   if( nt <= 0 ) nt = (int) sysconf( _SC_NPROCESSORS_ONLN );
+   if( nt <= 0 ) nt = 1;
+   if( (size_t) nt > nchunk ) nt = (int) nchunk;
+
+   c = (struct hdfyChunk_s *) calloc( (size_t) nt, sizeof(struct hdfyChunk_s) );
+   th = (pthread_t *) malloc( ((size_t) nt) * sizeof(pthread_t) );
+   if( c == NULL || th == NULL ) ierr = 4;
+   for(it=0;it<nt && ierr == 0;++it) {
+      c[it].stride = stride;
+      c[it].rsize = rsize;
+      c[it].esize = esize;
+      c[it].csize = crow * rsize;
+      c[it].ishuffle = od.ishuffle;
+      c[it].ideflate = od.ideflate;
+      c[it].raw = (unsigned char *) malloc( c[it].csize );
+      c[it].tmp = (unsigned char *) malloc( c[it].csize );
+      c[it].out = (unsigned char *)
+                  malloc( compressBound( (uLong) c[it].csize ) );
+      if( c[it].raw == NULL || c[it].tmp == NULL || c[it].out == NULL ) {
+         ierr = 4;
+      }
+   }
+   if( ierr ) fprintf( stderr, " e [%s]  Could not allocate chunks \n", FUNC );
+
+   // rounds of one chunk per thread, written in order
+   for(k=0;k<nchunk && ierr == 0;k+=(size_t) nt) {
+      m = ( nchunk - k < (size_t) nt ? nchunk - k : (size_t) nt );
+      for(it=0;it<(int) m;++it) {
+         const size_t i0 = ( k + (size_t) it ) * crow;
+         c[it].base = (const char *) base + i0*stride;
+         c[it].nrow = ( (size_t) nrow - i0 < crow ? (size_t) nrow - i0 : crow );
+         if( it > 0 ) {
+            pthread_create( &( th[it] ), NULL, hdfy_FilterChunk, &( c[it] ) );
+         }
+      }
+      hdfy_FilterChunk( &( c[0] ) );
+      for(it=1;it<(int) m;++it) pthread_join( th[it], NULL );
+
+      for(it=0;it<(int) m && ierr == 0;++it) {
+         off[0] = (hsize_t) ( ( k + (size_t) it ) * crow );
+         if( c[it].ierr != 0 ||
+             H5Dwrite_chunk( did, H5P_DEFAULT, 0, off, c[it].nout,
+                             c[it].out ) < 0 ) {
+            fprintf( stderr, " e [%s]  Could not write a chunk of \"%s\" \n",
+                     FUNC, name );
+            ierr = 5;
+         }
+      }
+   }
+
+   if( c != NULL ) {
+      for(it=0;it<nt;++it) {
+         free( c[it].raw );
+         free( c[it].tmp );
+         free( c[it].out );
+      }
+      free( c );
+   }
+   free( th );
+   H5Dclose( did );
+
+   return ierr;
+}
+#undef FUNC
+
+
+
+//
+// Function to store rows "row0" to "row0+nrow" of a dataset from rows that
+// are "stride" bytes apart in memory; a process with nothing to store still
+// takes part, with empty selections, when the transfer is collective
+//
+
+int hdfy_WriteSlab( hid_t did, hid_t mtype, hsize_t row0, hsize_t nrow,
+                    hsize_t ncol, const void *base, size_t stride, hid_t dxpl )
+{
+   const size_t esize = H5Tget_size( mtype );
+   hsize_t mdims[2],off[2]={0,0},cnt[2];
+   hid_t mid,sid;
+   int ierr=0;
+
+   if( stride % esize != 0 ) return 1;
+
+   mdims[0] = ( nrow > 0 ? nrow : 1 );
+   mdims[1] = (hsize_t) ( stride / esize );
+   cnt[0] = nrow;
+   cnt[1] = ( ncol > 0 ? ncol : 1 );
+   mid = H5Screate_simple( 2, mdims, NULL );
+   sid = H5Dget_space( did );
+   if( nrow > 0 ) {
+      H5Sselect_hyperslab( mid, H5S_SELECT_SET, off, NULL, cnt, NULL );
+      off[0] = row0;       // a rank-one dataset only looks at the rows
+      H5Sselect_hyperslab( sid, H5S_SELECT_SET, off, NULL, cnt, NULL );
+   } else {
+      H5Sselect_none( mid );
+      H5Sselect_none( sid );
+   }
+   if( H5Dwrite( did, mtype, mid, sid, dxpl, base ) < 0 ) ierr = 2;
+   H5Sclose( sid );
+   H5Sclose( mid );
+
+   return ierr;
+}
+
+
+//
+// Function to store a whole array in one call, converting it to the file's
+// type on the way
+//
+
+int hdfy_WriteArray( hid_t loc, const char *name, hid_t ftype, hid_t mtype,
+                     hsize_t nrow, hsize_t ncol, const void *buf,
+                     const struct hdfyOpts_s *o )
+{
+   const size_t rsize = H5Tget_size( mtype ) * (size_t) ( ncol > 0 ? ncol : 1 );
+
+   return hdfy_Write( loc, name, ftype, mtype, nrow, ncol, buf, rsize, o, 0 );
+}
+
+
+//
+// Function to store rows that are "stride" bytes apart in memory, each made
+// of "ncol" elements of the memory type (rank one when "ncol" is zero); the
+// file keeps the elements in the memory type, and the chunks are filtered
+// by several threads
+//
+
+int hdfy_WriteRows( hid_t loc, const char *name, hid_t mtype,
+                    hsize_t nrow, hsize_t ncol,
+                    const void *base, size_t stride,
+                    const struct hdfyOpts_s *o )
+{
+   return hdfy_Write( loc, name, mtype, mtype, nrow, ncol, base, stride,
+                      o, 1 );
+}
+
+
+//
+// Functions to attach scalar attributes to an object
+//
+
+int hdfy_WriteAttrString( hid_t loc, const char *name, const char *value )
+{
+   hid_t tid,sid,aid;
+   herr_t ierr;
+
+   tid = H5Tcopy( H5T_C_S1 );
+   H5Tset_size( tid, strlen( value ) + 1 );
+   H5Tset_strpad( tid, H5T_STR_NULLTERM );
+   sid = H5Screate( H5S_SCALAR );
+   aid = H5Acreate2( loc, name, tid, sid, H5P_DEFAULT, H5P_DEFAULT );
+   ierr = H5Awrite( aid, tid, value );
+   H5Aclose( aid );
+   H5Sclose( sid );
+   H5Tclose( tid );
+
+   return( ierr < 0 ? 1 : 0 );
+}
+
+int hdfy_WriteAttrInt( hid_t loc, const char *name, long value )
+{
+   hid_t sid,aid;
+   herr_t ierr;
+
+   sid = H5Screate( H5S_SCALAR );
+   aid = H5Acreate2( loc, name, H5T_STD_I64LE, sid, H5P_DEFAULT, H5P_DEFAULT );
+   ierr = H5Awrite( aid, H5T_NATIVE_LONG, &value );
+   H5Aclose( aid );
+   H5Sclose( sid );
+
+   return( ierr < 0 ? 1 : 0 );
+}
+
+int hdfy_WriteAttrDouble( hid_t loc, const char *name, double value )
+{
+   hid_t sid,aid;
+   herr_t ierr;
+
+   sid = H5Screate( H5S_SCALAR );
+   aid = H5Acreate2( loc, name, H5T_IEEE_F64LE, sid, H5P_DEFAULT, H5P_DEFAULT);
+   ierr = H5Awrite( aid, H5T_NATIVE_DOUBLE, &value );
+   H5Aclose( aid );
+   H5Sclose( sid );
+
+   return( ierr < 0 ? 1 : 0 );
+}
+
+
+//
+// Functions to read scalar attributes of an object; the string is to be
+// freed and is NULL when the attribute is missing or not a fixed string,
+// and the integer returns non-zero when it cannot be read
+//
+
+char* hdfy_ReadAttrString( hid_t loc, const char *name )
+{
+   hid_t aid=-1,tid;
+   size_t n;
+   char *str = NULL;
+
+   H5E_BEGIN_TRY {
+      aid = H5Aopen( loc, name, H5P_DEFAULT );
+   } H5E_END_TRY;
+   if( aid < 0 ) return NULL;
+
+   tid = H5Aget_type( aid );
+   n = H5Tget_size( tid );
+   if( H5Tget_class( tid ) == H5T_STRING && !H5Tis_variable_str( tid ) &&
+       n > 0 ) str = (char *) calloc( n + 1, 1 );
+   if( str != NULL && H5Aread( aid, tid, str ) < 0 ) {
+      free( str );
+      str = NULL;
+   }
+   H5Tclose( tid );
+   H5Aclose( aid );
+
+   return str;
+}
+
+int hdfy_ReadAttrInt( hid_t loc, const char *name, long *value )
+{
+   hid_t aid=-1;
+   herr_t ierr;
+
+   H5E_BEGIN_TRY {
+      aid = H5Aopen( loc, name, H5P_DEFAULT );
+   } H5E_END_TRY;
+   if( aid < 0 ) return 1;
+
+   ierr = H5Aread( aid, H5T_NATIVE_LONG, value );
+   H5Aclose( aid );
+
+   return( ierr < 0 ? 1 : 0 );
+}
+
@@ -0,0 +1,139 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#ifndef _HDFY_H_
+#define _HDFY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <hdf5.h>
+
+//
+// Pieces shared by the HDF5 writers. Mesh arrays are stored as datasets of
+// "nrow" rows by "ncol" columns (rank one when "ncol" is zero), written in
+// one call straight from the caller's memory. Large arrays are chunked by
+// rows and can be filtered; the library applies the filters chunk by chunk
+// on its way to the file.
+// Rows that are spread in memory (a column of an array of structures) are
+// written with hdfy_WriteRows(). There, the chunks are gathered, shuffled
+// and deflated by several threads, the same way the library would, and are
+// handed to the file as they are; the serial library cannot run its filters
+// in more than one thread.
+// Converters that stream their input append rows to datasets that grow as
+// the batches arrive (hdfy_CreateGrowing() and hdfy_AppendRows()).
+// In the tuning mode, every array is sampled (evenly spaced blocks of rows)
+// and the sample is written to a file in memory with a set of chunk sizes
+// and filter stacks; n-bit packing is tried for integers, and scale-offset
+// for floats when lossy storage was allowed with "iscaleoffset". Each trial
+// costs
+//    (stored size / raw size) + tune_speed * (write + read time) / raw MB,
+// where the read is a set of small windows with the chunk cache disabled,
+// and the cheapest setting is used and recorded in the dataset's attributes
+// "hdfy_chunk", "hdfy_filters" and "hdfy_ratio". A growing dataset is tuned
+// on its first batch (hdfy_CreateGrowingTuned()), without n-bit packing.
+//
+
+// options of the writers
+struct hdfyOpts_s {
+   long chunk;          // rows in a chunk; zero for contiguous storage
+   int ishuffle;        // byte shuffle ahead of compression
+   int ideflate;        // deflate (gzip) level 1-9; zero for none
+   int nthreads;        // threads filtering chunks; zero for all cores
+   int inbit;           // pack unsigned integers to the bits they need
+   int iscaleoffset;    // keep this many decimals of floats (lossy); zero
+                        // for none
+   int itune;           // pick chunk and filters by trying them on samples
+   long tune_rows;      // rows in the sample of an array
+   double tune_speed;   // weight of seconds per (raw) megabyte written and
+                        // read against the compressed to raw size ratio
+   long batch;          // records in a batch of the pipelined converters
+   int depth;           // batches queued between the parser and the writer
+   long tile;           // pixels on the side of a (square) image chunk
+   int icorners;        // also write unified (v,vt,vn) corners of OBJ faces
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void hdfy_InitOpts( struct hdfyOpts_s *o );
+
+double hdfy_Time( void );
+
+hid_t hdfy_CreateFile( const char *filename, const char *format,
+                       const char *source );
+
+hid_t hdfy_CreateArray( hid_t loc, const char *name, hid_t ftype,
+                        hsize_t nrow, hsize_t ncol,
+                        const struct hdfyOpts_s *o );
+
+hid_t hdfy_CreateGrowing( hid_t loc, const char *name, hid_t ftype,
+                          hsize_t ncol, const struct hdfyOpts_s *o );
+
+hid_t hdfy_CreateGrowingTuned( hid_t loc, const char *name,
+                               hid_t ftype, hid_t mtype,
+                               hsize_t ncol, hsize_t nrow,
+                               const void *base, size_t stride,
+                               const struct hdfyOpts_s *o );
+
+int hdfy_AppendRows( hid_t did, hid_t mtype, hsize_t nrow, hsize_t ncol,
+                     const void *buf );
+
+int hdfy_WriteArray( hid_t loc, const char *name, hid_t ftype, hid_t mtype,
+                     hsize_t nrow, hsize_t ncol, const void *buf,
+                     const struct hdfyOpts_s *o );
+
+int hdfy_WriteRows( hid_t loc, const char *name, hid_t mtype,
+                    hsize_t nrow, hsize_t ncol,
+                    const void *base, size_t stride,
+                    const struct hdfyOpts_s *o );
+
+int hdfy_WriteSlab( hid_t did, hid_t mtype, hsize_t row0, hsize_t nrow,
+                    hsize_t ncol, const void *base, size_t stride,
+                    hid_t dxpl );
+
+int hdfy_WriteAttrString( hid_t loc, const char *name, const char *value );
+
+int hdfy_WriteAttrInt( hid_t loc, const char *name, long value );
+
+int hdfy_WriteAttrDouble( hid_t loc, const char *name, double value );
+
+char* hdfy_ReadAttrString( hid_t loc, const char *name );
+
+int hdfy_ReadAttrInt( hid_t loc, const char *name, long *value );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,816 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "hdfy_batch.h"
+#include "hdfy_obj.h"
+#include "hdfy_stl.h"
+#include "hdfy_cache.h"
+
+// formats of inputs
+#define HDFY_UNKNOWN  0
+#define HDFY_OBJ      1
+#define HDFY_STL      2        // ASCII, or binary with "solid" in the header
+#define HDFY_STLBIN   3        // binary, identified by its size
+
+// STL inputs larger than this are streamed to their outputs a batch of
+// triangles at a time rather than read whole (see hdfy_ConvertSTL())
+#define HDFY_STREAM_BYTES  ( 1L << 30 )
+
+struct hdfyJob_s {
+   char *in, *out;
+   long size;
+   int type, ierr;
+   int iskip;              // the output was up to date
+};
+
+struct hdfyJobList_s {
+   struct hdfyJob_s *job;
+   long n, cap;
+};
+
+// queue of a thread; the jobs "idx[head]" to "idx[tail-1]" are left, the
+// largest first
+struct hdfyQueue_s {
+   pthread_mutex_t lock;
+   long *idx;
+   long head, tail;
+};
+
+struct hdfyPool_s {
+   struct hdfyJobList_s *jobs;
+   struct hdfyQueue_s *q;
+   int nq;
+   const struct hdfyBatchOpts_s *b;
+   struct hdfyOpts_s o;
+   pthread_mutex_t h5lock;
+   int ih5lock;
+   long nsteal,ndone;
+   pthread_mutex_t lock;
+};
+
+
+void hdfy_InitBatchOpts( struct hdfyBatchOpts_s *b )
+{
+   b->nthreads = 0;
+   b->outdir = NULL;
+   b->iverbose = 0;
+   b->iforce = 0;
+}
+
+
+//
+// Function to tell the format of a file from its name or its first bytes
+//
+
+static int hdfy_DetectFormat( const char *path, long size, int iname )
+{
+   const char *ext = strrchr( path, '.' );
+   unsigned char h[84];
+   unsigned int ntri;
+   size_t n,k;
+   FILE *fp;
+
+   if( ext != NULL && strcasecmp( ext, ".obj" ) == 0 ) return HDFY_OBJ;
+   if( ext != NULL && strcasecmp( ext, ".stl" ) == 0 ) {
+      if( size >= 84 && ( fp = fopen( path, "rb" ) ) != NULL ) {
+         n = fread( h, 1, 84, fp );
+         fclose( fp );
+         memcpy( &ntri, h + 80, 4 );
+         if( n == 84 && strncmp( (char *) h, "solid", 5 ) != 0 &&
+             size == 84 + 50 * (long) ntri ) return HDFY_STLBIN;
+      }
+      return HDFY_STL;
+   }
+   if( iname ) return HDFY_UNKNOWN;
+
+   fp = fopen( path, "rb" );
+   if( fp == NULL ) return HDFY_UNKNOWN;
+   n = fread( h, 1, 84, fp );
+   fclose( fp );
+
+   if( n >= 6 && ( strncmp( (char *) h, "solid ", 6 ) == 0 ||
+                   strncmp( (char *) h, " solid ", 7 ) == 0 ) ) {
+      return HDFY_STL;
+   }
+   if( n == 84 ) {
+      memcpy( &ntri, h + 80, 4 );
+      if( size == 84 + 50 * (long) ntri ) return HDFY_STLBIN;
+   }
+   // an OBJ file is text that starts with a comment or a statement
+   for(k=0;k<n;++k) {
+      if( h[k] == 0 || ( h[k] < 32 && h[k] != '\n' && h[k] != '\r' &&
+                         h[k] != '\t' ) ) return HDFY_UNKNOWN;
+   }
+   for(k=0;k<n && ( h[k] == ' ' || h[k] == '\t' );++k) {}
+   if( k < n && ( h[k] == '#' || h[k] == 'v' || h[k] == 'f' || h[k] == 'g' ||
+                  h[k] == 'o' || h[k] == 'm' || h[k] == 's' ) ) return HDFY_OBJ;
+
+   return HDFY_UNKNOWN;
+}
+
+
+//
+// Function to add a file to the jobs; the output is named after the input,
+// and under "outdir" it keeps the part of the input's path from "nroot" on
+// (its place below the directory that was named)
+//
+
+static int hdfy_AddJob( struct hdfyJobList_s *l, const char *path, long size,
+                        int type, const char *outdir, size_t nroot )
+{
+   const char *base,*ext;
+   size_t nb,nd;
+   struct hdfyJob_s *j;
+
+   if( l->n == l->cap ) {
+      long nc = ( l->cap > 0 ? 2*l->cap : 256 );
+      j = (struct hdfyJob_s *) realloc( l->job, (size_t) nc * sizeof(*j) );
+      if( j == NULL ) return 1;
+      l->job = j;
+      l->cap = nc;
+   }
+   j = &( l->job[ l->n ] );
+
+   // the name without its extension, kept in its directory without "outdir"
+   base = strrchr( path, '/' );
+   base = ( base != NULL ? base + 1 : path );
+   ext = strrchr( base, '.' );
+   if( ext == NULL || ext == base ) ext = base + strlen( base );
+   base = ( outdir == NULL ? path : path + nroot );
+   nb = (size_t) ( ext - base );
+   nd = ( outdir != NULL ? strlen( outdir ) + 1 : 0 );
+
+   j->in = strdup( path );
+   j->out = (char *) malloc( nd + nb + 4 );
+   if( j->in == NULL || j->out == NULL ) {
+      if( j->in != NULL ) free( j->in );
+      if( j->out != NULL ) free( j->out );
+      return 1;
+   }
+   if( outdir != NULL ) sprintf( j->out, "%s/", outdir );
+   memcpy( j->out + nd, base, nb );
+   strcpy( j->out + nd + nb, ".h5" );
+   j->size = size;
+   j->type = type;
+   j->ierr = 0;
+   j->iskip = 0;
+   ++( l->n );
+
+   return 0;
+}
+
+
+//
+// Function to add a file, or the OBJ and STL files under a directory; the
+// outputs of a directory's files go to the same subdirectories of "outdir"
+// ("nroot" is where that part starts in the path, or zero for a path that
+// was named)
+//
+
+static int hdfy_AddPath( struct hdfyJobList_s *l, const char *path,
+                         int iname, const char *outdir, size_t nroot )
+#define FUNC "hdfy_AddPath"
+{
+   struct stat st;
+   struct dirent *e;
+   DIR *d;
+   const char *base;
+   char *sub;
+   int type,ierr=0;
+
+   if( stat( path, &st ) != 0 ) {
+      fprintf( stderr, " e [%s]  Cannot find \"%s\" \n", FUNC, path );
+      return 1;
+   }
+
+   if( S_ISREG( st.st_mode ) ) {
+      type = hdfy_DetectFormat( path, (long) st.st_size, iname );
+      if( type == HDFY_UNKNOWN ) {
+         if( !iname ) fprintf( stderr, " e [%s]  Unknown format of \"%s\" \n",
+                               FUNC, path );
+         return ( iname ? 0 : 1 );
+      }
+      if( nroot == 0 ) {
+         base = strrchr( path, '/' );
+         nroot = ( base != NULL ? (size_t) ( base + 1 - path ) : 0 );
+      }
+      return hdfy_AddJob( l, path, (long) st.st_size, type, outdir, nroot );
+   }
+   if( !S_ISDIR( st.st_mode ) ) return 0;
+   if( nroot == 0 ) nroot = strlen( path ) + 1;
+
+   d = opendir( path );
+   if( d == NULL ) {
+      fprintf( stderr, " e [%s]  Cannot read directory \"%s\" \n", FUNC, path );
+      return 1;
+   }
+   while( ( e = readdir( d ) ) != NULL ) {
+      if( e->d_name[0] == '.' ) continue;
+      sub = (char *) malloc( strlen( path ) + strlen( e->d_name ) + 2 );
+      if( sub == NULL ) {
+         ierr = 1;
+         break;
+      }
+      sprintf( sub, "%s/%s", path, e->d_name );
+      ierr += hdfy_AddPath( l, sub, 1, outdir, nroot );
+      free( sub );
+   }
+   closedir( d );
+
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// Function to add the files named in a list file ("-" for the standard
+// input), one per line
+//
+
+static int hdfy_AddList( struct hdfyJobList_s *l, const char *list,
+                         const char *outdir )
+#define FUNC "hdfy_AddList"
+{
+   char line[4096];
+   size_t n;
+   FILE *fp;
+   int ierr=0;
+
+   fp = ( strcmp( list, "-" ) == 0 ? stdin : fopen( list, "r" ) );
+   if( fp == NULL ) {
+      fprintf( stderr, " e [%s]  Cannot open list \"%s\" \n", FUNC, list );
+      return 1;
+   }
+   while( fgets( line, sizeof(line), fp ) != NULL ) {
+      n = strlen( line );
+      while( n > 0 && ( line[n-1] == '\n' || line[n-1] == '\r' ||
+                        line[n-1] == ' ' ) ) line[--n] = '\0';
+      if( n == 0 || line[0] == '#' ) continue;
+      ierr += hdfy_AddPath( l, line, 0, outdir, 0 );
+   }
+   if( fp != stdin ) fclose( fp );
+
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// Function to describe the options that change the output of a job (the
+// layout, the filters and the tuning, and for OBJ files the corners and the
+// width of the face indices)
+//
+
+static void hdfy_OptionsKey( const struct hdfyPool_s *pool,
+                             const struct hdfyJob_s *j, char *key, size_t n )
+{
+   const struct hdfyOpts_s *o = &( pool->o );
+   int nc;
+
+   nc = snprintf( key, n, "chunk=%ld shuffle=%d deflate=%d nbit=%d "
+                  "scaleoffset=%d tune=%d", o->chunk, o->ishuffle,
+                  o->ideflate, o->inbit, o->iscaleoffset, o->itune );
+   if( nc > 0 && (size_t) nc < n && o->itune ) {
+      nc += snprintf( key + nc, n - (size_t) nc, " tune_rows=%ld "
+                      "tune_speed=%g", o->tune_rows, o->tune_speed );
+   }
+   if( nc > 0 && (size_t) nc < n && j->type == HDFY_OBJ ) {
+      snprintf( key + nc, n - (size_t) nc, " tile=%ld corners=%d index=%d",
+                o->tile, o->icorners, (int) ( 8*sizeof(inObjIdx_t) ) );
+   }
+}
+
+
+//
+// Function to tell whether a file is as recorded; its size and time are
+// enough when both match, otherwise its contents decide (when its size
+// matches), and "d" then has its hash ("ihashed" is set)
+//
+
+static int hdfy_SameSource( const struct hdfySource_s *r,
+                            struct hdfySource_s *d, int *ihashed )
+{
+   if( r->size != d->size ) return 0;
+   if( r->mtime == d->mtime ) return 1;
+   if( !*ihashed ) {
+      if( hdfy_HashFile( r->path, d ) ) return 0;
+      *ihashed = 1;
+   }
+   return( r->hash == d->hash );
+}
+
+//
+// Function to tell whether the output of a job was made from the input as it
+// is now, with the same options and from the same versions of the files the
+// input pulled in; a dependency recorded as missing (negative size) that is
+// still missing does not count as a change. Files that had to be hashed
+// because only their time changed get their new time recorded, so they are
+// not hashed again by the next run.
+//
+
+static int hdfy_IsUpToDate( struct hdfyPool_s *pool, struct hdfyJob_s *j,
+                            struct hdfySource_s *in, int *ihashed )
+{
+   struct hdfySource_s *s,d;
+   char key[256],*opts;
+   int k,n,ierr,iok,ih,itime=0;
+
+   if( pool->ih5lock ) pthread_mutex_lock( &( pool->h5lock ) );
+   ierr = hdfy_ReadSources( j->out, &opts, &n, &s );
+   if( pool->ih5lock ) pthread_mutex_unlock( &( pool->h5lock ) );
+   if( ierr ) return 0;
+
+   hdfy_OptionsKey( pool, j, key, sizeof(key) );
+   iok = ( opts != NULL && strcmp( opts, key ) == 0 );
+   if( opts != NULL ) free( opts );
+
+   iok = ( iok && n >= 1 && strcmp( s[0].path, j->in ) == 0 &&
+           hdfy_SameSource( &( s[0] ), in, ihashed ) );
+   if( iok && s[0].mtime != in->mtime ) {
+      s[0].mtime = in->mtime;
+      itime = 1;
+   }
+   for(k=1;k<n && iok;++k) {
+      if( hdfy_StatFile( s[k].path, &d ) ) {
+         iok = ( s[k].size < 0 );
+      } else {
+         ih = 0;
+         iok = hdfy_SameSource( &( s[k] ), &d, &ih );
+         if( iok && s[k].mtime != d.mtime ) {
+            s[k].mtime = d.mtime;
+            itime = 1;
+         }
+      }
+   }
+   if( iok && itime ) {
+      if( pool->ih5lock ) pthread_mutex_lock( &( pool->h5lock ) );
+      hdfy_WriteSources( j->out, key, n, s );
+      if( pool->ih5lock ) pthread_mutex_unlock( &( pool->h5lock ) );
+   }
+   hdfy_FreeSources( n, s );
+
+   return iok;
+}
+
+
+//
+// Function to record the input and the material library and textures of an
+// OBJ file in the output
+//
+
+static int hdfy_RecordSources( struct hdfyPool_s *pool, struct hdfyJob_s *j,
+                               const struct hdfySource_s *in, void *p )
+{
+   struct hdfySource_s *s;
+   struct inObjMaterial_s m;
+   const char *name;
+   char key[256];
+   int k,i,n=1,nm=0,ierr;
+
+   if( p != NULL ) nm = objGetNumMaterials( p );
+   s = (struct hdfySource_s *) malloc( (size_t) ( nm + 2 ) * sizeof(*s) );
+   if( s == NULL ) return 1;
+   s[0] = *in;
+   s[0].path = j->in;
+
+   for(k=-1;k<nm;++k) {
+      if( k < 0 ) {
+         name = ( p != NULL ? objGetMtllibName( p ) : NULL );
+      } else {
+         name = ( objGetMaterial( p, k, &m ) == 0 ? m.map_Kd : NULL );
+      }
+      if( name == NULL || name[0] == '\0' ) continue;
+      for(i=1;i<n && strcmp( s[i].path, name ) != 0;++i) {}
+      if( i < n ) continue;
+
+      s[n].path = (char *) name;
+      if( hdfy_HashFile( name, &( s[n] ) ) ) {
+         s[n].size = -1;
+         s[n].mtime = 0;
+         s[n].hash = 0;
+      }
+      ++n;
+   }
+
+   hdfy_OptionsKey( pool, j, key, sizeof(key) );
+   if( pool->ih5lock ) pthread_mutex_lock( &( pool->h5lock ) );
+   ierr = hdfy_WriteSources( j->out, key, n, s );
+   if( pool->ih5lock ) pthread_mutex_unlock( &( pool->h5lock ) );
+   free( s );
+
+   return ierr;
+}
+
+
+//
+// Function to make the missing directories of the path of a file
+//
+
+static int hdfy_MakeParents( const char *path )
+{
+   char *d,*p;
+   int ierr=0;
+
+   d = strdup( path );
+   if( d == NULL ) return 1;
+   for(p=strchr( d+1, '/' );p!=NULL && ierr==0;p=strchr( p+1, '/' )) {
+      *p = '\0';
+      if( mkdir( d, 0777 ) != 0 && errno != EEXIST ) ierr = 1;
+      *p = '/';
+   }
+   free( d );
+
+   return ierr;
+}
+
+
+//
+// Work of a thread that hashes the input of a job while it is converted, so
+// that the file is read from the disk once
+//
+
+struct hdfyHashRun_s {
+   const char *path;
+   struct hdfySource_s *s;
+   int ierr;
+};
+
+static void* hdfy_HashRun( void *arg )
+{
+   struct hdfyHashRun_s *h = (struct hdfyHashRun_s *) arg;
+
+   h->ierr = hdfy_HashFile( h->path, h->s );
+   return NULL;
+}
+
+
+//
+// Function to convert the file of a job; the parsing is done by the calling
+// thread alone, and the writing holds the library's lock if there is one.
+// Large STL files are streamed instead of read whole. The output is kept
+// when its record of sources matches.
+//
+
+static int hdfy_RunJob( struct hdfyPool_s *pool, struct hdfyJob_s *j )
+#define FUNC "hdfy_RunJob"
+{
+   struct hdfySource_s in;
+   struct hdfyHashRun_s hr;
+   struct inSTLsoa_s soa;
+   struct inSTL_s stl;
+   pthread_t th;
+   void *p = NULL;
+   int itype=1,ierr=0,ihashed=0,ithread=0;
+
+   if( hdfy_StatFile( j->in, &in ) ) {
+      fprintf( stderr, " e [%s]  Could not read \"%s\" \n", FUNC, j->in );
+      return 1;
+   }
+   if( !pool->b->iforce && hdfy_IsUpToDate( pool, j, &in, &ihashed ) ) {
+      j->iskip = 1;
+      return 0;
+   }
+   if( pool->b->outdir != NULL && hdfy_MakeParents( j->out ) ) {
+      fprintf( stderr, " e [%s]  Could not make the directory of \"%s\" \n",
+               FUNC, j->out );
+      return 1;
+   }
+
+   hr.path = j->in;
+   hr.s = &in;
+   hr.ierr = 0;
+   if( !ihashed ) {
+      ithread = ( pthread_create( &th, NULL, hdfy_HashRun, &hr ) == 0 );
+      if( !ithread ) hdfy_HashRun( &hr );
+   }
+
+   if( j->type == HDFY_OBJ ) {
+      p = objReadFileOpts( j->in, ReadMmap, 1 );
+      if( p == NULL ) {
+         ierr = 1;
+      } else {
+         if( pool->ih5lock ) pthread_mutex_lock( &( pool->h5lock ) );
+         ierr = hdfy_WriteObj( p, j->out, &( pool->o ) );
+         if( pool->ih5lock ) pthread_mutex_unlock( &( pool->h5lock ) );
+      }
+   } else if( j->size > HDFY_STREAM_BYTES ) {
+      // the library is busy for as long as the file is read
+      if( pool->ih5lock ) pthread_mutex_lock( &( pool->h5lock ) );
+      ierr = hdfy_ConvertSTL( j->in, j->out, &( pool->o ) );
+      if( pool->ih5lock ) pthread_mutex_unlock( &( pool->h5lock ) );
+   } else {
+      if( j->type == HDFY_STL ) {
+         ierr = inSTL_ProbeSTLfile( j->in, &itype );
+      }
+      if( ierr == 0 && itype == 1 ) {
+         // binary records go straight in to the columns of the file
+         ierr = inSTL_ReadBinarySTLSoA( j->in, &soa, 1 );
+         if( ierr == 0 ) {
+            if( pool->ih5lock ) pthread_mutex_lock( &( pool->h5lock ) );
+            ierr = hdfy_WriteSTLSoA( &soa, j->out, &( pool->o ) );
+            if( pool->ih5lock ) pthread_mutex_unlock( &( pool->h5lock ) );
+         }
+         inSTL_FreeSTLsoa( &soa );
+      } else if( ierr == 0 ) {
+         inSTL_InitSTLfile( &stl );
+         ierr = inSTL_ReadAsciiSTL( j->in, &stl );
+         if( ierr == 0 ) {
+            if( pool->ih5lock ) pthread_mutex_lock( &( pool->h5lock ) );
+            ierr = hdfy_WriteSTL( &stl, j->out, &( pool->o ) );
+            if( pool->ih5lock ) pthread_mutex_unlock( &( pool->h5lock ) );
+         }
+         if( stl.triangles != NULL ) free( stl.triangles );
+      }
+   }
+
+   if( ithread ) pthread_join( th, NULL );
+   if( ierr == 0 && hr.ierr != 0 ) {
+      fprintf( stderr, " e [%s]  Could not hash \"%s\" \n", FUNC, j->in );
+      ierr = 1;
+   }
+   if( ierr == 0 ) ierr = hdfy_RecordSources( pool, j, &in, p );
+   if( p != NULL ) objClear( p );
+
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// Work of a thread of the pool: its own queue from the front, then the backs
+// of the others
+//
+
+struct hdfyWorker_s {
+   struct hdfyPool_s *pool;
+   int iq;
+};
+
+static void* hdfy_Worker( void *arg )
+{
+   struct hdfyWorker_s *w = (struct hdfyWorker_s *) arg;
+   struct hdfyPool_s *pool = w->pool;
+   struct hdfyQueue_s *q;
+   struct hdfyJob_s *j;
+   long ij;
+   int k,istolen;
+
+   while( 1 ) {
+      ij = -1;
+      istolen = 0;
+      q = &( pool->q[ w->iq ] );
+      pthread_mutex_lock( &( q->lock ) );
+      if( q->head < q->tail ) ij = q->idx[ ( q->head )++ ];
+      pthread_mutex_unlock( &( q->lock ) );
+
+      for(k=1;k<pool->nq && ij<0;++k) {
+         q = &( pool->q[ ( w->iq + k ) % pool->nq ] );
+         pthread_mutex_lock( &( q->lock ) );
+         if( q->head < q->tail ) {
+            ij = q->idx[ --( q->tail ) ];
+            istolen = 1;
+         }
+         pthread_mutex_unlock( &( q->lock ) );
+      }
+      // no job is ever added, so empty queues mean the end
+      if( ij < 0 ) break;
+
+      j = &( pool->jobs->job[ij] );
+      j->ierr = hdfy_RunJob( pool, j );
+      if( j->ierr ) {
+         fprintf( stderr, " e [hdfy_Batch]  Failed converting \"%s\" \n",
+                  j->in );
+      }
+
+      pthread_mutex_lock( &( pool->lock ) );
+      pool->nsteal += istolen;
+      ++( pool->ndone );
+      if( pool->b->iverbose ) {
+         fprintf( stderr, " i [hdfy_Batch]  %ld/%ld  %s -> %s%s \n",
+                  pool->ndone, pool->jobs->n, j->in, j->out,
+                  ( j->iskip ? " (up to date)" : "" ) );
+      }
+      pthread_mutex_unlock( &( pool->lock ) );
+   }
+
+   return NULL;
+}
+
+static int hdfy_CompareJobSize( const void *a, const void *b )
+{
+   const struct hdfyJob_s *ja = (const struct hdfyJob_s *) a;
+   const struct hdfyJob_s *jb = (const struct hdfyJob_s *) b;
+
+   return ( ja->size < jb->size ) - ( ja->size > jb->size );
+}
+
+
+//
+// Function to fail the jobs whose outputs would be the same file (the same
+// name with another extension, or the same input twice); none of them is
+// converted, so that none silently replaces another
+//
+
+static int hdfy_CompareJobOut( const void *a, const void *b )
+{
+   const struct hdfyJob_s *ja = *( (const struct hdfyJob_s * const *) a );
+   const struct hdfyJob_s *jb = *( (const struct hdfyJob_s * const *) b );
+
+   return strcmp( ja->out, jb->out );
+}
+
+static int hdfy_FindCollisions( struct hdfyJobList_s *l )
+#define FUNC "hdfy_FindCollisions"
+{
+   struct hdfyJob_s **by;
+   long n,m;
+
+   if( l->n < 2 ) return 0;
+   by = (struct hdfyJob_s **) malloc( (size_t) l->n * sizeof(*by) );
+   if( by == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate the jobs \n", FUNC );
+      return 1;
+   }
+   for(n=0;n<l->n;++n) by[n] = &( l->job[n] );
+   qsort( by, (size_t) l->n, sizeof(*by), hdfy_CompareJobOut );
+
+   for(n=0;n<l->n;n=m) {
+      for(m=n+1;m<l->n && strcmp( by[m]->out, by[n]->out ) == 0;++m) {}
+      if( m - n == 1 ) continue;
+      for(;n<m;++n) {
+         fprintf( stderr, " e [%s]  \"%s\" would also write \"%s\" \n",
+                  FUNC, by[n]->in, by[n]->out );
+         by[n]->ierr = 1;
+      }
+   }
+   free( by );
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to convert all files of the paths and the list files
+//
+
+int hdfy_Batch( int npath, char *paths[], int nlist, char *lists[],
+                const struct hdfyBatchOpts_s *b, const struct hdfyOpts_s *o )
+#define FUNC "hdfy_Batch"
+{
+   struct hdfyBatchOpts_s bd;
+   struct hdfyJobList_s jobs;
+   struct hdfyPool_s pool;
+   struct hdfyWorker_s *w;
+   pthread_t *th;
+   hbool_t its=0;
+   double t0,dt;
+   long n,nq,nfail=0,nskip=0,nin=0,nout=0;
+   int k,nt,ierr=0;
+
+
+   if( b == NULL ) {
+      hdfy_InitBatchOpts( &bd );
+      b = &bd;
+   }
+   t0 = hdfy_Time();
+
+   memset( &jobs, 0, sizeof(jobs) );
+   for(k=0;k<npath;++k) {
+      ierr += hdfy_AddPath( &jobs, paths[k], 0, b->outdir, 0 );
+   }
+   for(k=0;k<nlist;++k) ierr += hdfy_AddList( &jobs, lists[k], b->outdir );
+   if( jobs.n == 0 ) {
+      fprintf( stderr, " e [%s]  Nothing to convert \n", FUNC );
+      free( jobs.job );
+      return 1;
+   }
+   qsort( jobs.job, (size_t) jobs.n, sizeof(struct hdfyJob_s),
+          hdfy_CompareJobSize );
+   ierr += hdfy_FindCollisions( &jobs );
+
+   nt = b->nthreads;
+   if( nt <= 0 ) nt = (int) sysconf( _SC_NPROCESSORS_ONLN );
+   if( nt < 1 ) nt = 1;
+   if( nt > jobs.n ) nt = (int) jobs.n;
+
+   // every job gets one thread; the pool is the parallelism
+   memset( &pool, 0, sizeof(pool) );
+   pool.jobs = &jobs;
+   pool.nq = nt;
+   pool.b = b;
+   if( o == NULL ) {
+      hdfy_InitOpts( &( pool.o ) );
+   } else {
+      pool.o = *o;
+   }
+   pool.o.nthreads = 1;
+   H5is_library_threadsafe( &its );
+   pool.ih5lock = ( its ? 0 : 1 );
+   pthread_mutex_init( &( pool.h5lock ), NULL );
+   pthread_mutex_init( &( pool.lock ), NULL );
+
+   pool.q = (struct hdfyQueue_s *) calloc( (size_t) nt, sizeof(*pool.q) );
+   w = (struct hdfyWorker_s *) malloc( (size_t) nt * sizeof(*w) );
+   th = (pthread_t *) malloc( (size_t) nt * sizeof(pthread_t) );
+   if( pool.q == NULL || w == NULL || th == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate the pool \n", FUNC );
+      ierr = 1;
+      nt = 0;
+   }
+   for(k=0;k<nt;++k) {
+      pool.q[k].idx = (long *) malloc( (size_t) ( jobs.n / nt + 1 ) *
+                                       sizeof(long) );
+      pthread_mutex_init( &( pool.q[k].lock ), NULL );
+   }
+   // deal largest first, round robin; jobs that failed already are not run
+   for(nq=0,n=0;n<jobs.n && nt>0;++n) {
+      struct hdfyQueue_s *q = &( pool.q[ nq % nt ] );
+      if( jobs.job[n].ierr ) continue;
+      q->idx[ ( q->tail )++ ] = n;
+      ++nq;
+   }
+
+   for(k=0;k<nt;++k) {
+      w[k].pool = &pool;
+      w[k].iq = k;
+      pthread_create( &( th[k] ), NULL, hdfy_Worker, &( w[k] ) );
+   }
+   for(k=0;k<nt;++k) pthread_join( th[k], NULL );
+   dt = hdfy_Time() - t0;
+
+   for(n=0;n<jobs.n;++n) {
+      struct stat st;
+      if( jobs.job[n].ierr ) {
+         ++nfail;
+      } else if( jobs.job[n].iskip ) {
+         ++nskip;
+      } else {
+         nin += jobs.job[n].size;
+         if( stat( jobs.job[n].out, &st ) == 0 ) nout += (long) st.st_size;
+      }
+   }
+   fprintf( stderr, " i [%s]  %ld files (%ld failed, %ld up to date) with "
+            "%d threads in %.3f s: %.1f files/s, %.1f MB/s in, %.1f MB in, "
+            "%.1f MB out, %ld stolen%s \n", FUNC, jobs.n, nfail, nskip, nt, dt,
+            (double) jobs.n / dt, 1.0e-6 * (double) nin / dt,
+            1.0e-6 * (double) nin, 1.0e-6 * (double) nout, pool.nsteal,
+            ( pool.ih5lock ? "; writes one at a time" : "" ) );
+
+   for(k=0;k<nt;++k) {
+      free( pool.q[k].idx );
+      pthread_mutex_destroy( &( pool.q[k].lock ) );
+   }
+   if( pool.q != NULL ) free( pool.q );
+   if( w != NULL ) free( w );
+   if( th != NULL ) free( th );
+   pthread_mutex_destroy( &( pool.lock ) );
+   pthread_mutex_destroy( &( pool.h5lock ) );
+   for(n=0;n<jobs.n;++n) {
+      free( jobs.job[n].in );
+      free( jobs.job[n].out );
+   }
+   free( jobs.job );
+
+   return ( ierr || nfail ? 2 : 0 );
+}
+#undef FUNC
@@ -0,0 +1,77 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#ifndef _HDFY_BATCH_H_
+#define _HDFY_BATCH_H_
+
+#include "hdfy.h"
+
+//
+// Batch conversion of many OBJ and STL files. The inputs are files, files
+// listed one per line in list files, and directories (searched recursively
+// for *.obj and *.stl); the format of a named file is taken from its name or
+// else from its contents. Jobs are dealt largest first, round robin, to the
+// queues of a pool of threads; a thread takes the largest job of its own
+// queue and, when that is empty, steals the smallest job of another, so the
+// big meshes start early and the small ones fill the gaps at the end.
+// Parsing runs concurrently; unless the HDF5 library was built thread-safe
+// the writing of the files is done one at a time. An output whose recorded
+// sources (input, material library, textures) and options are unchanged is
+// kept.
+//
+
+// options of a batch
+struct hdfyBatchOpts_s {
+   int nthreads;           // threads of the pool; zero for all cores
+   const char *outdir;     // directory of the outputs, where the files
+                           // under a named directory keep their
+                           // subdirectories; NULL for next to the inputs
+                           // (the extension is replaced by ".h5")
+   int iverbose;           // report every file
+   int iforce;             // convert even the files whose outputs are up
+                           // to date (see hdfy_cache.h)
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void hdfy_InitBatchOpts( struct hdfyBatchOpts_s *b );
+
+int hdfy_Batch( int npath, char *paths[], int nlist, char *lists[],
+                const struct hdfyBatchOpts_s *b, const struct hdfyOpts_s *o );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
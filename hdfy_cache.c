@@ -0,0 +1,386 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "hdfy_cache.h"
+
+#define HDFY_P1  0x9E3779B185EBCA87ULL
+#define HDFY_P2  0xC2B2AE3D27D4EB4FULL
+#define HDFY_P3  0x165667B19E3779F9ULL
+#define HDFY_P4  0x85EBCA77C2B2AE63ULL
+#define HDFY_P5  0x27D4EB2F165667C5ULL
+
+#define HDFY_ROTL( x, r )  ( ( (x) << (r) ) | ( (x) >> ( 64 - (r) ) ) )
+
+// the row of the "sources" table in memory
+struct hdfySourceRow_s {
+   char *path;
+   long long size;
+   long long mtime;
+   unsigned long long hash;
+};
+
+// state of a streamed XXH64; "mem" holds the tail of a partial stripe
+struct hdfyHash_s {
+   uint64_t v[4];
+   uint64_t total;
+   unsigned char mem[32];
+   unsigned int nmem;
+};
+
+static uint64_t hdfy_Read64( const unsigned char *p )
+{
+   uint64_t x;
+
+   memcpy( &x, p, 8 );     // the hash is defined on little endian words
+   return x;
+}
+
+static uint64_t hdfy_HashRound( uint64_t acc, uint64_t x )
+{
+   acc += x * HDFY_P2;
+   acc = HDFY_ROTL( acc, 31 );
+   return acc * HDFY_P1;
+}
+
+static uint64_t hdfy_HashMerge( uint64_t h, uint64_t v )
+{
+   h ^= hdfy_HashRound( 0, v );
+   return h * HDFY_P1 + HDFY_P4;
+}
+
+static void hdfy_HashInit( struct hdfyHash_s *h )
+{
+   h->v[0] = HDFY_P1 + HDFY_P2;
+   h->v[1] = HDFY_P2;
+   h->v[2] = 0;
+   h->v[3] = 0 - HDFY_P1;
+   h->total = 0;
+   h->nmem = 0;
+}
+
+static void hdfy_HashUpdate( struct hdfyHash_s *h,
+                             const unsigned char *p, size_t n )
+{
+   const unsigned char *e = p + n;
+   unsigned int k;
+
+   h->total += (uint64_t) n;
+   if( h->nmem + n < 32 ) {
+      memcpy( h->mem + h->nmem, p, n );
+      h->nmem += (unsigned int) n;
+      return;
+   }
+   if( h->nmem > 0 ) {
+      k = 32 - h->nmem;
+      memcpy( h->mem + h->nmem, p, k );
+      p += k;
+      for(k=0;k<4;++k) h->v[k] = hdfy_HashRound( h->v[k],
+                                                 hdfy_Read64( h->mem + 8*k ) );
+      h->nmem = 0;
+   }
+   while( p + 32 <= e ) {
+      h->v[0] = hdfy_HashRound( h->v[0], hdfy_Read64( p      ) );
+      h->v[1] = hdfy_HashRound( h->v[1], hdfy_Read64( p +  8 ) );
+      h->v[2] = hdfy_HashRound( h->v[2], hdfy_Read64( p + 16 ) );
+      h->v[3] = hdfy_HashRound( h->v[3], hdfy_Read64( p + 24 ) );
+      p += 32;
+   }
+   if( p < e ) {
+      memcpy( h->mem, p, (size_t) ( e - p ) );
+      h->nmem = (unsigned int) ( e - p );
+   }
+}
+
+static uint64_t hdfy_HashDigest( const struct hdfyHash_s *h )
+{
+   const unsigned char *p = h->mem, *e = h->mem + h->nmem;
+   uint64_t x;
+   uint32_t w;
+   int k;
+
+   if( h->total >= 32 ) {
+      x = HDFY_ROTL( h->v[0], 1 ) + HDFY_ROTL( h->v[1], 7 ) +
+          HDFY_ROTL( h->v[2], 12 ) + HDFY_ROTL( h->v[3], 18 );
+      for(k=0;k<4;++k) x = hdfy_HashMerge( x, h->v[k] );
+   } else {
+      x = h->v[2] + HDFY_P5;
+   }
+   x += h->total;
+
+   while( p + 8 <= e ) {
+      x ^= hdfy_HashRound( 0, hdfy_Read64( p ) );
+      x = HDFY_ROTL( x, 27 ) * HDFY_P1 + HDFY_P4;
+      p += 8;
+   }
+   if( p + 4 <= e ) {
+      memcpy( &w, p, 4 );
+      x ^= (uint64_t) w * HDFY_P1;
+      x = HDFY_ROTL( x, 23 ) * HDFY_P2 + HDFY_P3;
+      p += 4;
+   }
+   while( p < e ) {
+      x ^= (uint64_t) ( *p ) * HDFY_P5;
+      x = HDFY_ROTL( x, 11 ) * HDFY_P1;
+      ++p;
+   }
+
+   x ^= x >> 33;
+   x *= HDFY_P2;
+   x ^= x >> 29;
+   x *= HDFY_P3;
+   x ^= x >> 32;
+   return x;
+}
+
+
+//
+// Function to fill the record of a file: its size and time from the file
+// system, and the hash of its contents read in 1 MB blocks
+//
+
+int hdfy_HashFile( const char *path, struct hdfySource_s *s )
+#define FUNC "hdfy_HashFile"
+{
+   struct hdfyHash_s h;
+   struct stat st;
+   unsigned char *buf;
+   ssize_t n;
+   int fd,ierr=0;
+
+   fd = open( path, O_RDONLY );
+   if( fd < 0 ) return 1;
+   if( fstat( fd, &st ) != 0 ) {
+      close( fd );
+      return 1;
+   }
+   buf = (unsigned char *) malloc( 1024*1024 );
+   if( buf == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate buffer \n", FUNC );
+      close( fd );
+      return 1;
+   }
+#ifdef POSIX_FADV_SEQUENTIAL
+   posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+
+   hdfy_HashInit( &h );
+   while( ( n = read( fd, buf, 1024*1024 ) ) > 0 ) {
+      hdfy_HashUpdate( &h, buf, (size_t) n );
+   }
+   if( n < 0 ) {
+      fprintf( stderr, " e [%s]  Failed reading \"%s\" \n", FUNC, path );
+      ierr = 1;
+   }
+   free( buf );
+   close( fd );
+
+   s->size = (long long) st.st_size;
+   s->mtime = (long long) st.st_mtime;
+   s->hash = (unsigned long long) hdfy_HashDigest( &h );
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// Function to fill the size and time of the record of a file, without its
+// hash; a missing file returns non-zero
+//
+
+int hdfy_StatFile( const char *path, struct hdfySource_s *s )
+{
+   struct stat st;
+
+   if( stat( path, &st ) != 0 ) return 1;
+   s->size = (long long) st.st_size;
+   s->mtime = (long long) st.st_mtime;
+   s->hash = 0;
+   return 0;
+}
+
+
+static hid_t hdfy_SourceType( void )
+{
+   hid_t tid,sid;
+
+   sid = H5Tcopy( H5T_C_S1 );
+   H5Tset_size( sid, H5T_VARIABLE );
+   tid = H5Tcreate( H5T_COMPOUND, sizeof(struct hdfySourceRow_s) );
+   H5Tinsert( tid, "path", HOFFSET( struct hdfySourceRow_s, path ), sid );
+   H5Tinsert( tid, "size", HOFFSET( struct hdfySourceRow_s, size ),
+              H5T_NATIVE_LLONG );
+   H5Tinsert( tid, "mtime", HOFFSET( struct hdfySourceRow_s, mtime ),
+              H5T_NATIVE_LLONG );
+   H5Tinsert( tid, "hash", HOFFSET( struct hdfySourceRow_s, hash ),
+              H5T_NATIVE_ULLONG );
+   H5Tclose( sid );
+
+   return tid;
+}
+
+
+//
+// Function to store the records of the sources in an existing HDF5 file,
+// with the text "options" that describes the settings of the conversion
+// (attribute "options"); the records replace any already there
+//
+
+int hdfy_WriteSources( const char *filename, const char *options,
+                       int n, const struct hdfySource_s *s )
+#define FUNC "hdfy_WriteSources"
+{
+   struct hdfySourceRow_s *r;
+   hid_t fid,tid,sid,aid;
+   hsize_t dims[1];
+   int k,ierr=0;
+
+   if( n <= 0 ) return 0;
+   r = (struct hdfySourceRow_s *) malloc( (size_t) n * sizeof(*r) );
+   if( r == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate rows \n", FUNC );
+      return 1;
+   }
+   for(k=0;k<n;++k) {
+      r[k].path = s[k].path;
+      r[k].size = s[k].size;
+      r[k].mtime = s[k].mtime;
+      r[k].hash = s[k].hash;
+   }
+
+   fid = H5Fopen( filename, H5F_ACC_RDWR, H5P_DEFAULT );
+   if( fid < 0 ) {
+      fprintf( stderr, " e [%s]  Could not open \"%s\" \n", FUNC, filename );
+      free( r );
+      return 1;
+   }
+   if( H5Aexists( fid, "sources" ) > 0 ) H5Adelete( fid, "sources" );
+   if( H5Aexists( fid, "options" ) > 0 ) H5Adelete( fid, "options" );
+   if( options != NULL && hdfy_WriteAttrString( fid, "options", options ) ) {
+      fprintf( stderr, " e [%s]  Could not write the options \n", FUNC );
+      ierr = 1;
+   }
+
+   dims[0] = (hsize_t) n;
+   tid = hdfy_SourceType();
+   sid = H5Screate_simple( 1, dims, NULL );
+   aid = H5Acreate2( fid, "sources", tid, sid, H5P_DEFAULT, H5P_DEFAULT );
+   if( aid < 0 || H5Awrite( aid, tid, r ) < 0 ) {
+      fprintf( stderr, " e [%s]  Could not write the sources \n", FUNC );
+      ierr = 1;
+   }
+   if( aid >= 0 ) H5Aclose( aid );
+   H5Sclose( sid );
+   H5Tclose( tid );
+   H5Fclose( fid );
+   free( r );
+
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// Function to read the records of the sources of an HDF5 file and the text
+// of its options (NULL when there is none; to be freed); a missing file or
+// a file without records returns non-zero quietly
+//
+
+int hdfy_ReadSources( const char *filename, char **options,
+                      int *n, struct hdfySource_s **s )
+{
+   struct hdfySourceRow_s *r = NULL;
+   hid_t fid=-1,tid,sid,aid=-1;
+   hssize_t m=0;
+   int k,ierr=1;
+
+   *n = 0;
+   *s = NULL;
+   *options = NULL;
+
+   H5E_BEGIN_TRY {
+      fid = H5Fopen( filename, H5F_ACC_RDONLY, H5P_DEFAULT );
+      if( fid >= 0 ) aid = H5Aopen( fid, "sources", H5P_DEFAULT );
+   } H5E_END_TRY;
+   if( aid < 0 ) {
+      if( fid >= 0 ) H5Fclose( fid );
+      return 1;
+   }
+
+   tid = hdfy_SourceType();
+   sid = H5Aget_space( aid );
+   m = H5Sget_simple_extent_npoints( sid );
+   if( m > 0 ) r = (struct hdfySourceRow_s *) malloc( (size_t) m * sizeof(*r) );
+   if( r != NULL ) *s = (struct hdfySource_s *) calloc( (size_t) m,
+                                                        sizeof(**s) );
+   if( *s != NULL && H5Aread( aid, tid, r ) >= 0 ) {
+      ierr = 0;
+      for(k=0;k<(int) m;++k) {
+         (*s)[k].path = strdup( r[k].path != NULL ? r[k].path : "" );
+         (*s)[k].size = r[k].size;
+         (*s)[k].mtime = r[k].mtime;
+         (*s)[k].hash = r[k].hash;
+         if( (*s)[k].path == NULL ) ierr = 1;
+      }
+      H5Dvlen_reclaim( tid, sid, H5P_DEFAULT, r );
+      *n = (int) m;
+   }
+   H5Sclose( sid );
+   H5Tclose( tid );
+   H5Aclose( aid );
+   if( ierr == 0 ) *options = hdfy_ReadAttrString( fid, "options" );
+   H5Fclose( fid );
+   if( r != NULL ) free( r );
+
+   if( ierr ) {
+      hdfy_FreeSources( *n, *s );
+      *n = 0;
+      *s = NULL;
+   }
+   return ierr;
+}
+
+void hdfy_FreeSources( int n, struct hdfySource_s *s )
+{
+   int k;
+
+   if( s == NULL ) return;
+   for(k=0;k<n;++k) if( s[k].path != NULL ) free( s[k].path );
+   free( s );
+}
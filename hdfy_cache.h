@@ -0,0 +1,77 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#ifndef _HDFY_CACHE_H_
+#define _HDFY_CACHE_H_
+
+#include "hdfy.h"
+
+//
+// Records of the files an HDF5 file was converted from. The attribute
+// "sources" of the root group is a table of the path, size, modification
+// time and 64-bit content hash of the input (the first row) and of the files
+// it pulled in (material libraries, textures). A converter that finds all of
+// them unchanged can keep the output, provided that it was also made with
+// the same settings; those are kept as text in the attribute "options". The
+// hash is XXH64 (seed zero) and is computed streaming the file in large
+// blocks; a file whose size and time match its record is taken as it is
+// without hashing it.
+//
+
+struct hdfySource_s {
+   char *path;
+   long long size;
+   long long mtime;        // seconds since the epoch
+   unsigned long long hash;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int hdfy_HashFile( const char *path, struct hdfySource_s *s );
+
+int hdfy_StatFile( const char *path, struct hdfySource_s *s );
+
+int hdfy_WriteSources( const char *filename, const char *options,
+                       int n, const struct hdfySource_s *s );
+
+int hdfy_ReadSources( const char *filename, char **options,
+                      int *n, struct hdfySource_s **s );
+
+void hdfy_FreeSources( int n, struct hdfySource_s *s );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
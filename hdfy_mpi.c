@@ -0,0 +1,671 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "hdfy_mpi.h"
+
+#ifndef H5_HAVE_PARALLEL
+#error "The MPI writers need an HDF5 library built for parallel I/O"
+#endif
+
+// records of the tables are laid out at run time, because the strings in
+// them are as long as the longest one of the file
+#define HDFY_ALIGN8( n )  ( ( (n) + 7 ) & ~( (size_t) 7 ) )
+
+
+//
+// Function to find whether any of the processes failed, so that all of them
+// leave the collective calls together
+//
+
+static int hdfy_AnyError( MPI_Comm comm, int ierr )
+{
+   int iall=0;
+
+   MPI_Allreduce( &ierr, &iall, 1, MPI_INT, MPI_MAX, comm );
+
+   return iall;
+}
+
+
+//
+// Function to create the shared file; all processes call it
+//
+
+static hid_t hdfy_CreateFileMPI( MPI_Comm comm, const char *filename,
+                                 const char *format )
+#define FUNC "hdfy_CreateFileMPI"
+{
+   hid_t pid,fid;
+   int irank;
+
+   MPI_Comm_rank( comm, &irank );
+
+   pid = H5Pcreate( H5P_FILE_ACCESS );
+   H5Pset_fapl_mpio( pid, comm, MPI_INFO_NULL );
+   fid = H5Fcreate( filename, H5F_ACC_TRUNC, H5P_DEFAULT, pid );
+   H5Pclose( pid );
+   if( fid < 0 ) {
+      if( irank == 0 ) fprintf( stderr, " e [%s]  Could not create file: "
+                                "\"%s\"\n", FUNC, filename );
+      return -1;
+   } else {
+      if( irank == 0 ) fprintf( stderr, " i [%s]  Writing file: \"%s\"\n",
+                                FUNC, filename );
+   }
+
+   if( format != NULL ) hdfy_WriteAttrString( fid, "format", format );
+
+   return fid;
+}
+#undef FUNC
+
+
+//
+// Function to create a dataset of the global size and write the rows of
+// this process at "row0" in a collective transfer
+//
+
+static int hdfy_WriteSlabMPI( hid_t loc, const char *name, hid_t ftype,
+                              hid_t mtype, hsize_t nrow, hsize_t ncol,
+                              hsize_t row0, hsize_t nloc,
+                              const void *base, size_t stride,
+                              const struct hdfyOpts_s *o, hid_t dxpl )
+#define FUNC "hdfy_WriteSlabMPI"
+{
+   hid_t did;
+   int ierr;
+
+   did = hdfy_CreateArray( loc, name, ftype, nrow, ncol, o );
+   if( did < 0 ) return 1;
+   if( nrow == 0 ) {
+      H5Dclose( did );
+      return 0;
+   }
+
+   ierr = hdfy_WriteSlab( did, mtype, row0, nloc, ncol, base, stride, dxpl );
+   H5Dclose( did );
+   if( ierr ) {
+      fprintf( stderr, " e [%s]  Could not write \"%s\" \n", FUNC, name );
+   }
+
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// Function to write the group table; every process writes its own groups,
+// and a group that runs in to the following slices ends where the next
+// group of any process starts
+//
+
+static int hdfy_WriteObjGroupsMPI( MPI_Comm comm, hid_t fid, void *p,
+                                   long gbase, long ngtot, long nftot,
+                                   hid_t dxpl )
+#define FUNC "hdfy_WriteObjGroupsMPI"
+{
+   long *first,fnext=nftot,lname=1,l;
+   size_t ofs,rec;
+   char *g=NULL;
+   hid_t sid,tid,mid,fmid,did;
+   int irank,nrank,ng,n,is,ie,ierr=0;
+
+   MPI_Comm_rank( comm, &irank );
+   MPI_Comm_size( comm, &nrank );
+   ng = (int) objGetNumGroups( p );
+
+   // start of the first group of every process (or none)
+   first = (long *) malloc( ( (size_t) nrank ) * sizeof(long) );
+   if( first == NULL ) ierr = 1;
+   if( hdfy_AnyError( comm, ierr ) ) {
+      if( first != NULL ) free( first );
+      return 1;
+   }
+   is = -1;
+   if( ng > 0 ) objGetGroupBounds( p, 0, &is, &ie );
+   l = (long) is;
+   MPI_Allgather( &l, 1, MPI_LONG, first, 1, MPI_LONG, comm );
+   for(n=nrank-1;n>irank;--n) if( first[n] >= 0 ) fnext = first[n];
+   free( first );
+
+   for(n=0;n<ng;++n) {
+      l = (long) strlen( objGetGroupName( p, (short) n ) ) + 1;
+      if( l > lname ) lname = l;
+   }
+   MPI_Allreduce( MPI_IN_PLACE, &lname, 1, MPI_LONG, MPI_MAX, comm );
+
+   ofs = HDFY_ALIGN8( (size_t) lname );
+   rec = ofs + 2*sizeof(long);
+   g = (char *) calloc( (size_t) ( ng + 1 ), rec );
+   if( g == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate group table \n", FUNC );
+      ierr = 1;
+   }
+   if( hdfy_AnyError( comm, ierr ) ) {
+      if( g != NULL ) free( g );
+      return 1;
+   }
+   for(n=0;n<ng;++n) {
+      char *r = g + ( (size_t) n ) * rec;
+      long fs,fe;
+      objGetGroupBounds( p, (short) n, &is, &ie );
+      fs = (long) is;
+      fe = ( n == ng-1 ? fnext : (long) ie );
+      strcpy( r, objGetGroupName( p, (short) n ) );
+      memcpy( r + ofs, &fs, sizeof(long) );
+      memcpy( r + ofs + sizeof(long), &fe, sizeof(long) );
+   }
+
+   tid = H5Tcopy( H5T_C_S1 );
+   H5Tset_size( tid, (size_t) lname );
+   mid = H5Tcreate( H5T_COMPOUND, rec );
+   H5Tinsert( mid, "name", 0, tid );
+   H5Tinsert( mid, "face_start", ofs, H5T_NATIVE_LONG );
+   H5Tinsert( mid, "face_end", ofs + sizeof(long), H5T_NATIVE_LONG );
+   fmid = H5Tcopy( mid );
+   H5Tpack( fmid );
+
+   {
+      hsize_t dims = (hsize_t) ngtot;
+      sid = H5Screate_simple( 1, &dims, NULL );
+   }
+   did = H5Dcreate2( fid, "groups", fmid, sid,
+                     H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+   if( did < 0 ) {
+      ierr = 2;
+   } else {
+      if( ngtot > 0 ) {
+         ierr = hdfy_WriteSlab( did, mid, (hsize_t) gbase, (hsize_t) ng, 0,
+                                g, rec, dxpl );
+      }
+      H5Dclose( did );
+   }
+   H5Sclose( sid );
+   H5Tclose( fmid );
+   H5Tclose( mid );
+   H5Tclose( tid );
+   free( g );
+
+   if( ierr ) {
+      fprintf( stderr, " e [%s]  Could not write the groups \n", FUNC );
+      return 2;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to write the material table; all processes have loaded the same
+// library and the first one writes it
+//
+
+static int hdfy_WriteObjMaterialsMPI( MPI_Comm comm, hid_t fid, void *p,
+                                      hid_t dxpl )
+#define FUNC "hdfy_WriteObjMaterialsMPI"
+{
+   struct inObjMaterial_s mtl;
+   size_t lname=1,l,ofs,rec;
+   char *m;
+   hid_t sid,tid,aid,mid,fmid,did;
+   hsize_t nm,n3=3;
+   int irank,n,ierr=0;
+
+   MPI_Comm_rank( comm, &irank );
+   nm = (hsize_t) objGetNumMaterials( p );
+
+   for(n=0;n<(int) nm;++n) {
+      objGetMaterial( p, n, &mtl );
+      l = strlen( mtl.name ) + 1;
+      if( l > lname ) lname = l;
+      l = strlen( mtl.map_Kd ) + 1;
+      if( l > lname ) lname = l;
+   }
+
+   // name, Ka, Kd, Ks, Ns, Ni, d, illum, map_Kd
+   ofs = HDFY_ALIGN8( lname );
+   rec = ofs + 13*sizeof(float) + HDFY_ALIGN8( lname );
+   m = (char *) calloc( (size_t) ( nm + 1 ), rec );
+   if( m == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate material table \n", FUNC);
+      ierr = 1;
+   }
+   if( hdfy_AnyError( comm, ierr ) ) {
+      if( m != NULL ) free( m );
+      return 1;
+   }
+   for(n=0;n<(int) nm;++n) {
+      char *r = m + ( (size_t) n ) * rec;
+      objGetMaterial( p, n, &mtl );
+      strcpy( r, mtl.name );
+      memcpy( r + ofs, mtl.Ka, 3*sizeof(float) );
+      memcpy( r + ofs + 3*sizeof(float), mtl.Kd, 3*sizeof(float) );
+      memcpy( r + ofs + 6*sizeof(float), mtl.Ks, 3*sizeof(float) );
+      memcpy( r + ofs + 9*sizeof(float), &( mtl.Ns ), sizeof(float) );
+      memcpy( r + ofs + 10*sizeof(float), &( mtl.Ni ), sizeof(float) );
+      memcpy( r + ofs + 11*sizeof(float), &( mtl.d ), sizeof(float) );
+      memcpy( r + ofs + 12*sizeof(float), &( mtl.illum ), sizeof(int) );
+      strcpy( r + ofs + 13*sizeof(float), mtl.map_Kd );
+   }
+
+   tid = H5Tcopy( H5T_C_S1 );
+   H5Tset_size( tid, lname );
+   aid = H5Tarray_create2( H5T_NATIVE_FLOAT, 1, &n3 );
+   mid = H5Tcreate( H5T_COMPOUND, rec );
+   H5Tinsert( mid, "name", 0, tid );
+   H5Tinsert( mid, "Ka", ofs, aid );
+   H5Tinsert( mid, "Kd", ofs + 3*sizeof(float), aid );
+   H5Tinsert( mid, "Ks", ofs + 6*sizeof(float), aid );
+   H5Tinsert( mid, "Ns", ofs + 9*sizeof(float), H5T_NATIVE_FLOAT );
+   H5Tinsert( mid, "Ni", ofs + 10*sizeof(float), H5T_NATIVE_FLOAT );
+   H5Tinsert( mid, "d", ofs + 11*sizeof(float), H5T_NATIVE_FLOAT );
+   H5Tinsert( mid, "illum", ofs + 12*sizeof(float), H5T_NATIVE_INT );
+   H5Tinsert( mid, "map_Kd", ofs + 13*sizeof(float), tid );
+   fmid = H5Tcopy( mid );
+   H5Tpack( fmid );
+
+   sid = H5Screate_simple( 1, &nm, NULL );
+   did = H5Dcreate2( fid, "materials", fmid, sid,
+                     H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+   if( did < 0 ) {
+      ierr = 2;
+   } else {
+      if( nm > 0 ) {
+         ierr = hdfy_WriteSlab( did, mid, 0, ( irank == 0 ? nm : 0 ), 0,
+                                m, rec, dxpl );
+      }
+      H5Dclose( did );
+   }
+   H5Sclose( sid );
+   H5Tclose( fmid );
+   H5Tclose( mid );
+   H5Tclose( aid );
+   H5Tclose( tid );
+   free( m );
+
+   if( ierr ) {
+      fprintf( stderr, " e [%s]  Could not write the materials \n", FUNC );
+      return 2;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to give the material library of the file to all processes; the
+// "mtllib" statement was seen by whichever process read that part of the
+// file, and the lowest such process passes its name on
+//
+
+static int hdfy_ShareMtllibMPI( MPI_Comm comm, void *p )
+{
+   const char *name = objGetMtllibName( p );
+   char *buf;
+   int irank,nrank,iown,n=0;
+
+   MPI_Comm_rank( comm, &irank );
+   MPI_Comm_size( comm, &nrank );
+
+   iown = ( name != NULL && name[0] != '\0' ? irank : nrank );
+   MPI_Allreduce( MPI_IN_PLACE, &iown, 1, MPI_INT, MPI_MIN, comm );
+   if( iown == nrank ) return 0;
+
+   if( irank == iown ) n = (int) strlen( name ) + 1;
+   MPI_Bcast( &n, 1, MPI_INT, iown, comm );
+   buf = (char *) malloc( (size_t) n );
+   if( hdfy_AnyError( comm, ( buf == NULL ) ) ) {
+      if( buf != NULL ) free( buf );
+      return 1;
+   }
+   if( irank == iown ) memcpy( buf, name, (size_t) n );
+   MPI_Bcast( buf, n, MPI_CHAR, iown, comm );
+
+   n = objLoadMtllib( p, buf );
+   free( buf );
+
+   return hdfy_AnyError( comm, n );
+}
+
+
+//
+// Function to convert an OBJ file to an HDF5 file with all processes of
+// the communicator; each one parses a slice of the file
+//
+
+int hdfy_WriteObjMPI( MPI_Comm comm, const char *objfile,
+                      const char *filename, const struct hdfyOpts_s *o )
+#define FUNC "hdfy_WriteObjMPI"
+{
+   struct hdfyOpts_s od;
+   struct inObjCounts_s c,b;
+   const float *v,*vn,*vt;
+   const inObjIdx_t *icsr,*jv,*jt,*jn;
+   inObjIdx_t izero=0;
+   long lc[6],lb[6],lt[6],nv,nn,nt,nf,nc;
+   hid_t fid,gid,pid,itype,ftype;
+   void *p;
+   int irank,nrank,ierr=0;
+
+
+   if( objfile == NULL || filename == NULL ) return 1;
+   MPI_Comm_rank( comm, &irank );
+   MPI_Comm_size( comm, &nrank );
+
+   if( o == NULL ) {
+      hdfy_InitOpts( &od );
+   } else {
+      od = *o;
+   }
+   od.itune = 0;
+   od.inbit = 0;
+
+   p = objReadSlice( objfile, irank, nrank );
+   if( hdfy_AnyError( comm, ( p == NULL ) ) ) {
+      if( p != NULL ) objClear( p );
+      return 2;
+   }
+
+   // offsets of this slice in the whole file's arrays
+   objGetCounts( p, &c );
+   lc[0] = c.nvertex;
+   lc[1] = c.ntexel;
+   lc[2] = c.nnormal;
+   lc[3] = c.nface;
+   lc[4] = c.ncorner;
+   lc[5] = c.ngroup;
+   memset( lb, 0, sizeof(lb) );
+   MPI_Exscan( lc, lb, 6, MPI_LONG, MPI_SUM, comm );
+   if( irank == 0 ) memset( lb, 0, sizeof(lb) );
+   MPI_Allreduce( lc, lt, 6, MPI_LONG, MPI_SUM, comm );
+   b.nvertex = lb[0];
+   b.ntexel = lb[1];
+   b.nnormal = lb[2];
+   b.nface = lb[3];
+   b.ncorner = lb[4];
+   b.ngroup = lb[5];
+
+   ierr = objResolveSlice( p, &b );
+   ierr = hdfy_AnyError( comm, ierr );
+   if( ierr == 0 ) ierr = hdfy_ShareMtllibMPI( comm, p );
+   if( ierr ) {
+      if( irank == 0 ) fprintf( stderr, " e [%s]  Could not read file: "
+                                "\"%s\"\n", FUNC, objfile );
+      objClear( p );
+      return 2;
+   }
+
+   v = objGetVertices( p, &nv );
+   vn = objGetNormals( p, &nn );
+   vt = objGetTexels( p, &nt );
+   icsr = objGetFaceOffsets( p, &nf );
+   jv = objGetFaceVertexIndices( p, &nc );
+   jt = objGetFaceTexelIndices( p, &nc );
+   jn = objGetFaceNormalIndices( p, &nc );
+   if( icsr == NULL ) icsr = &izero;
+
+   if( sizeof(inObjIdx_t) == 8 ) {
+      itype = H5T_NATIVE_UINT64;
+      ftype = H5T_STD_U64LE;
+   } else {
+      itype = H5T_NATIVE_UINT32;
+      ftype = H5T_STD_U32LE;
+   }
+
+   fid = hdfy_CreateFileMPI( comm, filename, "obj" );
+   if( fid < 0 ) {
+      objClear( p );
+      return 3;
+   }
+   pid = H5Pcreate( H5P_DATASET_XFER );
+   H5Pset_dxpl_mpio( pid, H5FD_MPIO_COLLECTIVE );
+
+   ierr += hdfy_WriteSlabMPI( fid, "vertices", H5T_IEEE_F32LE,
+                              H5T_NATIVE_FLOAT, (hsize_t) lt[0], 3,
+                              (hsize_t) b.nvertex, (hsize_t) nv,
+                              v, 3*sizeof(float), &od, pid );
+   ierr += hdfy_WriteSlabMPI( fid, "normals", H5T_IEEE_F32LE,
+                              H5T_NATIVE_FLOAT, (hsize_t) lt[2], 3,
+                              (hsize_t) b.nnormal, (hsize_t) nn,
+                              vn, 3*sizeof(float), &od, pid );
+   ierr += hdfy_WriteSlabMPI( fid, "texels", H5T_IEEE_F32LE,
+                              H5T_NATIVE_FLOAT, (hsize_t) lt[1], 2,
+                              (hsize_t) b.ntexel, (hsize_t) nt,
+                              vt, 2*sizeof(float), &od, pid );
+
+   gid = H5Gcreate2( fid, "faces", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+   if( gid < 0 ) {
+      ierr += 1;
+   } else {
+      // the first process writes the leading zero offset (also of a mesh
+      // without faces), and each one writes the offsets that close its faces
+      hsize_t nof = (hsize_t) ( lt[3] + 1 );
+      ierr += hdfy_WriteAttrInt( gid, "count", lt[3] );
+      if( irank == 0 ) {
+         ierr += hdfy_WriteSlabMPI( gid, "offsets", ftype, itype, nof, 0,
+                                    0, (hsize_t) ( nf + 1 ),
+                                    icsr, sizeof(inObjIdx_t), &od, pid );
+      } else {
+         ierr += hdfy_WriteSlabMPI( gid, "offsets", ftype, itype, nof, 0,
+                                    (hsize_t) ( b.nface + 1 ), (hsize_t) nf,
+                                    icsr + 1, sizeof(inObjIdx_t), &od, pid );
+      }
+      ierr += hdfy_WriteSlabMPI( gid, "v", ftype, itype, (hsize_t) lt[4], 0,
+                                 (hsize_t) b.ncorner, (hsize_t) nc,
+                                 jv, sizeof(inObjIdx_t), &od, pid );
+      ierr += hdfy_WriteSlabMPI( gid, "vt", ftype, itype, (hsize_t) lt[4], 0,
+                                 (hsize_t) b.ncorner, (hsize_t) nc,
+                                 jt, sizeof(inObjIdx_t), &od, pid );
+      ierr += hdfy_WriteSlabMPI( gid, "vn", ftype, itype, (hsize_t) lt[4], 0,
+                                 (hsize_t) b.ncorner, (hsize_t) nc,
+                                 jn, sizeof(inObjIdx_t), &od, pid );
+      H5Gclose( gid );
+   }
+
+   ierr += hdfy_WriteObjGroupsMPI( comm, fid, p, b.ngroup, lt[5], lt[3], pid );
+   ierr += hdfy_WriteObjMaterialsMPI( comm, fid, p, pid );
+
+   H5Pclose( pid );
+   if( H5Fclose( fid ) < 0 ) ierr += 1;
+   objClear( p );
+   if( hdfy_AnyError( comm, ierr ) ) {
+      if( irank == 0 ) fprintf( stderr, " e [%s]  Failed writing file: "
+                                "\"%s\"\n", FUNC, filename );
+      return 4;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to convert an STL file to an HDF5 file with all processes of
+// the communicator; each one reads its slice of the records of a binary
+// file, or parses its slice of the text of an ASCII file cut at "facet"
+// words; an ASCII file that cannot be cut is read whole by every process
+// and each one keeps its slice of the triangles
+//
+
+int hdfy_WriteSTLMPI( MPI_Comm comm, const char *stlfile,
+                      const char *filename, const struct hdfyOpts_s *o )
+#define FUNC "hdfy_WriteSTLMPI"
+{
+   const size_t stride = sizeof(struct inSTLtri_s);
+   struct hdfyOpts_s od;
+   struct inSTL_s stl;
+   struct inSTLtri_s *tp;
+   unsigned long nl,nb=0,ntot=0;
+   char header[81];
+   hid_t fid,pid;
+   int irank,nrank,itype=1,ierr=0;
+
+
+   if( stlfile == NULL || filename == NULL ) return 1;
+   MPI_Comm_rank( comm, &irank );
+   MPI_Comm_size( comm, &nrank );
+
+   if( o == NULL ) {
+      hdfy_InitOpts( &od );
+   } else {
+      od = *o;
+   }
+   od.itune = 0;
+   od.inbit = 0;
+
+   inSTL_InitSTLfile( &stl );
+   if( irank == 0 ) ierr = inSTL_ProbeSTLfile( (char *) stlfile, &itype );
+   MPI_Bcast( &ierr, 1, MPI_INT, 0, comm );
+   MPI_Bcast( &itype, 1, MPI_INT, 0, comm );
+   if( ierr ) return 2;
+
+   if( itype == 1 ) {
+      ierr = inSTL_ReadBinarySTLSlice( (char *) stlfile, &stl, 4*3*4 + 2,
+                                       irank, nrank );
+      tp = stl.triangles;
+      nl = (unsigned long) stl.ntri;
+   } else {
+      ierr = inSTL_ReadAsciiSTLSlice( (char *) stlfile, &stl, irank, nrank );
+      tp = stl.triangles;
+      nl = (unsigned long) stl.ntri;
+      if( hdfy_AnyError( comm, ierr ) ) {
+         // a file that cannot be cut is read whole, which also reports the
+         // errors of the file once
+         if( stl.triangles != NULL ) free( stl.triangles );
+         inSTL_InitSTLfile( &stl );
+         ierr = inSTL_ReadAsciiSTL( (char *) stlfile, &stl );
+         nb = ( (unsigned long) stl.ntri * (unsigned long) irank ) /
+              (unsigned long) nrank;
+         nl = ( (unsigned long) stl.ntri * (unsigned long) ( irank+1 ) ) /
+              (unsigned long) nrank - nb;
+         tp = stl.triangles + nb;
+      }
+   }
+   if( hdfy_AnyError( comm, ierr ) ) {
+      if( stl.triangles != NULL ) free( stl.triangles );
+      return 2;
+   }
+
+   // offset of this slice in the whole file's records
+   nb = 0;
+   MPI_Exscan( &nl, &nb, 1, MPI_UNSIGNED_LONG, MPI_SUM, comm );
+   if( irank == 0 ) nb = 0;
+   MPI_Allreduce( &nl, &ntot, 1, MPI_UNSIGNED_LONG, MPI_SUM, comm );
+
+   fid = hdfy_CreateFileMPI( comm, filename, "stl" );
+   if( fid < 0 ) {
+      if( stl.triangles != NULL ) free( stl.triangles );
+      return 3;
+   }
+   pid = H5Pcreate( H5P_DATASET_XFER );
+   H5Pset_dxpl_mpio( pid, H5FD_MPIO_COLLECTIVE );
+
+   memcpy( header, stl.header, 80 );
+   header[80] = '\0';
+   ierr += hdfy_WriteAttrString( fid, "header", header );
+   ierr += hdfy_WriteAttrInt( fid, "count", (long) ntot );
+
+   ierr += hdfy_WriteSlabMPI( fid, "normals", H5T_IEEE_F32LE,
+                              H5T_NATIVE_FLOAT, ntot, 3, nb, nl,
+                              ( nl > 0 ? tp->normal : NULL ), stride,
+                              &od, pid );
+   ierr += hdfy_WriteSlabMPI( fid, "vertex1", H5T_IEEE_F32LE,
+                              H5T_NATIVE_FLOAT, ntot, 3, nb, nl,
+                              ( nl > 0 ? tp->vertex1 : NULL ), stride,
+                              &od, pid );
+   ierr += hdfy_WriteSlabMPI( fid, "vertex2", H5T_IEEE_F32LE,
+                              H5T_NATIVE_FLOAT, ntot, 3, nb, nl,
+                              ( nl > 0 ? tp->vertex2 : NULL ), stride,
+                              &od, pid );
+   ierr += hdfy_WriteSlabMPI( fid, "vertex3", H5T_IEEE_F32LE,
+                              H5T_NATIVE_FLOAT, ntot, 3, nb, nl,
+                              ( nl > 0 ? tp->vertex3 : NULL ), stride,
+                              &od, pid );
+   ierr += hdfy_WriteSlabMPI( fid, "attributes", H5T_STD_U16LE,
+                              H5T_NATIVE_USHORT, ntot, 0, nb, nl,
+                              ( nl > 0 ? &( tp->iatrib ) : NULL ), stride,
+                              &od, pid );
+
+   H5Pclose( pid );
+   if( H5Fclose( fid ) < 0 ) ierr += 1;
+   if( stl.triangles != NULL ) free( stl.triangles );
+   if( hdfy_AnyError( comm, ierr ) ) {
+      if( irank == 0 ) fprintf( stderr, " e [%s]  Failed writing file: "
+                                "\"%s\"\n", FUNC, filename );
+      return 4;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+#ifdef _DRIVER_
+//
+// Driver: mpirun -np N ./hdfy_mpi <file.obj|file.stl> <file.h5>
+//
+
+int main( int argc, char *argv[] )
+{
+   const char *ext;
+   int irank,ierr=1;
+
+   MPI_Init( &argc, &argv );
+   MPI_Comm_rank( MPI_COMM_WORLD, &irank );
+
+   if( argc < 3 ) {
+      if( irank == 0 ) fprintf( stderr, " Usage: %s <file.obj|file.stl> "
+                                "<file.h5>\n", argv[0] );
+   } else {
+      ext = strrchr( argv[1], '.' );
+      if( ext != NULL && strcasecmp( ext, ".obj" ) == 0 ) {
+         ierr = hdfy_WriteObjMPI( MPI_COMM_WORLD, argv[1], argv[2], NULL );
+      } else if( ext != NULL && strcasecmp( ext, ".stl" ) == 0 ) {
+         ierr = hdfy_WriteSTLMPI( MPI_COMM_WORLD, argv[1], argv[2], NULL );
+      } else {
+         if( irank == 0 ) fprintf( stderr, " Unknown type of file \"%s\"\n",
+                                   argv[1] );
+      }
+   }
+
+   MPI_Finalize();
+
+   return ierr;
+}
+#endif
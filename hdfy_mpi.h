@@ -0,0 +1,68 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#ifndef _HDFY_MPI_H_
+#define _HDFY_MPI_H_
+
+#include <mpi.h>
+
+#include "hdfy.h"
+#include "stl.h"
+#include "inobj.h"
+
+//
+// Collective writers for a parallel (MPI-IO) build of HDF5. Every process
+// reads its own slice of the input, the offsets of the slices in the global
+// arrays come from an exclusive scan of the slice counts, and each process
+// writes its rows as a hyperslab of the shared datasets in one collective
+// transfer. The layouts are those of hdfy_WriteObj() and hdfy_WriteSTL(),
+// except that the strings of the group and material tables are of fixed
+// length, because the parallel library cannot write variable-length data.
+// Chunking and filters follow the options; tuning, n-bit packing and the
+// threaded chunk filters of the serial writers are not used.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int hdfy_WriteObjMPI( MPI_Comm comm, const char *objfile,
+                      const char *filename, const struct hdfyOpts_s *o );
+
+int hdfy_WriteSTLMPI( MPI_Comm comm, const char *stlfile,
+                      const char *filename, const struct hdfyOpts_s *o );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,1352 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+
+#include "hdfy_obj.h"
+
+// records read back are laid out at run time, because fixed-length names are
+// as long as the file says
+#define HDFY_ALIGN8( n )  ( ( (n) + 7 ) & ~( (size_t) 7 ) )
+
+// records of the group and material tables (packed in the file)
+struct hdfyObjGroup_s {
+   const char *name;
+   long face_start, face_end;
+};
+
+struct hdfyObjMaterial_s {
+   const char *name;
+   float Ka[3], Kd[3], Ks[3];
+   float Ns, Ni, d;
+   int illum;
+   const char *map_Kd;
+};
+
+
+//
+// Function to write the group table
+//
+
+static int hdfy_WriteObjGroups( hid_t fid, void *p )
+#define FUNC "hdfy_WriteObjGroups"
+{
+   struct hdfyObjGroup_s *g;
+   hid_t sid,tid,mid,fmid,did;
+   hsize_t ng;
+   herr_t ierr=0;
+   short n;
+   int is,ie;
+
+   ng = (hsize_t) objGetNumGroups( p );
+   g = (struct hdfyObjGroup_s *) malloc( ( ng + 1 ) * sizeof(*g) );
+   if( g == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate group table \n", FUNC );
+      return 1;
+   }
+   for(n=0;n<(short) ng;++n) {
+      objGetGroupBounds( p, n, &is, &ie );
+      g[n].name = objGetGroupName( p, n );
+      g[n].face_start = (long) is;
+      g[n].face_end = (long) ie;
+   }
+
+   tid = H5Tcopy( H5T_C_S1 );
+   H5Tset_size( tid, H5T_VARIABLE );
+   mid = H5Tcreate( H5T_COMPOUND, sizeof(struct hdfyObjGroup_s) );
+   H5Tinsert( mid, "name", HOFFSET(struct hdfyObjGroup_s, name), tid );
+   H5Tinsert( mid, "face_start",
+              HOFFSET(struct hdfyObjGroup_s, face_start), H5T_NATIVE_LONG );
+   H5Tinsert( mid, "face_end",
+              HOFFSET(struct hdfyObjGroup_s, face_end), H5T_NATIVE_LONG );
+
+   sid = H5Screate_simple( 1, &ng, NULL );
+   fmid = H5Tcopy( mid );
+   H5Tpack( fmid );
+   did = H5Dcreate2( fid, "groups", fmid, sid,
+                     H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+   if( did < 0 ) {
+      ierr = -1;
+   } else {
+      if( ng > 0 ) ierr = H5Dwrite( did, mid, H5S_ALL, H5S_ALL, H5P_DEFAULT, g );
+      H5Dclose( did );
+   }
+   H5Sclose( sid );
+   H5Tclose( fmid );
+   H5Tclose( mid );
+   H5Tclose( tid );
+   free( g );
+
+   if( ierr < 0 ) {
+      fprintf( stderr, " e [%s]  Could not write the groups \n", FUNC );
+      return 2;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to write the material table
+//
+
+static int hdfy_WriteObjMaterials( hid_t fid, void *p )
+#define FUNC "hdfy_WriteObjMaterials"
+{
+   struct hdfyObjMaterial_s *m;
+   struct inObjMaterial_s mtl;
+   hid_t sid,tid,aid,mid,fmid,did;
+   hsize_t nm,n3=3;
+   herr_t ierr=0;
+   int n;
+
+   nm = (hsize_t) objGetNumMaterials( p );
+   m = (struct hdfyObjMaterial_s *) malloc( ( nm + 1 ) * sizeof(*m) );
+   if( m == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate material table \n", FUNC);
+      return 1;
+   }
+   for(n=0;n<(int) nm;++n) {
+      objGetMaterial( p, n, &mtl );
+      m[n].name = mtl.name;
+      memcpy( m[n].Ka, mtl.Ka, 3*sizeof(float) );
+      memcpy( m[n].Kd, mtl.Kd, 3*sizeof(float) );
+      memcpy( m[n].Ks, mtl.Ks, 3*sizeof(float) );
+      m[n].Ns = mtl.Ns;
+      m[n].Ni = mtl.Ni;
+      m[n].d = mtl.d;
+      m[n].illum = mtl.illum;
+      m[n].map_Kd = mtl.map_Kd;
+   }
+
+   tid = H5Tcopy( H5T_C_S1 );
+   H5Tset_size( tid, H5T_VARIABLE );
+   aid = H5Tarray_create2( H5T_NATIVE_FLOAT, 1, &n3 );
+   mid = H5Tcreate( H5T_COMPOUND, sizeof(struct hdfyObjMaterial_s) );
+   H5Tinsert( mid, "name", HOFFSET(struct hdfyObjMaterial_s, name), tid );
+   H5Tinsert( mid, "Ka", HOFFSET(struct hdfyObjMaterial_s, Ka), aid );
+   H5Tinsert( mid, "Kd", HOFFSET(struct hdfyObjMaterial_s, Kd), aid );
+   H5Tinsert( mid, "Ks", HOFFSET(struct hdfyObjMaterial_s, Ks), aid );
+   H5Tinsert( mid, "Ns",
+              HOFFSET(struct hdfyObjMaterial_s, Ns), H5T_NATIVE_FLOAT );
+   H5Tinsert( mid, "Ni",
+              HOFFSET(struct hdfyObjMaterial_s, Ni), H5T_NATIVE_FLOAT );
+   H5Tinsert( mid, "d",
+              HOFFSET(struct hdfyObjMaterial_s, d), H5T_NATIVE_FLOAT );
+   H5Tinsert( mid, "illum",
+              HOFFSET(struct hdfyObjMaterial_s, illum), H5T_NATIVE_INT );
+   H5Tinsert( mid, "map_Kd", HOFFSET(struct hdfyObjMaterial_s, map_Kd), tid );
+
+   sid = H5Screate_simple( 1, &nm, NULL );
+   fmid = H5Tcopy( mid );
+   H5Tpack( fmid );
+   did = H5Dcreate2( fid, "materials", fmid, sid,
+                     H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+   if( did < 0 ) {
+      ierr = -1;
+   } else {
+      if( nm > 0 ) ierr = H5Dwrite( did, mid, H5S_ALL, H5S_ALL, H5P_DEFAULT, m );
+      H5Dclose( did );
+   }
+   H5Sclose( sid );
+   H5Tclose( fmid );
+   H5Tclose( mid );
+   H5Tclose( aid );
+   H5Tclose( tid );
+   free( m );
+
+   if( ierr < 0 ) {
+      fprintf( stderr, " e [%s]  Could not write the materials \n", FUNC );
+      return 2;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to make the name of a texture's dataset from its material's name
+//
+
+static void hdfy_TextureName( hid_t gid, const char *mname, int n,
+                              char *name, size_t len )
+{
+   size_t k;
+
+   snprintf( name, len, "%s", ( mname[0] != '\0' ? mname : "unnamed" ) );
+   for(k=0;name[k]!='\0';++k) if( name[k] == '/' ) name[k] = '_';
+   if( strcmp( name, "." ) == 0 || H5Lexists( gid, name, H5P_DEFAULT ) > 0 ) {
+      snprintf( name + strlen( name ), len - strlen( name ), "_%d", n );
+   }
+}
+
+
+//
+// Function to write the textures of the materials as images, in the layout
+// of the HDF5 image convention (pixels of RGBA bytes, top row first), in
+// square tiles that are compressed on their own
+//
+
+static int hdfy_WriteObjTextures( hid_t fid, void *p,
+                                  const struct hdfyOpts_s *o )
+#define FUNC "hdfy_WriteObjTextures"
+{
+   struct hdfyOpts_s od;
+   struct inObjMaterial_s mtl;
+   const unsigned char *rgba;
+   unsigned int iw,ih;
+   hsize_t dims[3],cdims[3];
+   hid_t gid=-1,sid,pid,did;
+   char name[256];
+   int n,nm,ierr=0;
+
+   if( o == NULL ) {
+      hdfy_InitOpts( &od );
+      o = &od;
+   }
+
+   nm = objGetNumMaterials( p );
+   for(n=0;n<nm && ierr==0;++n) {
+      rgba = objGetTexture( p, n, &iw, &ih );
+      if( rgba == NULL || iw == 0 || ih == 0 ) continue;
+      objGetMaterial( p, n, &mtl );
+
+      if( gid < 0 ) {
+         gid = H5Gcreate2( fid, "textures",
+                           H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+         if( gid < 0 ) return 1;
+      }
+      hdfy_TextureName( gid, mtl.name, n, name, sizeof(name) );
+
+      dims[0] = (hsize_t) ih;
+      dims[1] = (hsize_t) iw;
+      dims[2] = 4;
+      cdims[0] = ( o->tile > 0 && dims[0] > (hsize_t) o->tile ?
+                   (hsize_t) o->tile : dims[0] );
+      cdims[1] = ( o->tile > 0 && dims[1] > (hsize_t) o->tile ?
+                   (hsize_t) o->tile : dims[1] );
+      cdims[2] = 4;
+      sid = H5Screate_simple( 3, dims, NULL );
+      pid = H5Pcreate( H5P_DATASET_CREATE );
+      H5Pset_chunk( pid, 3, cdims );
+      if( o->ideflate > 0 && H5Zfilter_avail( H5Z_FILTER_DEFLATE ) > 0 ) {
+         H5Pset_deflate( pid, (unsigned int) o->ideflate );
+      }
+      did = H5Dcreate2( gid, name, H5T_STD_U8LE, sid,
+                        H5P_DEFAULT, pid, H5P_DEFAULT );
+      H5Pclose( pid );
+      H5Sclose( sid );
+      if( did < 0 ) {
+         ierr = 2;
+         break;
+      }
+      if( H5Dwrite( did, H5T_NATIVE_UCHAR, H5S_ALL, H5S_ALL,
+                    H5P_DEFAULT, rgba ) < 0 ) ierr = 3;
+      ierr += hdfy_WriteAttrString( did, "CLASS", "IMAGE" );
+      ierr += hdfy_WriteAttrString( did, "IMAGE_VERSION", "1.2" );
+      ierr += hdfy_WriteAttrString( did, "IMAGE_SUBCLASS", "IMAGE_TRUECOLOR" );
+      ierr += hdfy_WriteAttrString( did, "INTERLACE_MODE", "INTERLACE_PIXEL" );
+      ierr += hdfy_WriteAttrString( did, "material", mtl.name );
+      ierr += hdfy_WriteAttrInt( did, "index", (long) n );
+      ierr += hdfy_WriteAttrString( did, "source", mtl.map_Kd );
+      H5Dclose( did );
+   }
+   if( gid >= 0 ) H5Gclose( gid );
+
+   if( ierr ) {
+      fprintf( stderr, " e [%s]  Could not write the textures \n", FUNC );
+      return 2;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+//
+// Function to write the unified corners of the faces, with the index of
+// every face member and the faces as fans of triangles over the corners
+//
+
+static int hdfy_WriteObjCorners( hid_t fid, void *p,
+                                 const struct hdfyOpts_s *o )
+#define FUNC "hdfy_WriteObjCorners"
+{
+   const float *cv;
+   const inObjIdx_t *icsr,*kc;
+   inObjIdx_t *tri;
+   long nk,nc,nf,ntri=0,n,i,k;
+   hid_t gid,itype,ftype;
+   int ierr=0;
+
+
+   if( objBuildCorners( p, o->nthreads ) != 0 ) {
+      fprintf( stderr, " e [%s]  Could not build the corners \n", FUNC );
+      return 1;
+   }
+   cv = objGetCorners( p, &nk );
+   kc = objGetCornerIndices( p, &nc );
+   icsr = objGetFaceOffsets( p, &nf );
+
+   for(n=0;n<nf;++n) {
+      if( icsr[n+1] - icsr[n] >= 3 ) ntri += (long) ( icsr[n+1] - icsr[n] ) - 2;
+   }
+   tri = (inObjIdx_t *) malloc( (size_t) ( ntri > 0 ? 3*ntri : 1 ) *
+                                sizeof(inObjIdx_t) );
+   if( tri == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate triangles \n", FUNC );
+      return 1;
+   }
+   for(n=0,k=0;n<nf;++n) {
+      if( icsr[n+1] - icsr[n] < 3 ) continue;
+      for(i=(long) icsr[n]+2;i<(long) icsr[n+1];++i,k+=3) {
+         tri[k  ] = kc[ icsr[n] ];
+         tri[k+1] = kc[i-1];
+         tri[k+2] = kc[i];
+      }
+   }
+
+   if( sizeof(inObjIdx_t) == 8 ) {
+      itype = H5T_NATIVE_UINT64;
+      ftype = H5T_STD_U64LE;
+   } else {
+      itype = H5T_NATIVE_UINT32;
+      ftype = H5T_STD_U32LE;
+   }
+
+   gid = H5Gcreate2( fid, "corners", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+   if( gid < 0 ) {
+      free( tri );
+      return 1;
+   }
+   ierr += hdfy_WriteAttrString( gid, "layout", "x y z s t nx ny nz" );
+   ierr += hdfy_WriteArray( gid, "vertices", H5T_IEEE_F32LE, H5T_NATIVE_FLOAT,
+                            (hsize_t) nk, INOBJ_CORNER_FLOATS, cv, o );
+   ierr += hdfy_WriteArray( gid, "index", ftype, itype,
+                            (hsize_t) nc, 0, kc, o );
+   ierr += hdfy_WriteArray( gid, "triangles", ftype, itype,
+                            (hsize_t) ntri, 3, tri, o );
+   H5Gclose( gid );
+   free( tri );
+
+   return ierr;
+}
+#undef FUNC
+
+//
+// Function to write an OBJ object to an HDF5 file; the mesh arrays go from
+// the object's memory to the library without copies
+//
+
+int hdfy_WriteObj( void *p, const char *filename,
+                   const struct hdfyOpts_s *o )
+#define FUNC "hdfy_WriteObj"
+{
+   const float *v,*vn,*vt;
+   const inObjIdx_t *icsr,*jv,*jt,*jn;
+   long nv,nn,nt,nf,nc;
+   hid_t fid,gid,itype,ftype;
+   int ierr=0;
+
+
+   if( p == NULL || filename == NULL ) return 1;
+
+   v = objGetVertices( p, &nv );
+   vn = objGetNormals( p, &nn );
+   vt = objGetTexels( p, &nt );
+   icsr = objGetFaceOffsets( p, &nf );
+   jv = objGetFaceVertexIndices( p, &nc );
+   jt = objGetFaceTexelIndices( p, &nc );
+   jn = objGetFaceNormalIndices( p, &nc );
+
+   if( sizeof(inObjIdx_t) == 8 ) {
+      itype = H5T_NATIVE_UINT64;
+      ftype = H5T_STD_U64LE;
+   } else {
+      itype = H5T_NATIVE_UINT32;
+      ftype = H5T_STD_U32LE;
+   }
+
+   fid = hdfy_CreateFile( filename, "obj", NULL );
+   if( fid < 0 ) return 2;
+
+   ierr += hdfy_WriteArray( fid, "vertices", H5T_IEEE_F32LE, H5T_NATIVE_FLOAT,
+                            (hsize_t) nv, 3, v, o );
+   ierr += hdfy_WriteArray( fid, "normals", H5T_IEEE_F32LE, H5T_NATIVE_FLOAT,
+                            (hsize_t) nn, 3, vn, o );
+   ierr += hdfy_WriteArray( fid, "texels", H5T_IEEE_F32LE, H5T_NATIVE_FLOAT,
+                            (hsize_t) nt, 2, vt, o );
+
+   gid = H5Gcreate2( fid, "faces", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+   if( gid < 0 ) {
+      ierr += 1;
+   } else {
+      // there is one more offset than there are faces
+      ierr += hdfy_WriteAttrInt( gid, "count", nf );
+      ierr += hdfy_WriteArray( gid, "offsets", ftype, itype,
+                               (hsize_t) ( icsr != NULL ? nf+1 : 0 ), 0,
+                               icsr, o );
+      ierr += hdfy_WriteArray( gid, "v", ftype, itype,
+                               (hsize_t) nc, 0, jv, o );
+      ierr += hdfy_WriteArray( gid, "vt", ftype, itype,
+                               (hsize_t) nc, 0, jt, o );
+      ierr += hdfy_WriteArray( gid, "vn", ftype, itype,
+                               (hsize_t) nc, 0, jn, o );
+      H5Gclose( gid );
+   }
+
+   if( o != NULL && o->icorners ) ierr += hdfy_WriteObjCorners( fid, p, o );
+   ierr += hdfy_WriteObjGroups( fid, p );
+   ierr += hdfy_WriteObjMaterials( fid, p );
+   ierr += hdfy_WriteObjTextures( fid, p, o );
+
+   if( H5Fclose( fid ) < 0 ) ierr += 1;
+   if( ierr != 0 ) {
+      fprintf( stderr, " e [%s]  Failed writing file: \"%s\"\n", FUNC, filename );
+      return 3;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+
+//
+// Pipelined conversion: the parser streams batches in to a ring of "depth"
+// slots and a writer thread appends them to growing datasets, so that the
+// parsing of a batch overlaps the filtering and writing of the ones before
+// it. Only the writer thread calls the library while the parser runs.
+//
+
+// a batch as queued for the writer; the face offsets are those of the file
+struct hdfyObjSlot_s {
+   long nv, nt, nn, nf, nc;
+   size_t cap[7];                       // capacities of the arrays
+   float *v, *vt, *vn;
+   inObjIdx_t *o, *jv, *jt, *jn;
+};
+
+struct hdfyObjPipe_s {
+   pthread_mutex_t lock;
+   pthread_cond_t cput, cget;
+   struct hdfyObjSlot_s *slot;
+   int depth, head, count, idone, ierr, ifirst;
+   hid_t did[7], itype;
+   long nface, nbatch;
+   double tstall, tidle;
+};
+
+static int hdfy_Grow( void **p, size_t *cap, size_t n, size_t esize )
+{
+   void *q;
+
+   if( n <= *cap ) return 0;
+   q = realloc( *p, n * esize );
+   if( q == NULL ) return 1;
+   *p = q;
+   *cap = n;
+
+   return 0;
+}
+
+static int hdfy_ObjPipePut( const struct inObjBatch_s *b, void *user )
+{
+   struct hdfyObjPipe_s *q = (struct hdfyObjPipe_s *) user;
+   struct hdfyObjSlot_s *s;
+   double t0;
+   long k;
+   int ierr=0;
+
+   pthread_mutex_lock( &( q->lock ) );
+   t0 = hdfy_Time();
+   while( q->count == q->depth && q->ierr == 0 ) {
+      pthread_cond_wait( &( q->cput ), &( q->lock ) );
+   }
+   q->tstall += hdfy_Time() - t0;
+   ierr = q->ierr;
+   s = &( q->slot[ ( q->head + q->count ) % q->depth ] );
+   pthread_mutex_unlock( &( q->lock ) );
+   if( ierr ) return ierr;
+
+   // the slot is not seen by the writer until it is counted
+   ierr += hdfy_Grow( (void **) &( s->v ), &( s->cap[0] ),
+                      (size_t) b->nvertex, 3*sizeof(float) );
+   ierr += hdfy_Grow( (void **) &( s->vt ), &( s->cap[1] ),
+                      (size_t) b->ntexel, 2*sizeof(float) );
+   ierr += hdfy_Grow( (void **) &( s->vn ), &( s->cap[2] ),
+                      (size_t) b->nnormal, 3*sizeof(float) );
+   ierr += hdfy_Grow( (void **) &( s->o ), &( s->cap[3] ),
+                      (size_t) b->nface + 1, sizeof(inObjIdx_t) );
+   ierr += hdfy_Grow( (void **) &( s->jv ), &( s->cap[4] ),
+                      (size_t) b->ncorner, sizeof(inObjIdx_t) );
+   ierr += hdfy_Grow( (void **) &( s->jt ), &( s->cap[5] ),
+                      (size_t) b->ncorner, sizeof(inObjIdx_t) );
+   ierr += hdfy_Grow( (void **) &( s->jn ), &( s->cap[6] ),
+                      (size_t) b->ncorner, sizeof(inObjIdx_t) );
+   if( ierr ) return 1;
+
+   s->nv = b->nvertex;
+   s->nt = b->ntexel;
+   s->nn = b->nnormal;
+   s->nf = b->nface;
+   s->nc = b->ncorner;
+   if( s->nv ) memcpy( s->v, b->vertex, (size_t) s->nv * 3*sizeof(float) );
+   if( s->nt ) memcpy( s->vt, b->texel, (size_t) s->nt * 2*sizeof(float) );
+   if( s->nn ) memcpy( s->vn, b->normal, (size_t) s->nn * 3*sizeof(float) );
+   for(k=0;k<=s->nf;++k) {
+      s->o[k] = b->offsets[k] + (inObjIdx_t) b->corner_base;
+   }
+   if( s->nc ) {
+      memcpy( s->jv, b->jv, (size_t) s->nc * sizeof(inObjIdx_t) );
+      memcpy( s->jt, b->jt, (size_t) s->nc * sizeof(inObjIdx_t) );
+      memcpy( s->jn, b->jn, (size_t) s->nc * sizeof(inObjIdx_t) );
+   }
+
+   pthread_mutex_lock( &( q->lock ) );
+   ++( q->count );
+   pthread_cond_signal( &( q->cget ) );
+   pthread_mutex_unlock( &( q->lock ) );
+
+   return 0;
+}
+
+static void* hdfy_ObjPipeWriter( void *arg )
+{
+   struct hdfyObjPipe_s *q = (struct hdfyObjPipe_s *) arg;
+   struct hdfyObjSlot_s *s;
+   double t0;
+   int ierr=0;
+
+   while( 1 ) {
+      pthread_mutex_lock( &( q->lock ) );
+      t0 = hdfy_Time();
+      while( q->count == 0 && !q->idone ) {
+         pthread_cond_wait( &( q->cget ), &( q->lock ) );
+      }
+      q->tidle += hdfy_Time() - t0;
+      if( q->count == 0 ) {
+         pthread_mutex_unlock( &( q->lock ) );
+         // a mesh without faces still has its leading zero offset
+         if( q->ifirst ) {
+            inObjIdx_t izero = 0;
+            if( hdfy_AppendRows( q->did[3], q->itype, 1, 0, &izero ) ) {
+               pthread_mutex_lock( &( q->lock ) );
+               q->ierr = 1;
+               pthread_mutex_unlock( &( q->lock ) );
+            }
+            q->ifirst = 0;
+         }
+         break;
+      }
+      s = &( q->slot[ q->head ] );
+      pthread_mutex_unlock( &( q->lock ) );
+
+      ierr += hdfy_AppendRows( q->did[0], H5T_NATIVE_FLOAT,
+                               (hsize_t) s->nv, 3, s->v );
+      ierr += hdfy_AppendRows( q->did[1], H5T_NATIVE_FLOAT,
+                               (hsize_t) s->nn, 3, s->vn );
+      ierr += hdfy_AppendRows( q->did[2], H5T_NATIVE_FLOAT,
+                               (hsize_t) s->nt, 2, s->vt );
+      // the leading zero offset only comes with the first faces
+      if( s->nf > 0 ) {
+         ierr += hdfy_AppendRows( q->did[3], q->itype,
+                                  (hsize_t) ( s->nf + q->ifirst ), 0,
+                                  s->o + ( 1 - q->ifirst ) );
+         q->ifirst = 0;
+      }
+      ierr += hdfy_AppendRows( q->did[4], q->itype, (hsize_t) s->nc, 0, s->jv );
+      ierr += hdfy_AppendRows( q->did[5], q->itype, (hsize_t) s->nc, 0, s->jt );
+      ierr += hdfy_AppendRows( q->did[6], q->itype, (hsize_t) s->nc, 0, s->jn );
+
+      pthread_mutex_lock( &( q->lock ) );
+      q->nface += s->nf;
+      ++( q->nbatch );
+      q->head = ( q->head + 1 ) % q->depth;
+      --( q->count );
+      if( ierr ) q->ierr = 1;
+      pthread_cond_signal( &( q->cput ) );
+      pthread_mutex_unlock( &( q->lock ) );
+      if( ierr ) break;
+   }
+
+   return NULL;
+}
+
+
+//
+// Function to convert an OBJ file to an HDF5 file (same layout as that of
+// hdfy_WriteObj()) while it is parsed; "st" (when given) receives the
+// number of batches and the times that the parser waited for a free slot
+// and that the writer waited for a batch. The corners ("icorners" of the
+// options) are made from the whole mesh, so with them the file is read in
+// one go and written by hdfy_WriteObj() instead, as a single batch.
+//
+
+int hdfy_ConvertObj( const char *objfile, const char *filename,
+                     const struct hdfyOpts_s *o, struct hdfyPipeStats_s *st )
+#define FUNC "hdfy_ConvertObj"
+{
+   const char *name[7] = { "vertices", "normals", "texels",
+                           "offsets", "v", "vt", "vn" };
+   const hsize_t ncol[7] = { 3, 3, 2, 0, 0, 0, 0 };
+   struct hdfyOpts_s od;
+   struct hdfyObjPipe_s q;
+   pthread_t th;
+   hid_t fid,gid,ftype;
+   double t0;
+   void *p;
+   int n,ierr=0;
+
+
+   if( objfile == NULL || filename == NULL ) return 1;
+
+   if( o == NULL ) {
+      hdfy_InitOpts( &od );
+   } else {
+      od = *o;
+   }
+   od.inbit = 0;
+   if( od.batch <= 0 ) od.batch = 262144;
+   if( od.depth <= 0 ) od.depth = 2;
+
+   if( od.icorners ) {
+      t0 = hdfy_Time();
+      fprintf( stderr, " i [%s]  The corners need the whole mesh; not "
+               "pipelined \n", FUNC );
+      p = objReadFileOpts( objfile, ReadMmap, od.nthreads );
+      if( p == NULL ) {
+         ierr = 4;
+      } else {
+         if( hdfy_WriteObj( p, filename, &od ) != 0 ) ierr = 4;
+         objClear( p );
+      }
+      if( st != NULL ) {
+         memset( st, 0, sizeof(struct hdfyPipeStats_s) );
+         st->nbatch = 1;
+         st->seconds = hdfy_Time() - t0;
+      }
+      if( ierr != 0 ) {
+         fprintf( stderr, " e [%s]  Failed converting file: \"%s\"\n",
+                  FUNC, objfile );
+         return 5;
+      }
+      return 0;
+   }
+
+   memset( &q, 0, sizeof(q) );
+   q.depth = od.depth;
+   q.ifirst = 1;
+   q.slot = (struct hdfyObjSlot_s *)
+            calloc( (size_t) q.depth, sizeof(struct hdfyObjSlot_s) );
+   if( q.slot == NULL ) return 2;
+
+   if( sizeof(inObjIdx_t) == 8 ) {
+      q.itype = H5T_NATIVE_UINT64;
+      ftype = H5T_STD_U64LE;
+   } else {
+      q.itype = H5T_NATIVE_UINT32;
+      ftype = H5T_STD_U32LE;
+   }
+
+   fid = hdfy_CreateFile( filename, "obj", objfile );
+   if( fid < 0 ) {
+      free( q.slot );
+      return 2;
+   }
+   gid = H5Gcreate2( fid, "faces", H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT );
+   for(n=0;n<7;++n) {
+      q.did[n] = hdfy_CreateGrowing( ( n < 3 ? fid : gid ), name[n],
+                                     ( n < 3 ? H5T_IEEE_F32LE : ftype ),
+                                     ncol[n], &od );
+      if( q.did[n] < 0 ) ierr = 3;
+   }
+
+   // parse here while the writer thread drains the queue
+   t0 = hdfy_Time();
+   p = NULL;
+   if( ierr == 0 && gid >= 0 ) {
+      pthread_mutex_init( &( q.lock ), NULL );
+      pthread_cond_init( &( q.cput ), NULL );
+      pthread_cond_init( &( q.cget ), NULL );
+      pthread_create( &th, NULL, hdfy_ObjPipeWriter, &q );
+
+      p = objStreamFile( objfile, od.batch, hdfy_ObjPipePut, &q );
+
+      pthread_mutex_lock( &( q.lock ) );
+      q.idone = 1;
+      pthread_cond_signal( &( q.cget ) );
+      pthread_mutex_unlock( &( q.lock ) );
+      pthread_join( th, NULL );
+      pthread_cond_destroy( &( q.cget ) );
+      pthread_cond_destroy( &( q.cput ) );
+      pthread_mutex_destroy( &( q.lock ) );
+      if( p == NULL || q.ierr ) ierr = 4;
+   }
+
+   if( ierr == 0 ) {
+      ierr += hdfy_WriteAttrInt( gid, "count", q.nface );
+      ierr += hdfy_WriteObjGroups( fid, p );
+      ierr += hdfy_WriteObjMaterials( fid, p );
+      ierr += hdfy_WriteObjTextures( fid, p, &od );
+   }
+   if( p != NULL ) objClear( p );
+
+   for(n=0;n<7;++n) if( q.did[n] >= 0 ) H5Dclose( q.did[n] );
+   if( gid >= 0 ) H5Gclose( gid );
+   if( H5Fclose( fid ) < 0 ) ierr += 1;
+
+   for(n=0;n<q.depth;++n) {
+      free( q.slot[n].v );
+      free( q.slot[n].vt );
+      free( q.slot[n].vn );
+      free( q.slot[n].o );
+      free( q.slot[n].jv );
+      free( q.slot[n].jt );
+      free( q.slot[n].jn );
+   }
+   free( q.slot );
+
+   if( st != NULL ) {
+      st->nbatch = q.nbatch;
+      st->seconds = hdfy_Time() - t0;
+      st->parse_stall = q.tstall;
+      st->write_idle = q.tidle;
+   }
+   fprintf( stderr, " i [%s]  %ld batches in %.3f s; parser waited %.3f s, "
+            "writer waited %.3f s \n", FUNC, q.nbatch, hdfy_Time() - t0,
+            q.tstall, q.tidle );
+
+   if( ierr != 0 ) {
+      fprintf( stderr, " e [%s]  Failed converting file: \"%s\"\n",
+               FUNC, objfile );
+      return 5;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to read rows "row0" to "row0+nrow" of a dataset of "ncol" columns
+// (rank one when "ncol" is zero)
+//
+
+static int hdfy_ReadRange( hid_t did, hid_t mtype, hsize_t row0,
+                           hsize_t nrow, hsize_t ncol, void *buf )
+{
+   hsize_t off[2]={0,0},cnt[2];
+   hid_t mid,sid;
+   int ierr=0;
+
+   if( nrow == 0 ) return 0;
+
+   off[0] = row0;
+   cnt[0] = nrow;
+   cnt[1] = ncol;
+   mid = H5Screate_simple( ( ncol > 0 ? 2 : 1 ), cnt, NULL );
+   sid = H5Dget_space( did );
+   H5Sselect_hyperslab( sid, H5S_SELECT_SET, off, NULL, cnt, NULL );
+   if( H5Dread( did, mtype, mid, sid, H5P_DEFAULT, buf ) < 0 ) ierr = 1;
+   H5Sclose( sid );
+   H5Sclose( mid );
+
+   return ierr;
+}
+
+
+//
+// Function to read the rows of a dataset listed in "rows" (sorted and
+// unique); runs of consecutive rows become one block of the selection
+//
+
+static int hdfy_ReadRowList( hid_t did, hid_t mtype, hsize_t ncol,
+                             const long *rows, long n, void *buf )
+{
+   hsize_t off[2]={0,0},cnt[2],dims[2];
+   H5S_seloper_t op = H5S_SELECT_SET;
+   hid_t mid,sid;
+   long i,j;
+   int ierr=0;
+
+   if( n == 0 ) return 0;
+
+   dims[0] = (hsize_t) n;
+   dims[1] = ncol;
+   mid = H5Screate_simple( ( ncol > 0 ? 2 : 1 ), dims, NULL );
+   sid = H5Dget_space( did );
+   cnt[1] = ncol;
+   for(i=0;i<n;i=j) {
+      for(j=i+1;j<n && rows[j] == rows[j-1]+1;++j) {}
+      off[0] = (hsize_t) rows[i];
+      cnt[0] = (hsize_t) ( j - i );
+      H5Sselect_hyperslab( sid, op, off, NULL, cnt, NULL );
+      op = H5S_SELECT_OR;
+   }
+   if( H5Dread( did, mtype, mid, sid, H5P_DEFAULT, buf ) < 0 ) ierr = 1;
+   H5Sclose( sid );
+   H5Sclose( mid );
+
+   return ierr;
+}
+
+
+//
+// Function to read the group table; the names are variable-length strings
+// in files of hdfy_WriteObj() and fixed-length ones in those of the MPI
+// writer
+//
+
+static int hdfy_ReadObjGroups( struct hdfyObjFile_s *f )
+#define FUNC "hdfy_ReadObjGroups"
+{
+   hid_t did,sid,ftid,ntid,tid,mid;
+   hsize_t ng;
+   size_t lname=0,ofs,rec;
+   char *g;
+   long n;
+   int ivar,ierr=0;
+
+   did = H5Dopen2( f->fid, "groups", H5P_DEFAULT );
+   if( did < 0 ) return 1;
+   sid = H5Dget_space( did );
+   H5Sget_simple_extent_dims( sid, &ng, NULL );
+   H5Sclose( sid );
+
+   ftid = H5Dget_type( did );
+   ntid = H5Tget_member_type( ftid, (unsigned int)
+                              H5Tget_member_index( ftid, "name" ) );
+   ivar = ( H5Tis_variable_str( ntid ) > 0 );
+   if( !ivar ) lname = H5Tget_size( ntid );
+   H5Tclose( ntid );
+   H5Tclose( ftid );
+
+   // names in the record are a pointer or the characters themselves
+   tid = H5Tcopy( H5T_C_S1 );
+   if( ivar ) {
+      H5Tset_size( tid, H5T_VARIABLE );
+      ofs = HDFY_ALIGN8( sizeof(char *) );
+   } else {
+      H5Tset_size( tid, lname );
+      ofs = HDFY_ALIGN8( lname );
+   }
+   rec = ofs + 2*sizeof(long);
+   mid = H5Tcreate( H5T_COMPOUND, rec );
+   H5Tinsert( mid, "name", 0, tid );
+   H5Tinsert( mid, "face_start", ofs, H5T_NATIVE_LONG );
+   H5Tinsert( mid, "face_end", ofs + sizeof(long), H5T_NATIVE_LONG );
+
+   g = (char *) calloc( (size_t) ( ng + 1 ), rec );
+   f->names = (char **) calloc( (size_t) ( ng + 1 ), sizeof(char *) );
+   f->fs = (long *) malloc( ( (size_t) ( ng + 1 ) ) * sizeof(long) );
+   f->fe = (long *) malloc( ( (size_t) ( ng + 1 ) ) * sizeof(long) );
+   if( g == NULL || f->names == NULL || f->fs == NULL || f->fe == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate group table \n", FUNC );
+      ierr = 2;
+   } else if( ng > 0 ) {
+      if( H5Dread( did, mid, H5S_ALL, H5S_ALL, H5P_DEFAULT, g ) < 0 ) {
+         ierr = 3;
+      }
+   }
+
+   for(n=0;n<(long) ng && ierr==0;++n) {
+      char *r = g + ( (size_t) n ) * rec;
+      const char *s;
+      if( ivar ) {
+         memcpy( &s, r, sizeof(s) );
+         f->names[n] = strdup( s != NULL ? s : "" );
+      } else {
+         f->names[n] = strndup( r, lname );
+      }
+      if( f->names[n] == NULL ) ierr = 2;
+      memcpy( &( f->fs[n] ), r + ofs, sizeof(long) );
+      memcpy( &( f->fe[n] ), r + ofs + sizeof(long), sizeof(long) );
+      if( f->fs[n] < 0 || f->fe[n] < f->fs[n] || f->fe[n] > f->nface ) {
+         fprintf( stderr, " e [%s]  Bad bounds of group %ld \n", FUNC, n );
+         ierr = 4;
+      }
+   }
+   f->ngroup = (long) ng;
+
+   if( ivar && g != NULL && ng > 0 && ierr != 3 ) {
+      sid = H5Dget_space( did );
+      H5Dvlen_reclaim( mid, sid, H5P_DEFAULT, g );
+      H5Sclose( sid );
+   }
+   if( g != NULL ) free( g );
+   H5Tclose( mid );
+   H5Tclose( tid );
+   H5Dclose( did );
+
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// Function to open a converted OBJ file and read its group table
+//
+
+int hdfy_OpenObj( const char *filename, struct hdfyObjFile_s *f )
+#define FUNC "hdfy_OpenObj"
+{
+   const char *name[5] = { "vertices", "texels", "normals",
+                           "faces/offsets", "faces/v" };
+   long *cnt[5];
+   hsize_t dims[2];
+   hid_t did,sid;
+   int n;
+
+
+   memset( f, 0, sizeof(struct hdfyObjFile_s) );
+   f->fid = -1;
+   if( filename == NULL ) return 1;
+
+   f->fid = H5Fopen( filename, H5F_ACC_RDONLY, H5P_DEFAULT );
+   if( f->fid < 0 ) {
+      fprintf( stderr, " e [%s]  Could not open file: \"%s\"\n",
+               FUNC, filename );
+      return 1;
+   }
+
+   cnt[0] = &( f->nvertex );
+   cnt[1] = &( f->ntexel );
+   cnt[2] = &( f->nnormal );
+   cnt[3] = &( f->nface );
+   cnt[4] = &( f->ncorner );
+   for(n=0;n<5;++n) {
+      did = H5Dopen2( f->fid, name[n], H5P_DEFAULT );
+      if( did < 0 ) {
+         fprintf( stderr, " e [%s]  No \"%s\" in file: \"%s\"\n",
+                  FUNC, name[n], filename );
+         hdfy_CloseObj( f );
+         return 2;
+      }
+      sid = H5Dget_space( did );
+      H5Sget_simple_extent_dims( sid, dims, NULL );
+      *( cnt[n] ) = (long) dims[0];
+      H5Sclose( sid );
+      H5Dclose( did );
+   }
+   // there is one more offset than there are faces
+   if( f->nface > 0 ) --( f->nface );
+
+   if( hdfy_ReadObjGroups( f ) ) {
+      fprintf( stderr, " e [%s]  Could not read the groups of file: "
+               "\"%s\"\n", FUNC, filename );
+      hdfy_CloseObj( f );
+      return 3;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to close a converted OBJ file
+//
+
+void hdfy_CloseObj( struct hdfyObjFile_s *f )
+{
+   long n;
+
+   if( f->names != NULL ) {
+      for(n=0;n<f->ngroup;++n) free( f->names[n] );
+      free( f->names );
+   }
+   if( f->fs != NULL ) free( f->fs );
+   if( f->fe != NULL ) free( f->fe );
+   if( f->fid >= 0 ) H5Fclose( f->fid );
+
+   memset( f, 0, sizeof(struct hdfyObjFile_s) );
+   f->fid = -1;
+}
+
+
+//
+// Function to find the first group of a name in the table; -1 if none
+//
+
+long hdfy_FindObjGroup( const struct hdfyObjFile_s *f, const char *name )
+{
+   long n;
+
+   for(n=0;n<f->ngroup;++n) {
+      if( strcmp( f->names[n], name ) == 0 ) return n;
+   }
+
+   return -1;
+}
+
+
+//
+// Function to turn face members in to sorted unique 0-based rows of the file
+//
+
+static int hdfy_CompareLong( const void *a, const void *b )
+{
+   const long la = *( (const long *) a ), lb = *( (const long *) b );
+
+   return ( la > lb ) - ( la < lb );
+}
+
+static long* hdfy_UniqueRows( const inObjIdx_t *j, long nc, long *n )
+{
+   long *r,i,k=0;
+
+   r = (long *) malloc( ( (size_t) nc + 1 ) * sizeof(long) );
+   if( r == NULL ) return NULL;
+
+   for(i=0;i<nc;++i) if( j[i] > 0 ) r[k++] = (long) j[i] - 1;
+   qsort( r, (size_t) k, sizeof(long), hdfy_CompareLong );
+   for(*n=0,i=0;i<k;++i) {
+      if( *n == 0 || r[i] != r[*n-1] ) r[(*n)++] = r[i];
+   }
+
+   return r;
+}
+
+static void hdfy_RemapRows( inObjIdx_t *j, long nc, const long *r, long n )
+{
+   long i,lo,hi,m,l;
+
+   for(i=0;i<nc;++i) {
+      if( j[i] == 0 ) continue;
+      l = (long) j[i] - 1;
+      lo = 0;
+      hi = n - 1;
+      while( lo < hi ) {
+         m = ( lo + hi ) / 2;
+         if( r[m] < l ) lo = m + 1; else hi = m;
+      }
+      j[i] = (inObjIdx_t) ( lo + 1 );
+   }
+}
+
+
+//
+// Function to load all groups of the given names from a converted OBJ file;
+// the groups keep the order of the file's table
+//
+
+int hdfy_LoadObjGroups( const struct hdfyObjFile_s *f,
+                        int n, const char * const names[],
+                        struct hdfyObjView_s *v )
+#define FUNC "hdfy_LoadObjGroups"
+{
+   const char *dn[4] = { "faces/offsets", "faces/v", "faces/vt", "faces/vn" };
+   inObjIdx_t *o=NULL,*jj[3];
+   long *sel=NULL,ns=0,nf=0,nc=0,k,m;
+   hid_t did[4],itype;
+   int i,ierr=0;
+
+
+   memset( v, 0, sizeof(struct hdfyObjView_s) );
+   if( f->fid < 0 || n < 0 || ( n > 0 && names == NULL ) ) return 1;
+
+   itype = ( sizeof(inObjIdx_t) == 8 ? H5T_NATIVE_UINT64 : H5T_NATIVE_UINT32 );
+
+   // the groups of the table that were asked for
+   sel = (long *) malloc( ( (size_t) f->ngroup + 1 ) * sizeof(long) );
+   if( sel == NULL ) return 2;
+   for(k=0;k<f->ngroup;++k) {
+      for(i=0;i<n;++i) {
+         if( strcmp( f->names[k], names[i] ) == 0 ) {
+            sel[ns++] = k;
+            break;
+         }
+      }
+   }
+   for(i=0;i<n;++i) {
+      if( hdfy_FindObjGroup( f, names[i] ) < 0 ) {
+         fprintf( stderr, " e [%s]  No group \"%s\" \n", FUNC, names[i] );
+         ierr = 3;
+      }
+   }
+   if( ierr ) {
+      free( sel );
+      return ierr;
+   }
+
+   for(i=0;i<4;++i) did[i] = H5Dopen2( f->fid, dn[i], H5P_DEFAULT );
+   for(i=0;i<4;++i) if( did[i] < 0 ) ierr = 4;
+
+   // offsets of the faces of every group, then the members they span
+   for(k=0;k<ns;++k) nf += f->fe[ sel[k] ] - f->fs[ sel[k] ];
+   v->ngroup = ns;
+   v->names = (char **) calloc( (size_t) ns + 1, sizeof(char *) );
+   v->fs = (long *) malloc( ( (size_t) ns + 1 ) * sizeof(long) );
+   v->fe = (long *) malloc( ( (size_t) ns + 1 ) * sizeof(long) );
+   v->offsets = (inObjIdx_t *) malloc( ( (size_t) nf + 1 ) *
+                                       sizeof(inObjIdx_t) );
+   o = (inObjIdx_t *) malloc( ( (size_t) ns + 1 ) * 2*sizeof(inObjIdx_t) );
+   if( v->names == NULL || v->fs == NULL || v->fe == NULL ||
+       v->offsets == NULL || o == NULL ) {
+      ierr = 2;
+   } else {
+      v->offsets[0] = 0;
+   }
+   for(k=0,nf=0;k<ns && ierr==0;++k) {
+      const long is = f->fs[ sel[k] ], ie = f->fe[ sel[k] ];
+      v->names[k] = strdup( f->names[ sel[k] ] );
+      v->fs[k] = nf;
+      v->fe[k] = nf + ( ie - is );
+      if( ie == is ) {
+         o[2*k] = o[2*k+1] = 0;
+         continue;
+      }
+      ierr = hdfy_ReadRange( did[0], itype, (hsize_t) is,
+                             (hsize_t) ( ie - is + 1 ), 0, v->offsets + nf );
+      if( ierr ) break;
+      o[2*k] = v->offsets[nf];
+      o[2*k+1] = v->offsets[nf + ie - is];
+      for(m=0;m<=ie-is;++m) {
+         v->offsets[nf+m] = v->offsets[nf+m] - o[2*k] + (inObjIdx_t) nc;
+      }
+      nf += ie - is;
+      nc += (long) ( o[2*k+1] - o[2*k] );
+   }
+   v->nface = nf;
+   v->ncorner = nc;
+
+   for(i=0;i<3 && ierr==0;++i) {
+      jj[i] = (inObjIdx_t *) malloc( ( (size_t) nc + 1 ) * sizeof(inObjIdx_t) );
+      if( jj[i] == NULL ) {
+         ierr = 2;
+         break;
+      }
+      for(k=0,m=0;k<ns && ierr==0;++k) {
+         ierr = hdfy_ReadRange( did[i+1], itype, (hsize_t) o[2*k],
+                                (hsize_t) ( o[2*k+1] - o[2*k] ), 0, jj[i] + m );
+         m += (long) ( o[2*k+1] - o[2*k] );
+      }
+      if( i == 0 ) v->jv = jj[i];
+      if( i == 1 ) v->jt = jj[i];
+      if( i == 2 ) v->jn = jj[i];
+   }
+   for(i=0;i<4;++i) if( did[i] >= 0 ) H5Dclose( did[i] );
+   free( o );
+   free( sel );
+
+   // only the elements that the faces use, renumbered in file order
+   if( ierr == 0 ) {
+      v->vmap = hdfy_UniqueRows( v->jv, nc, &( v->nvertex ) );
+      v->tmap = hdfy_UniqueRows( v->jt, nc, &( v->ntexel ) );
+      v->nmap = hdfy_UniqueRows( v->jn, nc, &( v->nnormal ) );
+      v->vertices = (float *) malloc( ( (size_t) v->nvertex + 1 ) *
+                                      3*sizeof(float) );
+      v->texels = (float *) malloc( ( (size_t) v->ntexel + 1 ) *
+                                    2*sizeof(float) );
+      v->normals = (float *) malloc( ( (size_t) v->nnormal + 1 ) *
+                                     3*sizeof(float) );
+      if( v->vmap == NULL || v->tmap == NULL || v->nmap == NULL ||
+          v->vertices == NULL || v->texels == NULL || v->normals == NULL ) {
+         ierr = 2;
+      }
+   }
+   if( ierr == 0 ) {
+      did[0] = H5Dopen2( f->fid, "vertices", H5P_DEFAULT );
+      did[1] = H5Dopen2( f->fid, "texels", H5P_DEFAULT );
+      did[2] = H5Dopen2( f->fid, "normals", H5P_DEFAULT );
+      if( did[0] < 0 || did[1] < 0 || did[2] < 0 ) ierr = 4;
+      if( ierr == 0 ) ierr = hdfy_ReadRowList( did[0], H5T_NATIVE_FLOAT, 3,
+                                          v->vmap, v->nvertex, v->vertices );
+      if( ierr == 0 ) ierr = hdfy_ReadRowList( did[1], H5T_NATIVE_FLOAT, 2,
+                                          v->tmap, v->ntexel, v->texels );
+      if( ierr == 0 ) ierr = hdfy_ReadRowList( did[2], H5T_NATIVE_FLOAT, 3,
+                                          v->nmap, v->nnormal, v->normals );
+      for(i=0;i<3;++i) if( did[i] >= 0 ) H5Dclose( did[i] );
+   }
+   if( ierr == 0 ) {
+      hdfy_RemapRows( v->jv, nc, v->vmap, v->nvertex );
+      hdfy_RemapRows( v->jt, nc, v->tmap, v->ntexel );
+      hdfy_RemapRows( v->jn, nc, v->nmap, v->nnormal );
+   }
+
+   if( ierr ) {
+      fprintf( stderr, " e [%s]  Could not load the groups \n", FUNC );
+      hdfy_FreeObjView( v );
+   }
+
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// Function to drop the arrays of a view
+//
+
+void hdfy_FreeObjView( struct hdfyObjView_s *v )
+{
+   long n;
+
+   if( v->names != NULL ) {
+      for(n=0;n<v->ngroup;++n) if( v->names[n] != NULL ) free( v->names[n] );
+      free( v->names );
+   }
+   if( v->fs != NULL ) free( v->fs );
+   if( v->fe != NULL ) free( v->fe );
+   if( v->offsets != NULL ) free( v->offsets );
+   if( v->jv != NULL ) free( v->jv );
+   if( v->jt != NULL ) free( v->jt );
+   if( v->jn != NULL ) free( v->jn );
+   if( v->vmap != NULL ) free( v->vmap );
+   if( v->tmap != NULL ) free( v->tmap );
+   if( v->nmap != NULL ) free( v->nmap );
+   if( v->vertices != NULL ) free( v->vertices );
+   if( v->texels != NULL ) free( v->texels );
+   if( v->normals != NULL ) free( v->normals );
+
+   memset( v, 0, sizeof(struct hdfyObjView_s) );
+}
+
+
+//
+// Function to open the texture of a material; the dataset's name is made
+// unique when it is written, so the texture is found by its "material"
+// attribute, and of materials with the same name the first one in the table
+// that has a texture is taken (as with the groups)
+//
+
+static hid_t hdfy_OpenTexture( const struct hdfyObjFile_s *f,
+                               const char *material )
+{
+   H5G_info_t info;
+   char name[256],*str;
+   hid_t gid,did,dbest=-1;
+   long n,nbest=-1;
+   hsize_t k;
+
+   if( f->fid < 0 || H5Lexists( f->fid, "textures", H5P_DEFAULT ) <= 0 ) {
+      return -1;
+   }
+   gid = H5Gopen2( f->fid, "textures", H5P_DEFAULT );
+   if( gid < 0 ) return -1;
+
+   if( H5Gget_info( gid, &info ) < 0 ) info.nlinks = 0;
+   for(k=0;k<info.nlinks;++k) {
+      if( H5Lget_name_by_idx( gid, ".", H5_INDEX_NAME, H5_ITER_INC, k,
+                              name, sizeof(name), H5P_DEFAULT ) < 0 ) continue;
+      did = H5Dopen2( gid, name, H5P_DEFAULT );
+      if( did < 0 ) continue;
+
+      str = hdfy_ReadAttrString( did, "material" );
+      if( str == NULL || strcmp( str, material ) != 0 ||
+          hdfy_ReadAttrInt( did, "index", &n ) != 0 ||
+          ( nbest >= 0 && n >= nbest ) ) {
+         H5Dclose( did );
+      } else {
+         if( dbest >= 0 ) H5Dclose( dbest );
+         dbest = did;
+         nbest = n;
+      }
+      if( str != NULL ) free( str );
+   }
+   H5Gclose( gid );
+
+   return dbest;
+}
+
+int hdfy_GetObjTextureSize( const struct hdfyObjFile_s *f,
+                            const char *material,
+                            unsigned int *width, unsigned int *height )
+{
+   hsize_t dims[3];
+   hid_t did,sid;
+
+   did = hdfy_OpenTexture( f, material );
+   if( did < 0 ) return 1;
+
+   sid = H5Dget_space( did );
+   H5Sget_simple_extent_dims( sid, dims, NULL );
+   H5Sclose( sid );
+   H5Dclose( did );
+   *width = (unsigned int) dims[1];
+   *height = (unsigned int) dims[0];
+
+   return 0;
+}
+
+
+//
+// Function to read a rectangle of a material's texture as RGBA bytes, top
+// row first; only the tiles that the rectangle touches are read
+//
+
+int hdfy_ReadObjTexture( const struct hdfyObjFile_s *f, const char *material,
+                         unsigned int x0, unsigned int y0,
+                         unsigned int width, unsigned int height,
+                         unsigned char *rgba )
+#define FUNC "hdfy_ReadObjTexture"
+{
+   hsize_t dims[3],off[3],cnt[3];
+   hid_t did,sid,mid;
+   int ierr=0;
+
+   did = hdfy_OpenTexture( f, material );
+   if( did < 0 ) {
+      fprintf( stderr, " e [%s]  No texture for \"%s\" \n", FUNC, material );
+      return 1;
+   }
+
+   sid = H5Dget_space( did );
+   H5Sget_simple_extent_dims( sid, dims, NULL );
+   if( (hsize_t) x0 + width > dims[1] || (hsize_t) y0 + height > dims[0] ) {
+      fprintf( stderr, " e [%s]  Rectangle outside the texture \n", FUNC );
+      ierr = 2;
+   } else if( width > 0 && height > 0 ) {
+      off[0] = y0;
+      off[1] = x0;
+      off[2] = 0;
+      cnt[0] = height;
+      cnt[1] = width;
+      cnt[2] = 4;
+      H5Sselect_hyperslab( sid, H5S_SELECT_SET, off, NULL, cnt, NULL );
+      mid = H5Screate_simple( 3, cnt, NULL );
+      if( H5Dread( did, H5T_NATIVE_UCHAR, mid, sid, H5P_DEFAULT, rgba ) < 0 ) {
+         ierr = 3;
+      }
+      H5Sclose( mid );
+   }
+   H5Sclose( sid );
+   H5Dclose( did );
 
-#warning "Have not even started on this..."
+   return ierr;
+}
+#undef FUNC
@@ -0,0 +1,140 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#ifndef _HDFY_OBJ_H_
+#define _HDFY_OBJ_H_
+
+#include "hdfy.h"
+#include "inobj.h"
+
+//
+// Writer of an OBJ object (as made by objReadFile()) to an HDF5 file:
+//   /vertices         float  [nv][3]
+//   /normals          float  [nn][3]
+//   /texels           float  [nt][2]
+//   /faces/offsets    index  [nf+1]    (CSR offsets in to the members)
+//   /faces/v          index  [nc]      (1-based; 0 is "not given"
+//   /faces/vt         index  [nc]       for texels and normals)
+//   /faces/vn         index  [nc]
+//   /groups           {name, face_start, face_end} [ng]
+//   /materials        {name, Ka, Kd, Ks, Ns, Ni, d, illum, map_Kd} [nm]
+//   /textures/<name>  uint8  [height][width][4]  (RGBA of a material's
+//                                               map_Kd, top row first)
+//   /corners/vertices float  [nk][8]   (with "corners" of the options: the
+//   /corners/index    index  [nc]       distinct (v,vt,vn) of the members as
+//   /corners/triangles index [ntri][3]  x y z s t nx ny nz, the 0-based
+//                                       corner of every member, and faces
+//                                       split as fans over the corners)
+// where "index" is an unsigned integer as wide as inObjIdx_t. Textures are
+// stored in square tiles ("tile" of the options) that are compressed on their
+// own, and carry the attributes of the HDF5 image convention, so a part of a
+// texture is read without decoding the whole image; the name of a texture is
+// made unique, and its "material" and "index" attributes give the material
+// that it belongs to.
+//
+// hdfy_ConvertObj() makes the same file straight from the OBJ file; batches
+// of the parser are queued ("depth" of the options) for a writer thread, so
+// parsing and writing overlap. The corners are made from the whole mesh, so
+// a conversion with them is not pipelined.
+// Such a file can be read back a few groups at a time. Opening it reads only
+// the sizes of the arrays and the group table; loading groups reads their
+// ranges of faces and then only the vertices, texels and normals that those
+// faces use, all with hyperslab selections.
+//
+
+// timings of a pipelined conversion
+struct hdfyPipeStats_s {
+   long nbatch;
+   double seconds;      // from the start of parsing to the last write
+   double parse_stall;  // parser waiting for a free slot (writer bound)
+   double write_idle;   // writer waiting for a batch (parser bound)
+};
+
+// a converted OBJ file opened for reading parts of it
+struct hdfyObjFile_s {
+   hid_t fid;
+   long nvertex, ntexel, nnormal, nface, ncorner;
+   long ngroup;
+   char **names;        // group names
+   long *fs, *fe;       // face bounds of the groups (0-based, end exclusive)
+};
+
+// the faces of some groups with only the elements that they use; arrays are
+// laid out like those of objGet*(), face members are 1-based indices in to
+// the arrays of the view (0 is "not given"), and "vmap", "tmap" and "nmap"
+// hold the (0-based) rows of the file that the elements came from
+struct hdfyObjView_s {
+   long nvertex, ntexel, nnormal, nface, ncorner;
+   float *vertices, *texels, *normals;
+   inObjIdx_t *offsets, *jv, *jt, *jn;
+   long *vmap, *tmap, *nmap;
+   long ngroup;
+   char **names;
+   long *fs, *fe;       // face bounds of the groups in the view
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int hdfy_WriteObj( void *p, const char *filename,
+                   const struct hdfyOpts_s *o );
+
+int hdfy_ConvertObj( const char *objfile, const char *filename,
+                     const struct hdfyOpts_s *o, struct hdfyPipeStats_s *st );
+
+int hdfy_OpenObj( const char *filename, struct hdfyObjFile_s *f );
+
+void hdfy_CloseObj( struct hdfyObjFile_s *f );
+
+long hdfy_FindObjGroup( const struct hdfyObjFile_s *f, const char *name );
+
+int hdfy_LoadObjGroups( const struct hdfyObjFile_s *f,
+                        int n, const char * const names[],
+                        struct hdfyObjView_s *v );
+
+void hdfy_FreeObjView( struct hdfyObjView_s *v );
+
+int hdfy_GetObjTextureSize( const struct hdfyObjFile_s *f,
+                            const char *material,
+                            unsigned int *width, unsigned int *height );
+
+int hdfy_ReadObjTexture( const struct hdfyObjFile_s *f, const char *material,
+                         unsigned int x0, unsigned int y0,
+                         unsigned int width, unsigned int height,
+                         unsigned char *rgba );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
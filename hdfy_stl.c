@@ -1,5 +1,276 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-#warning "Have not even started on this... Almost."
+#include "hdfy_stl.h"
+
+
+//
+// Function to write the columns of triangle records to an HDF5 file; the
+// float triplets are "fstride" bytes apart and the attributes "astride"
+//
+
+static int hdfy_WriteSTLColumns( const char *filename, const char *header80,
+                                 unsigned int ntri, const float *normals,
+                                 const float *vertex1, const float *vertex2,
+                                 const float *vertex3,
+                                 const unsigned short *attributes,
+                                 size_t fstride, size_t astride,
+                                 const struct hdfyOpts_s *o )
+#define FUNC "hdfy_WriteSTL"
+{
+   const hsize_t nt = (hsize_t) ntri;
+   char header[81];
+   hid_t fid;
+   int ierr=0;
+
+
+   if( filename == NULL ) return 1;
+
+   fid = hdfy_CreateFile( filename, "stl", NULL );
+   if( fid < 0 ) return 2;
+
+   memcpy( header, header80, 80 );
+   header[80] = '\0';
+   ierr += hdfy_WriteAttrString( fid, "header", header );
+   ierr += hdfy_WriteAttrInt( fid, "count", (long) ntri );
+
+   ierr += hdfy_WriteRows( fid, "normals", H5T_NATIVE_FLOAT, nt, 3,
+                           normals, fstride, o );
+   ierr += hdfy_WriteRows( fid, "vertex1", H5T_NATIVE_FLOAT, nt, 3,
+                           vertex1, fstride, o );
+   ierr += hdfy_WriteRows( fid, "vertex2", H5T_NATIVE_FLOAT, nt, 3,
+                           vertex2, fstride, o );
+   ierr += hdfy_WriteRows( fid, "vertex3", H5T_NATIVE_FLOAT, nt, 3,
+                           vertex3, fstride, o );
+   ierr += hdfy_WriteRows( fid, "attributes", H5T_NATIVE_USHORT, nt, 0,
+                           attributes, astride, o );
+
+   if( H5Fclose( fid ) < 0 ) ierr += 1;
+   if( ierr != 0 ) {
+      fprintf( stderr, " e [%s]  Failed writing file: \"%s\"\n", FUNC, filename );
+      return 3;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to write an STL triangle soup to an HDF5 file; every column is
+// taken out of the reader's array of records as it is written
+//
+
+int hdfy_WriteSTL( struct inSTL_s *sp, const char *filename,
+                   const struct hdfyOpts_s *o )
+{
+   const struct inSTLtri_s *tp = sp->triangles;
+   const int in = ( sp->ntri > 0 ? 1 : 0 );
+
+   if( sp->ntri > 0 && tp == NULL ) return 1;
+
+   return hdfy_WriteSTLColumns( filename, sp->header, sp->ntri,
+                                ( in ? tp->normal : NULL ),
+                                ( in ? tp->vertex1 : NULL ),
+                                ( in ? tp->vertex2 : NULL ),
+                                ( in ? tp->vertex3 : NULL ),
+                                ( in ? &( tp->iatrib ) : NULL ),
+                                sizeof(struct inSTLtri_s),
+                                sizeof(struct inSTLtri_s), o );
+}
+
+
+//
+// Function to write the separate arrays of a binary STL file to an HDF5 file
+// (the same layout); the columns are contiguous and go to the library as
+// they are
+//
+
+int hdfy_WriteSTLSoA( struct inSTLsoa_s *sp, const char *filename,
+                      const struct hdfyOpts_s *o )
+{
+   if( sp->ntri > 0 && ( sp->normals == NULL || sp->vertex1 == NULL ||
+                         sp->vertex2 == NULL || sp->vertex3 == NULL ||
+                         sp->attributes == NULL ) ) return 1;
+
+   return hdfy_WriteSTLColumns( filename, sp->header, sp->ntri,
+                                sp->normals, sp->vertex1, sp->vertex2,
+                                sp->vertex3, sp->attributes,
+                                3*sizeof(float), sizeof(unsigned short), o );
+}
+
+
+
+//
+// Streaming conversion: the triangles arrive in batches from the reader and
+// every batch is appended to datasets that grow with the file, so only a
+// batch of triangles is in memory at any time (plus the chunks that the
+// library caches). The datasets are made when the first batch arrives, so
+// that in the tuning mode they are tuned on it. The file has the layout of
+// hdfy_WriteSTL().
+//
+
+static const char *hdfy_stl_names[5] = { "normals", "vertex1", "vertex2",
+                                          "vertex3", "attributes" };
+
+struct hdfySTLstream_s {
+   hid_t fid;
+   const struct hdfyOpts_s *o;
+   hid_t did[5];
+   hsize_t nrow;        // rows in the datasets
+   int ierr;
+};
+
+static int hdfy_STLCreate( struct hdfySTLstream_s *q,
+                           const struct inSTLbatch_s *b )
+{
+   const struct inSTLtri_s *tp = ( b != NULL ? b->triangles : NULL );
+   const void *base;
+   int k;
+
+   for(k=0;k<5;++k) {
+      base = NULL;
+      if( tp != NULL ) {
+         base = ( k == 0 ? (const void *) tp->normal :
+                ( k == 1 ? (const void *) tp->vertex1 :
+                ( k == 2 ? (const void *) tp->vertex2 :
+                ( k == 3 ? (const void *) tp->vertex3 :
+                           (const void *) &( tp->iatrib ) ) ) ) );
+      }
+      q->did[k] = hdfy_CreateGrowingTuned( q->fid, hdfy_stl_names[k],
+                              ( k < 4 ? H5T_NATIVE_FLOAT : H5T_NATIVE_USHORT ),
+                              ( k < 4 ? H5T_NATIVE_FLOAT : H5T_NATIVE_USHORT ),
+                              ( k < 4 ? 3 : 0 ),
+                              (hsize_t) ( tp != NULL ? b->ntri : 0 ),
+                              base, sizeof(struct inSTLtri_s), q->o );
+      if( q->did[k] < 0 ) q->ierr = 1;
+   }
+
+   return q->ierr;
+}
+
+static int hdfy_STLAppend( const struct inSTLbatch_s *b, void *user )
+{
+   struct hdfySTLstream_s *q = (struct hdfySTLstream_s *) user;
+   const struct inSTLtri_s *tp = b->triangles;
+   const size_t stride = sizeof(struct inSTLtri_s);
+   const hsize_t n = (hsize_t) b->ntri;
+   hsize_t dims[2];
+   int k;
+
+   if( n == 0 ) return 0;
+   if( q->did[0] < 0 && hdfy_STLCreate( q, b ) != 0 ) return q->ierr;
+
+   dims[0] = q->nrow + n;
+   dims[1] = 3;
+   for(k=0;k<5;++k) {
+      if( H5Dset_extent( q->did[k], dims ) < 0 ) q->ierr = 1;
+   }
+   if( q->ierr == 0 ) {
+      q->ierr += hdfy_WriteSlab( q->did[0], H5T_NATIVE_FLOAT, q->nrow, n, 3,
+                                 tp->normal, stride, H5P_DEFAULT );
+      q->ierr += hdfy_WriteSlab( q->did[1], H5T_NATIVE_FLOAT, q->nrow, n, 3,
+                                 tp->vertex1, stride, H5P_DEFAULT );
+      q->ierr += hdfy_WriteSlab( q->did[2], H5T_NATIVE_FLOAT, q->nrow, n, 3,
+                                 tp->vertex2, stride, H5P_DEFAULT );
+      q->ierr += hdfy_WriteSlab( q->did[3], H5T_NATIVE_FLOAT, q->nrow, n, 3,
+                                 tp->vertex3, stride, H5P_DEFAULT );
+      q->ierr += hdfy_WriteSlab( q->did[4], H5T_NATIVE_USHORT, q->nrow, n, 0,
+                                 &( tp->iatrib ), stride, H5P_DEFAULT );
+   }
+   q->nrow += n;
+
+   return q->ierr;
+}
+
+
+//
+// Function to convert an STL file (binary or ASCII) to an HDF5 file while it
+// is read, in batches of "o->batch" triangles
+//
+
+int hdfy_ConvertSTL( const char *stlfile, const char *filename,
+                     const struct hdfyOpts_s *o )
+#define FUNC "hdfy_ConvertSTL"
+{
+   struct hdfyOpts_s od;
+   struct hdfySTLstream_s q;
+   struct inSTL_s stl;
+   char header[81];
+   hid_t fid;
+   int n,ierr=0;
+
+
+   if( stlfile == NULL || filename == NULL ) return 1;
+
+   if( o == NULL ) {
+      hdfy_InitOpts( &od );
+   } else {
+      od = *o;
+   }
+   if( od.batch <= 0 ) od.batch = 262144;
+
+   memset( &q, 0, sizeof(q) );
+   for(n=0;n<5;++n) q.did[n] = -1;
+   fid = hdfy_CreateFile( filename, "stl", NULL );
+   if( fid < 0 ) return 2;
+   q.fid = fid;
+   q.o = &od;
+
+   if( inSTL_StreamSTL( (char *) stlfile, (unsigned int) od.batch,
+                        hdfy_STLAppend, &q, &stl ) != 0 ) ierr = 4;
+   // a file without triangles still gets its (empty) datasets
+   if( ierr == 0 && q.did[0] < 0 && hdfy_STLCreate( &q, NULL ) != 0 ) {
+      ierr = 3;
+   }
+   if( ierr == 0 ) {
+      memcpy( header, stl.header, 80 );
+      header[80] = '\0';
+      ierr += hdfy_WriteAttrString( fid, "header", header );
+      ierr += hdfy_WriteAttrInt( fid, "count", (long) q.nrow );
+   }
+
+   for(n=0;n<5;++n) if( q.did[n] >= 0 ) H5Dclose( q.did[n] );
+   if( H5Fclose( fid ) < 0 ) ierr += 1;
+   if( ierr != 0 ) {
+      fprintf( stderr, " e [%s]  Failed converting file: \"%s\"\n",
+               FUNC, stlfile );
+      return 5;
+   }
+
+   return 0;
+}
+#undef FUNC
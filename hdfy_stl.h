@@ -0,0 +1,71 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#ifndef _HDFY_STL_H_
+#define _HDFY_STL_H_
+
+#include "hdfy.h"
+#include "stl.h"
+
+//
+// Writer of an STL triangle soup to an HDF5 file, one dataset per column of
+// the triangle records:
+//   /normals          float  [nt][3]
+//   /vertex1          float  [nt][3]
+//   /vertex2          float  [nt][3]
+//   /vertex3          float  [nt][3]
+//   /attributes       uint16 [nt]
+// with the 80-byte header of the STL file as an attribute of the root. The
+// separate arrays of inSTL_ReadBinarySTLSoA() make the same file, and so
+// does hdfy_ConvertSTL(), which streams the input in batches of triangles
+// in to growing datasets and needs memory for one batch whatever the size
+// of the file.
+//
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int hdfy_WriteSTL( struct inSTL_s *sp, const char *filename,
+                   const struct hdfyOpts_s *o );
+
+int hdfy_WriteSTLSoA( struct inSTLsoa_s *sp, const char *filename,
+                      const struct hdfyOpts_s *o );
+
+int hdfy_ConvertSTL( const char *stlfile, const char *filename,
+                     const struct hdfyOpts_s *o );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,321 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include <charconv>
+
+#include "infloat.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define _INFLT_SWAR_
+#endif
+
+//
+// Most numbers in mesh files have few significant digits and a small decimal
+// exponent. For those, the mantissa is an exact float and so is the power of
+// ten, and a single (correctly rounded) multiplication or division gives the
+// correctly rounded result (Clinger's fast path). The same is done in double
+// precision for longer mantissas, and the double is narrowed to a float unless
+// it sits exactly on a midpoint between two floats, which is the only case
+// where rounding twice could differ from rounding once. Everything else goes to
+// std::from_chars, which is correctly rounded as well (Eisel-Lemire in modern
+// standard libraries) and does not look at the locale.
+//
+
+static const float inflt_pow10[11] = {
+   1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+static const double inflt_pow10d[23] = {
+   1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#ifdef _INFLT_SWAR_
+// eight ASCII digits at once in a 64bit word ("SIMD within a register")
+static inline int inflt_IsEightDigits( uint64_t w )
+{
+   return ( ( ( w & 0xF0F0F0F0F0F0F0F0ULL ) |
+              ( ( ( w + 0x0606060606060606ULL ) & 0xF0F0F0F0F0F0F0F0ULL ) >> 4 ) )
+            == 0x3333333333333333ULL );
+}
+
+static inline uint32_t inflt_EightDigits( uint64_t w )
+{
+   const uint64_t mask = 0x000000FF000000FFULL;
+   const uint64_t mul1 = 0x000F424000000064ULL;   // 100 + (1000000 << 32)
+   const uint64_t mul2 = 0x0000271000000001ULL;   // 1 + (10000 << 32)
+   w -= 0x3030303030303030ULL;
+   w = ( w * 10 ) + ( w >> 8 );
+   w = ( ( ( w & mask ) * mul1 ) + ( ( ( w >> 16 ) & mask ) * mul2 ) ) >> 32;
+   return (uint32_t) w;
+}
+#endif
+
+static inline int inflt_IsDigit( char c )
+{
+   return ( (unsigned int) ( c - '0' ) < 10 );
+}
+
+// the slow path; from_chars leaves the value alone when it is out of range,
+// so we saturate the way strtof() does
+static const char* inflt_ParseSlow( const char* s, const char* e, float* v )
+{
+   const char* t = s;
+   if( t < e && *t == '+' ) {
+      ++t;
+      if( t < e && *t == '-' ) return NULL;
+   }
+
+   float f;
+   std::from_chars_result r = std::from_chars( t, e, f );
+   if( r.ec == std::errc::invalid_argument ) return NULL;
+   if( r.ec == std::errc::result_out_of_range ) {
+      int ineg=0, ni=0, nz=0, ie=0, ineg2=0;
+      const char* p = t;
+      if( *p == '-' ) { ineg = 1; ++p; }
+      while( p < r.ptr && *p == '0' ) ++p;
+      while( p < r.ptr && inflt_IsDigit( *p ) ) { ++ni; ++p; }
+      if( p < r.ptr && *p == '.' ) {
+         ++p;
+         if( ni == 0 ) while( p < r.ptr && *p == '0' ) { ++nz; ++p; }
+      }
+      while( p < r.ptr && *p != 'e' && *p != 'E' ) ++p;
+      if( p < r.ptr ) {
+         ++p;
+         if( *p == '-' || *p == '+' ) { ineg2 = ( *p == '-' ); ++p; }
+         while( p < r.ptr && ie < 100000 ) { ie = ie*10 + ( *p - '0' ); ++p; }
+      }
+      if( ineg2 ) ie = -ie;
+      const int imag = ( ni > 0 ? ni : -nz ) + ie;
+      f = ( imag > 0 ? HUGE_VALF : 0.0f );
+      if( ineg ) f = -f;
+   }
+   *v = f;
+
+   return r.ptr;
+}
+
+const char* inflt_ParseFloat( const char* s, const char* e, float* v )
+{
+   const char* p = s;
+   int ineg = 0;
+   if( p < e && ( *p == '-' || *p == '+' ) ) {
+      ineg = ( *p == '-' );
+      ++p;
+   }
+
+   uint64_t m = 0;
+   int nd = 0, iexp = 0;
+   while( p < e && inflt_IsDigit( *p ) ) {
+      m = m*10 + (uint64_t) ( *p - '0' );
+      ++p;
+      ++nd;
+   }
+   if( p < e && *p == '.' ) {
+      ++p;
+      const char* f = p;
+#ifdef _INFLT_SWAR_
+      while( e - p >= 8 ) {
+         uint64_t w;
+         memcpy( &w, p, 8 );
+         if( !inflt_IsEightDigits( w ) ) break;
+         m = m*100000000 + inflt_EightDigits( w );
+         p += 8;
+      }
+#endif
+      while( p < e && inflt_IsDigit( *p ) ) {
+         m = m*10 + (uint64_t) ( *p - '0' );
+         ++p;
+      }
+      iexp = - (int) ( p - f );
+      nd += (int) ( p - f );
+   }
+   if( nd == 0 || nd > 19 ) return inflt_ParseSlow( s, e, v );
+
+   if( p < e && ( *p == 'e' || *p == 'E' ) ) {
+      const char* t = p+1;
+      int ie=0, ineg2=0;
+      if( t < e && ( *t == '-' || *t == '+' ) ) {
+         ineg2 = ( *t == '-' );
+         ++t;
+      }
+      if( t < e && inflt_IsDigit( *t ) ) {
+         while( t < e && inflt_IsDigit( *t ) ) {
+            if( ie < 100000 ) ie = ie*10 + ( *t - '0' );
+            ++t;
+         }
+         iexp += ( ineg2 ? -ie : ie );
+         p = t;
+      }
+      // otherwise the exponent is incomplete and the number ends before it
+   }
+
+   float f;
+   if( m == 0 ) {
+      f = 0.0f;
+   } else if( m <= ( 1 << 24 ) && iexp >= -10 && iexp <= 10 ) {
+      f = (float) m;
+      if( iexp < 0 ) {
+         f /= inflt_pow10[ -iexp ];
+      } else {
+         f *= inflt_pow10[ iexp ];
+      }
+   } else if( m <= ( 1ULL << 53 ) && iexp >= -22 && iexp <= 22 ) {
+      double d = (double) m;
+      if( iexp < 0 ) {
+         d /= inflt_pow10d[ -iexp ];
+      } else {
+         d *= inflt_pow10d[ iexp ];
+      }
+      uint64_t b;
+      memcpy( &b, &d, 8 );
+      const uint64_t ilow = b & 0x1FFFFFFFULL;    // bits a float does not keep
+      if( ilow >= 0x0FFFFFFFULL && ilow <= 0x10000001ULL ) {
+         return inflt_ParseSlow( s, e, v );
+      }
+      f = (float) d;
+   } else {
+      return inflt_ParseSlow( s, e, v );
+   }
+   *v = ( ineg ? -f : f );
+
+   return p;
+}
+
+const char* inflt_ParseFloats( const char* s, const char* e, int n, float* v )
+{
+   const char* p = s;
+   for(int i=0;i<n;++i) {
+      while( p < e && ( *p == ' ' || *p == '\t' || *p == '\r' ) ) ++p;
+      p = inflt_ParseFloat( p, e, &( v[i] ) );
+      if( p == NULL ) return NULL;
+   }
+
+   return p;
+}
+
+
+#ifdef _BENCH_
+//
+// Micro-benchmark of the kernel against sscanf() and strtof(); also checks
+// that every number parses to the same bits as strtof() returns.
+// Build with "make bench" and run "./bench_float [count]".
+//
+
+#include <sys/time.h>
+
+static double inflt_Time()
+{
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return( (double) tv.tv_sec + 1.0e-6 * (double) tv.tv_usec );
+}
+
+int main( int argc, char *argv[] )
+{
+   size_t num = 4000000;
+   if( argc > 1 ) num = (size_t) atol( argv[1] );
+
+   // a mix of what exporters write: fixed, shortest-ish, and scientific
+   size_t nbytes = num * 32;
+   char* text = (char*) malloc( nbytes );
+   float* v1 = (float*) malloc( num * sizeof(float) );
+   float* v2 = (float*) malloc( num * sizeof(float) );
+   if( text == NULL || v1 == NULL || v2 == NULL ) {
+      fprintf( stdout, " [Error]  Could not allocate benchmark buffers \n" );
+      return 1;
+   }
+   srand( 12345 );
+   size_t n=0;
+   for(size_t i=0;i<num;++i) {
+      double r = ( (double) rand() / (double) RAND_MAX - 0.5 ) * 200.0;
+      switch( i % 4 ) {
+       case 0: n += sprintf( &( text[n] ), "%.6f ", r ); break;
+       case 1: n += sprintf( &( text[n] ), "%.9g ", r ); break;
+       case 2: n += sprintf( &( text[n] ), "%e ", r * 1.0e-7 ); break;
+       case 3: n += sprintf( &( text[n] ), "%.4f ", r * 0.01 ); break;
+      }
+   }
+   const char* e = &( text[n] );
+   fprintf( stdout, " Numbers: %ld   Bytes: %ld \n", (long) num, (long) n );
+
+   double t0 = inflt_Time();
+   const char* p = inflt_ParseFloats( text, e, (int) num, v1 );
+   double t1 = inflt_Time();
+   if( p == NULL ) {
+      fprintf( stdout, " [Error]  Kernel failed to parse the buffer \n" );
+      return 2;
+   }
+   fprintf( stdout, " inflt_ParseFloats: %8.3f s  %8.1f MB/s \n",
+            t1-t0, ( (double) n ) / ( t1-t0 ) / 1.0e6 );
+
+   char* q = text;
+   t0 = inflt_Time();
+   for(size_t i=0;i<num;++i) v2[i] = strtof( q, &q );
+   t1 = inflt_Time();
+   fprintf( stdout, " strtof:            %8.3f s  %8.1f MB/s \n",
+            t1-t0, ( (double) n ) / ( t1-t0 ) / 1.0e6 );
+
+   size_t nbad=0;
+   for(size_t i=0;i<num;++i) {
+      if( memcmp( &( v1[i] ), &( v2[i] ), sizeof(float) ) != 0 ) ++nbad;
+   }
+   fprintf( stdout, " Mismatches against strtof: %ld \n", (long) nbad );
+
+   q = text;
+   t0 = inflt_Time();
+   for(size_t i=0;i<num;++i) {
+      // (glibc's sscanf runs strlen() on its input; give it one token)
+      char tok[64];
+      size_t k=0;
+      while( *q != ' ' && k < 63 ) tok[k++] = *q++;
+      tok[k] = '\0';
+      ++q;
+      sscanf( tok, "%f", &( v2[i] ) );
+   }
+   t1 = inflt_Time();
+   fprintf( stdout, " sscanf:            %8.3f s  %8.1f MB/s \n",
+            t1-t0, ( (double) n ) / ( t1-t0 ) / 1.0e6 );
+
+   free( text );
+   free( v1 );
+   free( v2 );
+
+   return( nbad ? 3 : 0 );
+}
+#endif
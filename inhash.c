@@ -0,0 +1,290 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "inhash.h"
+
+
+//
+// Function to mix three keys in to a hash; the leading bits pick the
+// partition and the trailing bits the slot in its table
+//
+
+uint64_t inhash_Mix( uint64_t a, uint64_t b, uint64_t c )
+{
+   uint64_t h;
+
+   h = a * 0x9E3779B185EBCA87ULL;
+   h ^= b * 0xC2B2AE3D27D4EB4FULL;
+   h ^= c * 0x165667B19E3779F9ULL;
+   h ^= h >> 29;
+   h *= 0xBF58476D1CE4E5B9ULL;
+   h ^= h >> 32;
+   return h;
+}
+
+static int inhash_Part( uint64_t h )
+{
+   return (int) ( h >> 58 );          // 64 partitions
+}
+
+
+//
+// Function to run "fn" on "nthreads" threads, the calling one included;
+// threads that cannot be started have their share done by the caller
+//
+
+struct inhashRun_s {
+   void (*fn)( int, void * );
+   void *arg;
+   int it;
+};
+
+static void* inhash_RunOne( void *arg )
+{
+   struct inhashRun_s *r = (struct inhashRun_s *) arg;
+
+   r->fn( r->it, r->arg );
+   return NULL;
+}
+
+int inhash_Run( int nthreads, void (*fn)( int it, void *arg ), void *arg )
+{
+   struct inhashRun_s r[INHASH_NPART];
+   pthread_t th[INHASH_NPART];
+   int it,nrun=0;
+
+   if( nthreads > INHASH_NPART ) nthreads = INHASH_NPART;
+   for(it=0;it<nthreads;++it) {
+      r[it].fn = fn;
+      r[it].arg = arg;
+      r[it].it = it;
+   }
+   for(it=1;it<nthreads;++it) {
+      if( pthread_create( &( th[it] ), NULL, inhash_RunOne, &( r[it] ) ) ) {
+         break;
+      }
+      ++nrun;
+   }
+   fn( 0, arg );
+   for(it=nrun+1;it<nthreads;++it) fn( it, arg );
+   for(it=1;it<=nrun;++it) pthread_join( th[it], NULL );
+
+   return 0;
+}
+
+
+//
+// Phases of the build: the hashes and the counts of the partitions, the
+// stable scatter to the partitions, and the tables, one partition at a time
+//
+
+struct inhashBuild_s {
+   struct inhash_s *t;
+   inhashKeyFn key;
+   inhashSameFn same;
+   inhashIdx_t *lead;         // [n] first item with the same key
+   inhashIdx_t *order;        // [n] items by partition
+   size_t *hist;              // [nthreads][INHASH_NPART]
+   int iphase;
+};
+
+static void inhash_Phase( int it, void *arg )
+{
+   struct inhashBuild_s *b = (struct inhashBuild_s *) arg;
+   struct inhash_s *t = b->t;
+   const size_t i0 = t->n * (size_t) it / (size_t) t->nthreads;
+   const size_t i1 = t->n * (size_t) ( it + 1 ) / (size_t) t->nthreads;
+   size_t *hist = &( b->hist[ (size_t) it * INHASH_NPART ] );
+   size_t i,c,l,m,nt;
+   inhashIdx_t *s;
+   int ip;
+
+   if( b->iphase == 0 ) {
+      for(i=i0;i<i1;++i) {
+         t->hash[i] = b->key( i, t->user );
+         ++( hist[ inhash_Part( t->hash[i] ) ] );
+      }
+   } else if( b->iphase == 1 ) {
+      // "hist" holds the offsets now
+      for(i=i0;i<i1;++i) {
+         b->order[ ( hist[ inhash_Part( t->hash[i] ) ] )++ ] =
+            (inhashIdx_t) i;
+      }
+   } else {
+      for(ip=it;ip<INHASH_NPART;ip+=t->nthreads) {
+         nt = t->tbase[ip+1] - t->tbase[ip];
+         s = &( t->slots[ t->tbase[ip] ] );
+         for(i=t->pstart[ip];i<t->pstart[ip+1];++i) {
+            c = (size_t) b->order[i];
+            for(m=(size_t) t->hash[c] & (nt-1);;m=(m+1) & (nt-1)) {
+               if( s[m] == 0 ) {
+                  s[m] = (inhashIdx_t) ( c + 1 );
+                  b->lead[c] = (inhashIdx_t) c;
+                  break;
+               }
+               l = (size_t) s[m] - 1;
+               if( t->hash[l] == t->hash[c] && b->same( l, c, t->user ) ) {
+                  b->lead[c] = (inhashIdx_t) l;
+                  break;
+               }
+            }
+         }
+      }
+   }
+}
+
+
+//
+// Function to group "n" items by their keys; the first item with the key of
+// item "i" is left in "lead[i]" (of "n" items), and the tables are kept for
+// inhash_Find() until inhash_Free()
+//
+
+int inhash_Build( struct inhash_s *t, size_t n, int nthreads,
+                  inhashKeyFn key, inhashSameFn same, void *user,
+                  inhashIdx_t *lead )
+#define FUNC "inhash_Build"
+{
+   struct inhashBuild_s b;
+   size_t nt,off,c;
+   int ip,it,ierr=0;
+
+
+   memset( t, 0, sizeof(struct inhash_s) );
+   if( n >= (size_t) ( (inhashIdx_t) -1 ) ) {
+      fprintf( stderr, " e [%s]  Too many items for %d-bit indices \n",
+               FUNC, (int) ( 8*sizeof(inhashIdx_t) ) );
+      return 1;
+   }
+   if( nthreads <= 0 ) nthreads = 1;
+   if( nthreads > INHASH_NPART ) nthreads = INHASH_NPART;
+   if( (size_t) nthreads > n / 65536 + 1 ) nthreads = (int) ( n / 65536 + 1 );
+   t->n = n;
+   t->nthreads = nthreads;
+   t->user = user;
+
+   memset( &b, 0, sizeof(b) );
+   b.t = t;
+   b.key = key;
+   b.same = same;
+   b.lead = lead;
+   t->hash = (uint64_t *) malloc( ( n > 0 ? n : 1 ) * sizeof(uint64_t) );
+   b.order = (inhashIdx_t *) malloc( ( n > 0 ? n : 1 ) *
+                                     sizeof(inhashIdx_t) );
+   b.hist = (size_t *) calloc( (size_t) nthreads * INHASH_NPART,
+                               sizeof(size_t) );
+   if( t->hash == NULL || b.order == NULL || b.hist == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate arrays \n", FUNC );
+      ierr = 1;
+   }
+
+   if( ierr == 0 ) {
+      b.iphase = 0;
+      inhash_Run( nthreads, inhash_Phase, &b );
+
+      // partition starts, and per thread offsets into them
+      off = 0;
+      for(ip=0;ip<INHASH_NPART;++ip) {
+         t->pstart[ip] = off;
+         for(it=0;it<nthreads;++it) {
+            c = b.hist[ (size_t) it * INHASH_NPART + ip ];
+            b.hist[ (size_t) it * INHASH_NPART + ip ] = off;
+            off += c;
+         }
+      }
+      t->pstart[INHASH_NPART] = off;
+      b.iphase = 1;
+      inhash_Run( nthreads, inhash_Phase, &b );
+
+      // tables of twice the items of a partition, in powers of two
+      off = 0;
+      for(ip=0;ip<INHASH_NPART;++ip) {
+         t->tbase[ip] = off;
+         nt = 0;
+         if( t->pstart[ip+1] > t->pstart[ip] ) {
+            for(nt=2;nt<2*( t->pstart[ip+1] - t->pstart[ip] );nt*=2) {}
+         }
+         off += nt;
+      }
+      t->tbase[INHASH_NPART] = off;
+      t->slots = (inhashIdx_t *) calloc( ( off > 0 ? off : 1 ),
+                                         sizeof(inhashIdx_t) );
+      if( t->slots == NULL ) {
+         fprintf( stderr, " e [%s]  Could not allocate tables \n", FUNC );
+         ierr = 1;
+      } else {
+         b.iphase = 2;
+         inhash_Run( nthreads, inhash_Phase, &b );
+      }
+   }
+
+   if( b.order != NULL ) free( b.order );
+   if( b.hist != NULL ) free( b.hist );
+   if( ierr ) inhash_Free( t );
+
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// Function to find the first item of a key that is not one of the items;
+// "match" compares the key of an item to "key" and "h" is the key's hash
+//
+
+size_t inhash_Find( const struct inhash_s *t, uint64_t h,
+                    inhashMatchFn match, const void *key )
+{
+   const int ip = inhash_Part( h );
+   const size_t nt = t->tbase[ip+1] - t->tbase[ip];
+   const inhashIdx_t *s = &( t->slots[ t->tbase[ip] ] );
+   size_t m,l;
+
+   if( nt == 0 ) return INHASH_NONE;
+   for(m=(size_t) h & (nt-1);;m=(m+1) & (nt-1)) {
+      if( s[m] == 0 ) return INHASH_NONE;
+      l = (size_t) s[m] - 1;
+      if( t->hash[l] == h && match( l, key, t->user ) ) return l;
+   }
+}
+
+void inhash_Free( struct inhash_s *t )
+{
+   if( t->hash != NULL ) free( t->hash );
+   if( t->slots != NULL ) free( t->slots );
+   memset( t, 0, sizeof(struct inhash_s) );
+}
@@ -0,0 +1,96 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#ifndef _INHASH_H_
+#define _INHASH_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+
+//
+// Grouping of items by equal keys, shared by the welding of STL corners and
+// the corners of OBJ faces. The items are hashed in parallel ranges and put
+// in partitions by the leading bits of their hash with a stable counting
+// sort; a thread then builds the open-addressing table of each of its
+// partitions in the order of the items, so the first item of a key leads it
+// and the result does not depend on the number of threads. The caller gives
+// the hash of an item and the comparison of the keys of two items; both are
+// called from several threads at once. Items are counted in the width of
+// the face indices of OBJ meshes (_INOBJ_INDEX64_), which keeps the tables
+// small when that is 32 bits.
+//
+
+#define INHASH_NPART  64
+#define INHASH_NONE   ( (size_t) -1 )
+
+#ifdef _INOBJ_INDEX64_
+typedef uint64_t inhashIdx_t;
+#else
+typedef uint32_t inhashIdx_t;
+#endif
+
+typedef uint64_t (*inhashKeyFn)( size_t i, void *user );
+typedef int (*inhashSameFn)( size_t l, size_t i, void *user );
+typedef int (*inhashMatchFn)( size_t l, const void *key, void *user );
+
+struct inhash_s {
+   size_t n;                  // items
+   int nthreads;
+   uint64_t *hash;            // [n]
+   size_t pstart[INHASH_NPART+1];
+   size_t tbase[INHASH_NPART+1];
+   inhashIdx_t *slots;        // tables of the partitions; item+1, 0 is free
+   void *user;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t inhash_Mix( uint64_t a, uint64_t b, uint64_t c );
+
+int inhash_Run( int nthreads, void (*fn)( int it, void *arg ), void *arg );
+
+int inhash_Build( struct inhash_s *t, size_t n, int nthreads,
+                  inhashKeyFn key, inhashSameFn same, void *user,
+                  inhashIdx_t *lead );
+
+size_t inhash_Find( const struct inhash_s *t, uint64_t h,
+                    inhashMatchFn match, const void *key );
+
+void inhash_Free( struct inhash_s *t );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
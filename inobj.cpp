@@ -35,8 +35,16 @@
 #include <string.h>
 #include <unistd.h>
 #include <math.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <thread>
 
 #include "inobj.h"
+#include "infloat.h"
+#include "intec.h"
+#include "inhash.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -76,16 +84,30 @@ int inObj::read( const char filename_[] )
    }
    filename = filename_;
 
-   fp = fopen( filename_, "r" );
-   if( fp == NULL ) {
-   fprintf( stdout, " [Error]  Could not open file: \"%s\"\n", filename_ );
-      filename.clear();
-      return -1;
+   // try to map the file; anything that cannot be mapped (pipes, devices,
+   // empty files) falls back to the FILE* line reader
+   int imap = 0;
+   if( read_mode == ReadMmap ) {
+      if( mapFile( filename_ ) == 0 ) imap = 1;
+   }
+
+   if( imap == 0 ) {
+      fp = fopen( filename_, "r" );
+      if( fp == NULL ) {
+      fprintf( stdout, " [Error]  Could not open file: \"%s\"\n", filename_ );
+         filename.clear();
+         return -1;
+      }
    }
    istate = Open;
 
    // abstraction to allow for iterative parsing...
-   int iret = parse();
+   int iret;
+   if( imap && num_threads > 1 && stream_fn == NULL ) {
+      iret = parseParallel();
+   } else {
+      iret = parse();
+   }
    if( iret ) {
       filename.clear();
       iret = 1;
@@ -94,7 +116,12 @@ int inObj::read( const char filename_[] )
       istate = Ready;
    }
 
-   fclose( fp );
+   if( imap ) {
+      unmapFile();
+   } else {
+      fclose( fp );
+   }
+   fp = NULL;
 
    // real the matllib file
    if( iret == 0 ) {
@@ -113,6 +140,40 @@ int inObj::read( const char filename_[] )
    return iret;
 }
 
+void inObj::setReadMode( int imode )
+{
+   if( ( imode & ReadMmap ) == 0 ) {
+      read_mode = ReadStdio;
+   } else {
+      read_mode = ReadMmap;
+   }
+   if( imode & ReadPrescan ) iprescan = 1;
+}
+
+void inObj::setNumThreads( int n )
+{
+   if( n <= 0 ) {
+      n = (int) std::thread::hardware_concurrency();
+      if( n <= 0 ) n = 1;
+   }
+   num_threads = n;
+}
+
+void inObj::setPrescan( int iflag )
+{
+   iprescan = iflag;
+}
+
+void inObj::getCounts( struct inObjCounts_s* c ) const
+{
+   c->nvertex = vbase + (long) vertex.size();
+   c->ntexel = tbase + (long) texel.size();
+   c->nnormal = nbase + (long) normal.size();
+   c->nface = (long) dgroup.fe;
+   c->ncorner = cbase + (long) jv.size();
+   c->ngroup = (long) num_groups;
+}
+
 int inObj::getState() const
 {
    return( istate );
@@ -142,7 +203,14 @@ void inObj::clear()
    normal.clear();
    texel.clear();
    icsr.clear();
-   jcsr.clear();
+   jv.clear();
+   jt.clear();
+   jn.clear();
+   cvert.clear();
+   kcorner.clear();
+   fixes.clear();
+   vbase = tbase = nbase = cbase = 0;
+   gsent = 0;
 
    istate = Unknown;
 }
@@ -172,6 +240,195 @@ const char* inObj::getGroupName( short n ) const
    }
 }
 
+int inObj::getNumMaterials() const
+{
+   return (int) mtls.size();
+}
+
+int inObj::getMaterial( int n, struct inObjMaterial_s* m ) const
+{
+   if( n < 0 || n >= (int) mtls.size() ) return 1;
+
+   const struct inObjMtl_s & mtl = mtls[n];
+   m->name = mtl.name.c_str();
+   for(int k=0;k<3;++k) {
+      m->Ka[k] = mtl.Ka[k];
+      m->Kd[k] = mtl.Kd[k];
+      m->Ks[k] = mtl.Ks[k];
+   }
+   m->Ns = mtl.Ns;
+   m->Ni = mtl.Ni;
+   m->d = mtl.d;
+   m->illum = (int) mtl.illum;
+   m->map_Kd = mtl.map_Kd.c_str();
+
+   return 0;
+}
+
+// the texture (map_Kd) of a material as RGBA bytes, top row first
+const unsigned char* inObj::getTexture( int n, unsigned int* width,
+                                        unsigned int* height ) const
+{
+   if( n < 0 || n >= (int) mtls.size() ) return NULL;
+
+   const struct inImage_s & img = mtls[n].img;
+   if( ( img.type != FILEMAGIC_JPEG && img.type != FILEMAGIC_TIFF ) ||
+       img.img_data == NULL ) return NULL;
+
+   *width = img.width;
+   *height = img.height;
+   return (const unsigned char*) img.img_data;
+}
+
+const float* inObj::getVertices( long* n ) const
+{
+   *n = (long) vertex.size();
+   return( vertex.size() ? &( vertex[0].x ) : NULL );
+}
+
+const float* inObj::getNormals( long* n ) const
+{
+   *n = (long) normal.size();
+   return( normal.size() ? &( normal[0].x ) : NULL );
+}
+
+const float* inObj::getTexels( long* n ) const
+{
+   *n = (long) texel.size();
+   return( texel.size() ? &( texel[0].u ) : NULL );
+}
+
+const inObjIdx_t* inObj::getFaceOffsets( long* n ) const
+{
+   *n = (long) icsr.size() - 1;
+   if( *n < 0 ) *n = 0;
+   return( icsr.size() ? icsr.data() : NULL );
+}
+
+const inObjIdx_t* inObj::getFaceVertexIndices( long* n ) const
+{
+   *n = (long) jv.size();
+   return( jv.size() ? jv.data() : NULL );
+}
+
+const inObjIdx_t* inObj::getFaceTexelIndices( long* n ) const
+{
+   *n = (long) jt.size();
+   return( jt.size() ? jt.data() : NULL );
+}
+
+const inObjIdx_t* inObj::getFaceNormalIndices( long* n ) const
+{
+   *n = (long) jn.size();
+   return( jn.size() ? jn.data() : NULL );
+}
+
+const float* inObj::getCorners( long* n ) const
+{
+   *n = (long) ( cvert.size() / INOBJ_CORNER_FLOATS );
+   return( cvert.size() ? cvert.data() : NULL );
+}
+
+const inObjIdx_t* inObj::getCornerIndices( long* n ) const
+{
+   *n = (long) kcorner.size();
+   return( kcorner.size() ? kcorner.data() : NULL );
+}
+
+//
+// Method to build the unified corners of the faces (see makeCorners())
+//
+
+int inObj::buildCorners( int nthreads )
+{
+   if( nthreads <= 0 ) nthreads = num_threads;
+   return makeCorners( cvert, kcorner, nthreads );
+}
+
+//
+// Method to find the distinct (v,vt,vn) triplets of the face members. The
+// members are grouped by their triplets with inhash_Build(), so the first
+// member of a triplet leads it. The numbering is a serial pass in the order
+// of the members, and does not depend on the number of threads.
+//
+
+struct inObjCornerKey_s {
+   const inObjIdx_t *jv,*jt,*jn;
+};
+
+static uint64_t inObj_CornerKey( size_t i, void *user )
+{
+   const struct inObjCornerKey_s *k = (const struct inObjCornerKey_s *) user;
+   return inhash_Mix( (uint64_t) k->jv[i], (uint64_t) k->jt[i],
+                      (uint64_t) k->jn[i] );
+}
+
+static int inObj_CornerSame( size_t l, size_t i, void *user )
+{
+   const struct inObjCornerKey_s *k = (const struct inObjCornerKey_s *) user;
+   return( k->jv[l] == k->jv[i] && k->jt[l] == k->jt[i] &&
+           k->jn[l] == k->jn[i] );
+}
+
+int inObj::makeCorners( std::vector< float > & cv,
+                        std::vector< inObjIdx_t > & kc, int nthreads ) const
+{
+   const size_t n = jv.size();
+
+   cv.clear();
+   kc.assign( n, 0 );
+   if( n == 0 ) return 0;
+   if( jt.size() != n || jn.size() != n ) return 1;
+
+   struct inObjCornerKey_s key = { jv.data(), jt.data(), jn.data() };
+   struct inhash_s h;
+   // "kc" holds the leading member of every member for now
+   if( inhash_Build( &h, n, nthreads,
+                     inObj_CornerKey, inObj_CornerSame, &key, kc.data() ) ) {
+      return 2;
+   }
+   inhash_Free( &h );
+
+   // numbering; a leader comes before the members it leads
+   size_t nc=0;
+   for(size_t i=0;i<n;++i) {
+      if( (size_t) kc[i] == i ) {
+         kc[i] = (inObjIdx_t) nc++;
+      } else {
+         kc[i] = kc[ kc[i] ];
+      }
+   }
+
+   cv.assign( nc * INOBJ_CORNER_FLOATS, 0.0f );
+   const long nvert = (long) vertex.size();
+   const long ntex = (long) texel.size();
+   const long nnorm = (long) normal.size();
+   size_t kn=0;
+   for(size_t i=0;i<n && kn<nc;++i) {
+      if( (size_t) kc[i] != kn ) continue;
+      float* c = &( cv[ kn * INOBJ_CORNER_FLOATS ] );
+      if( jv[i] > 0 && (long) jv[i] <= nvert ) {
+         const vec3_s & v = vertex[ jv[i] - 1 ];
+         c[0] = v.x;  c[1] = v.y;  c[2] = v.z;
+      }
+      if( jt[i] > 0 && (long) jt[i] <= ntex ) {
+         const vec2_s & t = texel[ jt[i] - 1 ];
+         c[3] = t.u;  c[4] = t.v;
+      }
+      if( jn[i] > 0 && (long) jn[i] <= nnorm ) {
+         const vec3_s & v = normal[ jn[i] - 1 ];
+         c[5] = v.x;  c[6] = v.y;  c[7] = v.z;
+      }
+      ++kn;
+   }
+#ifdef _DEBUG_
+   fprintf( stdout, " [DEBUG:makeCorners]  Members: %ld  Corners: %ld \n",
+            (long) n, (long) nc );
+#endif
+
+   return 0;
+}
+
 // --------------------- protected/private methods -------------------
 
 int inObj::parse()
@@ -182,6 +439,9 @@ int inObj::parse()
    int ierr=0;
    pstate = OBJ_OPEN;
 
+   // size everything in one go when we can count beforehand
+   if( iprescan && map_base != NULL && stream_fn == NULL ) prescan();
+
    // start the CSR structure for polygons
    icsr.push_back( 0 );
 
@@ -196,21 +456,31 @@ int inObj::parse()
 #endif
 #endif
 
-      int iret = readLine();
+      int iret;
+      if( map_base != NULL ) {
+         iret = readLineMap();
+      } else {
+         iret = readLine();
+      }
 #ifdef _DEBUG2_
       fprintf( stdout, " [DEBUG:parse]  Reading line returned: %d \n", iret );
 #endif
 #ifdef _DEBUG_
-      fprintf( stdout, " [DEBUG:parse]  Line %d ==>%s<==\n", num_lines+1, buf );
+      if( iret == 0 || iret == 1 )
+      fprintf( stdout, " [DEBUG:parse]  Line %d ==>%.*s<==\n", num_lines+1,
+               (int) (line_e - line_s), line_s );
 #endif
-      if( iret == -1 && iret == 999 ) {
+      if( iret == -1 || iret == 999 ) {
          ierr = -1;     // the error is internal
       } else if( iret == 1 ) {
 #ifdef _DEBUG_
          fprintf( stdout, " [DEBUG:parse]  End-of-file mid-line \n" );
 #endif
+         // the last line has no newline, but it is still a valid line
          ++num_lines;
+         ierr = handleLine();
          pstate = OBJ_READY;
+         if( ierr == 0 && stream_fn != NULL ) ierr = flushBatch( 0 );
       } else if( iret == 2 ) {
 #ifdef _DEBUG_
          fprintf( stdout, " [DEBUG:parse]  Inferred end-of-file \n" );
@@ -222,9 +492,13 @@ int inObj::parse()
 #endif
          ++num_lines;
          ierr = handleLine();
+         if( ierr == 0 && stream_fn != NULL ) ierr = flushBatch( 0 );
       }
    }
 
+   // hand over whatever is left in the last (partial) batch
+   if( ierr == 0 && stream_fn != NULL ) ierr = flushBatch( 1 );
+
 #ifdef _DEBUG_
    fprintf( stdout, " [DEBUG:parse]  Read %d lines \n", num_lines );
 #endif
@@ -264,6 +538,444 @@ int inObj::parse()
    return ierr;
 }
 
+//
+// Function to count the records in a range of a file without parsing them.
+// Lines are found with memchr() (vectorized in the C library) and only the
+// keyword is looked at, except for faces, where the members are counted.
+//
+
+static void prescanRange( const char* s, const char* e,
+                          struct inObjCounts_s* c )
+{
+   memset( c, 0, sizeof(struct inObjCounts_s) );
+
+   while( s < e ) {
+      const char* le = (const char*) memchr( s, '\n', e - s );
+      if( le == NULL ) le = e;
+
+      const char* p = s;
+      while( p < le && ( *p == ' ' || *p == '\t' ) ) ++p;
+      if( le - p >= 2 ) {
+         const char c1 = p[1];
+         const int isep = ( c1 == ' ' || c1 == '\t' );
+         if( p[0] == 'v' ) {
+            if( isep ) {
+               ++( c->nvertex );
+            } else if( le - p >= 3 && ( p[2] == ' ' || p[2] == '\t' ) ) {
+               if( c1 == 'n' ) ++( c->nnormal );
+               if( c1 == 't' ) ++( c->ntexel );
+            }
+         } else if( p[0] == 'f' && isep ) {
+            ++( c->nface );
+            int iin=0;
+            for( p+=2; p < le && *p != '#'; ++p ) {
+               const int iws = ( *p == ' ' || *p == '\t' || *p == '\r' );
+               if( !iws && !iin ) ++( c->ncorner );
+               iin = !iws;
+            }
+         } else if( p[0] == 'g' && ( isep || c1 == '\r' ) ) {
+            ++( c->ngroup );
+         }
+      } else if( le - p == 1 && p[0] == 'g' ) {
+         ++( c->ngroup );
+      }
+
+      s = le + 1;
+   }
+}
+
+void inObj::prescan()
+{
+   struct inObjCounts_s c;
+   prescanRange( map_pos, map_end, &c );
+#ifdef _DEBUG_
+   fprintf( stdout, " [DEBUG:prescan]  v %ld vt %ld vn %ld f %ld (%ld) g %ld \n",
+            c.nvertex, c.ntexel, c.nnormal, c.nface, c.ncorner, c.ngroup );
+#endif
+
+   vertex.reserve( vertex.size() + (size_t) c.nvertex );
+   texel.reserve( texel.size() + (size_t) c.ntexel );
+   normal.reserve( normal.size() + (size_t) c.nnormal );
+   icsr.reserve( icsr.size() + (size_t) c.nface + 1 );
+   jv.reserve( jv.size() + (size_t) c.ncorner );
+   jt.reserve( jt.size() + (size_t) c.ncorner );
+   jn.reserve( jn.size() + (size_t) c.ncorner );
+   groups.reserve( groups.size() + (size_t) c.ngroup );
+}
+
+//
+// Function to count the records of a file before reading it, such that a
+// caller can budget memory
+//
+
+int inObj::prescanFile( const char filename_[], struct inObjCounts_s* c )
+{
+   if( filename_ == NULL || c == NULL ) return -1;
+
+   inObj o;
+   if( o.mapFile( filename_ ) ) {
+      fprintf( stdout, " [Error]  Could not map \"%s\" to count records \n",
+               filename_ );
+      return 1;
+   }
+   prescanRange( o.map_base, o.map_end, c );
+   o.unmapFile();
+
+   return 0;
+}
+
+//
+// Parsing of a mapped file by several threads. The map is cut in to pieces
+// at newlines and each piece is parsed by an object of its own in to private
+// arrays. The pieces are then stitched together in order, so that the result
+// is identical to what the serial parser produces.
+//
+
+int inObj::parseParallel()
+{
+   const size_t imin = 1 << 20;    // do not bother with small pieces
+   int nt = num_threads;
+   if( (size_t) nt > map_size / imin ) nt = (int) ( map_size / imin );
+   if( nt < 2 ) return parse();
+
+#ifdef _DEBUG_
+   fprintf( stdout, " [DEBUG:parseParallel]  Parsing with %d threads \n", nt );
+#endif
+   // cut the map at line boundaries
+   std::vector< const char* > cuts( nt+1 );
+   cuts[0] = map_base;
+   cuts[nt] = map_end;
+   for(int n=1;n<nt;++n) {
+      const char* p = map_base + ( map_size / nt ) * n;
+      if( p < cuts[n-1] ) p = cuts[n-1];
+      const char* q = (const char*) memchr( p, '\n', map_end - p );
+      cuts[n] = ( q == NULL ? map_end : q+1 );
+   }
+
+   std::vector< inObj* > parts( nt );
+   std::vector< int > ierrs( nt, 0 );
+   std::vector< std::thread > threads;
+   for(int n=0;n<nt;++n) {
+      parts[n] = new inObj();
+      parts[n]->chunk_mode = 1;
+      parts[n]->iprescan = iprescan;
+      parts[n]->map_base = cuts[n];      // not owned; never unmapped
+      parts[n]->map_pos = cuts[n];
+      parts[n]->map_end = cuts[n+1];
+   }
+   for(int n=0;n<nt;++n) {
+      inObj* o = parts[n];
+      int* ip = &( ierrs[n] );
+      threads.push_back( std::thread( [o,ip]() { *ip = o->parse(); } ) );
+   }
+   int ierr=0;
+   for(int n=0;n<nt;++n) {
+      threads[n].join();
+      if( ierr == 0 ) ierr = ierrs[n];
+   }
+
+   if( ierr == 0 ) ierr = mergeChunks( parts );
+
+   for(int n=0;n<nt;++n) {
+      parts[n]->map_base = NULL;
+      delete parts[n];
+   }
+
+   return ierr;
+}
+
+int inObj::mergeChunks( std::vector< inObj* > & parts )
+{
+   size_t nv=0,nt=0,nn=0,nf=0,nc=0;
+   for(int n=0;n<(int) parts.size();++n) {
+      nv += parts[n]->vertex.size();
+      nt += parts[n]->texel.size();
+      nn += parts[n]->normal.size();
+      nf += parts[n]->icsr.size() - 1;
+      nc += parts[n]->jv.size();
+   }
+   vertex.reserve( nv );
+   texel.reserve( nt );
+   normal.reserve( nn );
+   icsr.reserve( nf+1 );
+   jv.reserve( nc );
+   jt.reserve( nc );
+   jn.reserve( nc );
+   icsr.push_back( 0 );
+
+   for(int n=0;n<(int) parts.size();++n) {
+      inObj* o = parts[n];
+      const long voff = (long) vertex.size();
+      const long toff = (long) texel.size();
+      const long noff = (long) normal.size();
+      const int foff = (int) icsr.size() - 1;
+      const size_t coff = jv.size();
+
+      vertex.insert( vertex.end(), o->vertex.begin(), o->vertex.end() );
+      texel.insert( texel.end(), o->texel.begin(), o->texel.end() );
+      normal.insert( normal.end(), o->normal.begin(), o->normal.end() );
+      if( (unsigned long int) ( coff + (size_t) o->icsr.back() ) >
+          (unsigned long int) ( (inObjIdx_t) -1 ) ) {
+         fprintf( stdout, " [Error]  Face offsets too large for "
+                  "%d-bit storage\n", (int) ( 8*sizeof(inObjIdx_t) ) );
+         return 104;
+      }
+      for(size_t i=1;i<o->icsr.size();++i) {
+         icsr.push_back( o->icsr[i] + (inObjIdx_t) coff );
+      }
+      jv.insert( jv.end(), o->jv.begin(), o->jv.end() );
+      jt.insert( jt.end(), o->jt.begin(), o->jt.end() );
+      jn.insert( jn.end(), o->jn.begin(), o->jn.end() );
+
+      // relative indices are now resolved against the global counts
+      for(size_t i=0;i<o->fixes.size();++i) {
+         const struct inObjFix_s & f = o->fixes[i];
+         const size_t k = coff + f.k;
+         if( ( (f.mask & 1) && voff + f.iv < 1 ) ||
+             ( (f.mask & 2) && toff + f.it < 1 ) ||
+             ( (f.mask & 4) && noff + f.in < 1 ) ) {
+            fprintf( stdout, " [Error]  Relative face index out of range \n" );
+            return 102;
+         }
+         if( f.mask & 1 ) jv[k] = (inObjIdx_t) ( voff + f.iv );
+         if( f.mask & 2 ) jt[k] = (inObjIdx_t) ( toff + f.it );
+         if( f.mask & 4 ) jn[k] = (inObjIdx_t) ( noff + f.in );
+      }
+
+      // faces before the first group statement belong to the current group
+      const int nfo = (int) o->icsr.size() - 1;
+      const int ilead = ( o->num_groups ? o->groups[0].fs : nfo );
+      if( num_groups ) groups[ num_groups-1 ].fe += ilead;
+      for(int i=0;i<(int) o->num_groups;++i) {
+         struct inObjGrp_s g = o->groups[i];
+         g.fs += foff;
+         g.fe += foff;
+         groups.push_back( g );
+         ++num_groups;
+      }
+
+      if( o->mtllib_name.size() > 0 ) mtllib_name = o->mtllib_name;
+      num_lines += o->num_lines;
+   }
+
+   dgroup.fe = (int) icsr.size() - 1;
+   dgroup.fs = ( num_groups ? groups[ num_groups-1 ].fs : 0 );
+#ifdef _DEBUG_
+   fprintf( stdout, " [DEBUG:mergeChunks]  Merged %d pieces: %ld vertices, "
+            "%d faces, %d groups \n", (int) parts.size(), (long) vertex.size(),
+            dgroup.fe, num_groups );
+#endif
+
+   return 0;
+}
+
+//
+// Reading of one of "nslice" pieces of a mapped file, cut at newlines the way
+// parseParallel() cuts it, so that separate processes can each take a piece.
+// Relative indices are kept aside and the faces and groups are numbered from
+// the start of the piece until resolveSlice() is told how many records the
+// preceding pieces hold.
+//
+
+int inObj::readSlice( const char filename_[], int islice, int nslice )
+{
+   if( filename_ == NULL || nslice < 1 || islice < 0 || islice >= nslice ) {
+      fprintf( stdout, " [Error]  Bad slice %d of %d \n", islice, nslice );
+      return -1;
+   }
+   filename = filename_;
+
+   if( mapFile( filename_ ) != 0 ) {
+      fprintf( stdout, " [Error]  Could not map file: \"%s\"\n", filename_ );
+      filename.clear();
+      return -1;
+   }
+   istate = Open;
+
+   auto cut = [&]( int n ) -> const char* {
+      if( n <= 0 ) return map_base;
+      if( n >= nslice ) return map_end;
+      const char* p = map_base + ( map_size / nslice ) * n;
+      const char* q = (const char*) memchr( p, '\n', map_end - p );
+      return( q == NULL ? map_end : q+1 );
+   };
+   const char* pe = cut( islice+1 );
+   map_pos = cut( islice );
+   map_end = pe;
+
+   chunk_mode = 1;
+   int iret = parse();
+   map_end = map_base + map_size;
+   unmapFile();
+
+   if( iret ) {
+      filename.clear();
+      istate = Unknown;
+      return 1;
+   }
+   istate = Ready;
+
+   return 0;
+}
+
+int inObj::resolveSlice( const struct inObjCounts_s* b )
+{
+   if( !chunk_mode ) return 0;
+
+   for(size_t i=0;i<fixes.size();++i) {
+      const struct inObjFix_s & f = fixes[i];
+      if( ( (f.mask & 1) && b->nvertex + f.iv < 1 ) ||
+          ( (f.mask & 2) && b->ntexel + f.it < 1 ) ||
+          ( (f.mask & 4) && b->nnormal + f.in < 1 ) ) {
+         fprintf( stdout, " [Error]  Relative face index out of range \n" );
+         return 102;
+      }
+      if( f.mask & 1 ) jv[f.k] = (inObjIdx_t) ( b->nvertex + f.iv );
+      if( f.mask & 2 ) jt[f.k] = (inObjIdx_t) ( b->ntexel + f.it );
+      if( f.mask & 4 ) jn[f.k] = (inObjIdx_t) ( b->nnormal + f.in );
+   }
+   fixes.clear();
+
+   // offsets point in to the whole file's members, groups to its faces
+   if( (unsigned long int) ( b->ncorner + (long) jv.size() ) >
+       (unsigned long int) ( (inObjIdx_t) -1 ) ) {
+      fprintf( stdout, " [Error]  Face offsets too large for %d-bit storage\n",
+               (int) ( 8*sizeof(inObjIdx_t) ) );
+      return 104;
+   }
+   for(size_t i=0;i<icsr.size();++i) icsr[i] += (inObjIdx_t) b->ncorner;
+   for(int n=0;n<(int) num_groups;++n) {
+      groups[n].fs += (int) b->nface;
+      groups[n].fe += (int) b->nface;
+   }
+   chunk_mode = 0;
+
+   return 0;
+}
+
+int inObj::loadMtllib( const char name[] )
+{
+   if( name == NULL || name[0] == '\0' ) return 0;
+
+   mtllib_name = name;
+   int iret = parseMtllib();
+   if( buf != NULL ) {
+      free( buf );
+      buf = NULL;
+      nbytes=0;
+   }
+
+   return( iret ? 2 : 0 );
+}
+
+const char* inObj::getMtllibName() const
+{
+   return mtllib_name.c_str();
+}
+
+//
+// Streaming: the file is parsed as usual, but whenever a batch fills up it is
+// handed to the caller's function and the arrays are emptied (keeping their
+// capacity for the next batch). Indices in the batches are global, so the
+// caller sees the same numbers as when the whole file is read in one go.
+//
+
+int inObj::readStream( const char filename_[], long nbatch_,
+                       inObjBatchFn fn, void* user )
+{
+   if( fn == NULL || nbatch_ <= 0 ) return -1;
+
+   stream_fn = fn;
+   stream_user = user;
+   nbatch = nbatch_;
+   vertex.reserve( (size_t) nbatch );
+   texel.reserve( (size_t) nbatch );
+   normal.reserve( (size_t) nbatch );
+   icsr.reserve( (size_t) nbatch + 1 );
+   jv.reserve( (size_t) ( 4*nbatch ) );
+   jt.reserve( (size_t) ( 4*nbatch ) );
+   jn.reserve( (size_t) ( 4*nbatch ) );
+
+   int iret = read( filename_ );
+
+   stream_fn = NULL;
+   stream_user = NULL;
+
+   return iret;
+}
+
+int inObj::flushBatch( int ifinal )
+{
+   const size_t nb = (size_t) nbatch;
+   const size_t nf = icsr.size() - 1;
+   if( !ifinal &&
+       vertex.size() < nb && texel.size() < nb && normal.size() < nb &&
+       nf < nb && jv.size() < 4*nb ) return 0;
+   if( ifinal && vertex.size() == 0 && texel.size() == 0 &&
+       normal.size() == 0 && nf == 0 && gsent == groups.size() ) return 0;
+
+   std::vector< struct inObjGroupEvent_s > events;
+   for(size_t i=gsent;i<groups.size();++i) {
+      struct inObjGroupEvent_s g = { groups[i].name.c_str(), groups[i].fs };
+      events.push_back( g );
+   }
+
+   struct inObjBatch_s b;
+   b.vertex_base = vbase;
+   b.nvertex = (long) vertex.size();
+   b.vertex = ( vertex.size() ? &( vertex[0].x ) : NULL );
+   b.texel_base = tbase;
+   b.ntexel = (long) texel.size();
+   b.texel = ( texel.size() ? &( texel[0].u ) : NULL );
+   b.normal_base = nbase;
+   b.nnormal = (long) normal.size();
+   b.normal = ( normal.size() ? &( normal[0].x ) : NULL );
+   b.face_base = (long) ( dgroup.fe - (int) nf );
+   b.nface = (long) nf;
+   b.offsets = icsr.data();
+   b.corner_base = cbase;
+   b.ncorner = (long) jv.size();
+   b.jv = jv.data();
+   b.jt = jt.data();
+   b.jn = jn.data();
+   b.ngroup = (int) events.size();
+   b.groups = ( events.size() ? events.data() : NULL );
+#ifdef _DEBUG_
+   fprintf( stdout, " [DEBUG:flushBatch]  v %ld+%ld  f %ld+%ld  g %d \n",
+            b.vertex_base, b.nvertex, b.face_base, b.nface, b.ngroup );
+#endif
+
+   int iret = stream_fn( &b, stream_user );
+   if( iret ) {
+      fprintf( stdout, " [Error]  Batch consumer returned %d \n", iret );
+      return 105;
+   }
+
+   vbase += (long) vertex.size();
+   tbase += (long) texel.size();
+   nbase += (long) normal.size();
+   cbase += (long) jv.size();
+   gsent = groups.size();
+   vertex.clear();
+   texel.clear();
+   normal.clear();
+   icsr.clear();
+   icsr.push_back( 0 );
+   jv.clear();
+   jt.clear();
+   jn.clear();
+
+   // let go of the part of the map that was consumed, so that the resident
+   // size stays bounded for files larger than memory
+   if( map_base != NULL ) {
+      const size_t ipage = (size_t) sysconf( _SC_PAGESIZE );
+      const size_t ndone = ( (size_t) ( map_pos - map_base ) / ipage ) * ipage;
+      if( ndone > 0 ) (void) madvise( (void*) map_base, ndone, MADV_DONTNEED );
+   }
+
+   return 0;
+}
+
 //
 // function to robustly read a line from the file descriptor
 // Returns: 999 when something escapes my logic!
@@ -295,7 +1007,7 @@ int inObj::readLine()
          usleep( 100000 );
 #endif
 #endif
-         char* p = (char*) realloc( buf, 2*(nbytes + isize+1) );
+         char* p = (char*) realloc( buf, nbytes + isize+1 );
          if( p == NULL ) {
             fprintf( stdout, " [Error]  Could not re-alloc. %ld byte buffer \n",
                      nbytes + isize+1 );
@@ -304,7 +1016,6 @@ int inObj::readLine()
          }
          buf = p;
          nbytes += isize;
-         buf2 = &( buf[ nbytes+1 ] );
 #ifdef _DEBUG_
          fprintf( stdout, " [DEBUG:readLine]  New buffer %ld bytes \n", nbytes );
 #endif
@@ -328,6 +1039,8 @@ int inObj::readLine()
             fprintf( stdout, " [DEBUG:readLine]  Line has newline \n" );
 #endif
             bp[j] = '\0';    // remove newline
+            line_s = buf;
+            line_e = &( buf[im] );
             return 0;
          } else
          if( bp[j] == '\0' ) {
@@ -340,6 +1053,8 @@ int inObj::readLine()
 #endif
                return 2;
             }
+            line_s = buf;
+            line_e = &( buf[im] );
             return 1;
          } else
          if( bp[j] == '\t' ) {
@@ -356,92 +1071,187 @@ int inObj::readLine()
    return 999;
 }
 
+//
+// functions to map a (regular) file to memory and to walk it line by line
+// without copying anything; "line_s" and "line_e" delimit the current line
+// (the newline is excluded) and point straight into the mapped region.
+// Returns the same codes as readLine().
+//
 
-int inObj::handleLine()
+int inObj::mapFile( const char filename_[] )
 {
-   int ierr=0, k=0;
-   memcpy( buf2, buf, nbytes+1 );
-   // clean-up what ChatGPT thought was cool to comment (how nice of her!)
-   while( buf2[k] != '\0' ) {
-      if( buf2[k] == '#' ) buf2[k] = '\0';
-      ++k;
-   }
+   int fd = open( filename_, O_RDONLY );
+   if( fd == -1 ) return 1;
 
-   if( buf[0] == '#' ) {
-#ifdef _DEBUG2_
-      fprintf( stdout, " [DEBUG:handleLine]  Line is a comment \n" );
+   struct stat sb;
+   if( fstat( fd, &sb ) == -1 || !S_ISREG( sb.st_mode ) || sb.st_size == 0 ) {
+#ifdef _DEBUG_
+      fprintf( stdout, " [DEBUG:mapFile]  Not mapping \"%s\" \n", filename_ );
 #endif
-   } else if( buf[0] == '\0' ) {
-#ifdef _DEBUG2_
-      fprintf( stdout, " [DEBUG:handleLine]  Line is blank; doing nothing \n" );
+      close( fd );
+      return 2;
+   }
+
+   void* p = mmap( NULL, (size_t) sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+   close( fd );
+   if( p == MAP_FAILED ) {
+      fprintf( stdout, " [Error]  Could not map file \"%s\" \n", filename_ );
+      return 3;
+   }
+   (void) madvise( p, (size_t) sb.st_size, MADV_SEQUENTIAL );
+
+   map_base = (const char*) p;
+   map_size = (size_t) sb.st_size;
+   map_end = map_base + map_size;
+   map_pos = map_base;
+#ifdef _DEBUG_
+   fprintf( stdout, " [DEBUG:mapFile]  Mapped %ld bytes \n", (long) map_size );
 #endif
-   } else {
 
-      std::vector< std::string > strings;
-      char *s, *saveptr=NULL;
-      int i;
-      for( i=0, s=buf2; ; ++i, s=NULL ) {
-         char *token = strtok_r( s, " ", &saveptr );
-         if( token == NULL ) break;
+   return 0;
+}
+
+void inObj::unmapFile()
+{
+   if( map_base != NULL ) {
+      munmap( (void*) map_base, map_size );
+   }
+   map_base = NULL;
+   map_end = NULL;
+   map_pos = NULL;
+   map_size = 0;
+   line_s = NULL;
+   line_e = NULL;
+}
+
+int inObj::readLineMap()
+{
+   if( map_pos >= map_end ) return 2;
+
+   const char* p = (const char*) memchr( map_pos, '\n', map_end - map_pos );
+   line_s = map_pos;
+   if( p == NULL ) {
+      line_e = map_end;
+      map_pos = map_end;
+      return 1;
+   }
+   line_e = p;
+   map_pos = p + 1;
+
+   return 0;
+}
+
+//
+// function to split a line in to whitespace-separated tokens; a "#" ends the
+// line and everything after it is a comment. The tokens are views in to the
+// line and the array is re-used from line to line, so nothing is allocated
+// once it has grown to the longest line's number of tokens.
+//
+
+static void tokenizeLine( const char* s, const char* e,
+                          std::vector< inObj::inObjTok_s > & toks )
+{
+   toks.clear();
+   while( s < e ) {
+      while( s < e && ( *s == ' ' || *s == '\t' || *s == '\r' ) ) ++s;
+      if( s == e || *s == '#' ) break;
+      const char* t = s;
+      while( t < e && *t != ' ' && *t != '\t' && *t != '\r' && *t != '#' ) ++t;
 #ifdef _DEBUG3_
-         fprintf( stdout, " [DEBUG:handleLine]  Token: \"%s\"\n", token );
-#endif
-         strings.push_back( token );
-         if( i == 0 ) {
-            if( strcmp( token, "v" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleLine]  Detected \"vertex\"\n" );
+      fprintf( stdout, " [DEBUG:tokenizeLine]  Token: \"%.*s\"\n",
+               (int) (t - s), s );
 #endif
-               pstate = OBJ_VERTEX;
-            } else if( strcmp( token, "vn" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleLine]  Detected \"normal\"\n" );
-#endif
-               pstate = OBJ_NORMAL;
-            } else if( strcmp( token, "vt" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleLine]  Detected \"texel\"\n" );
-#endif
-               pstate = OBJ_TEXEL;
-            } else if( strcmp( token, "f" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleLine]  Detected \"face\"\n" );
-#endif
-               pstate = OBJ_FACE;
-            } else if( strcmp( token, "g" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleLine]  Detected \"group\"\n" );
-#endif
-               pstate = OBJ_GROUP;
-            } else if( strcmp( token, "s" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleLine]  Detected \"smooth\"\n" );
-#endif
-               pstate = OBJ_SMOOTH;
-            } else if( strcmp( token, "o" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleLine]  Detected \"object\"\n" );
-#endif
-               pstate = OBJ_OBJECT;
-            } else if( strcmp( token, "mtllib" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleLine]  Detected \"mtllib\"\n" );
-#endif
-               pstate = OBJ_MTLLIB;
-            } else if( strcmp( token, "usemtl" ) == 0 ) {
+      inObj::inObjTok_s tok = { s, t };
+      toks.push_back( tok );
+      s = t;
+   }
+}
+
+static inline bool tokenIs( const inObj::inObjTok_s & t, const char* key,
+                            size_t n )
+{
+   return( (size_t) ( t.e - t.s ) == n && memcmp( t.s, key, n ) == 0 );
+}
+
+//
+// functions to map a line's keyword to a parsing state; dispatch is by length
+// and first character, and only then is the keyword compared
+//
+
+int inObj::keywordObj( const inObjTok_s & t )
+{
+   switch( t.e - t.s ) {
+    case 1:
+      switch( t.s[0] ) {
+       case 'v': return OBJ_VERTEX;
+       case 'f': return OBJ_FACE;
+       case 'g': return OBJ_GROUP;
+       case 's': return OBJ_SMOOTH;
+       case 'o': return OBJ_OBJECT;
+      }
+    break;
+    case 2:
+      if( t.s[0] == 'v' ) {
+         if( t.s[1] == 'n' ) return OBJ_NORMAL;
+         if( t.s[1] == 't' ) return OBJ_TEXEL;
+      }
+    break;
+    case 6:
+      if( tokenIs( t, "mtllib", 6 ) ) return OBJ_MTLLIB;
+      if( tokenIs( t, "usemtl", 6 ) ) return OBJ_USEMTL;
+    break;
+   }
+
+   return OBJ_ERROR;
+}
+
+int inObj::keywordMtl( const inObjTok_s & t )
+{
+   switch( t.e - t.s ) {
+    case 1:
+      if( t.s[0] == 'd' ) return MTLLIB_D;
+    break;
+    case 2:
+      if( t.s[0] == 'K' ) {
+         if( t.s[1] == 'a' ) return MTLLIB_KA;
+         if( t.s[1] == 'd' ) return MTLLIB_KD;
+         if( t.s[1] == 's' ) return MTLLIB_KS;
+      } else if( t.s[0] == 'N' ) {
+         if( t.s[1] == 's' ) return MTLLIB_NS;
+         if( t.s[1] == 'i' ) return MTLLIB_NI;
+      }
+    break;
+    case 5:
+      if( tokenIs( t, "illum", 5 ) ) return MTLLIB_ILLUM;
+    break;
+    case 6:
+      if( tokenIs( t, "newmtl", 6 ) ) return MTLLIB_NEWMTL;
+      if( tokenIs( t, "map_Kd", 6 ) ) return MTLLIB_MAPKD;
+    break;
+   }
+
+   return MTLLIB_ERROR;
+}
+
+int inObj::handleLine()
+{
+   int ierr=0;
+   tokenizeLine( line_s, line_e, toks );
+
+   if( toks.size() == 0 ) {
 #ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleLine]  Detected \"usemtl\"\n" );
+      fprintf( stdout, " [DEBUG:handleLine]  Line is blank or a comment \n" );
 #endif
-               pstate = OBJ_USEMTL;
-            } else {
-               pstate = OBJ_ERROR;
-            }
-         }
-      }
+   } else {
+
+      pstate = (inObjParseState) keywordObj( toks[0] );
 #ifdef _DEBUG2_
+      fprintf( stdout, " [DEBUG:handleLine]  Detected \"%.*s\" (%d) \n",
+               (int) ( toks[0].e - toks[0].s ), toks[0].s, (int) pstate );
       fprintf( stdout, " [DEBUG:handleLine]  " );
-      for(i=0;i<(int) strings.size();++i) {
-         fprintf( stdout, " [%d] \"%s\"", i, strings[i].c_str() );
+      for(int i=0;i<(int) toks.size();++i) {
+         fprintf( stdout, " [%d] \"%.*s\"", i,
+                  (int) ( toks[i].e - toks[i].s ), toks[i].s );
       }
       fprintf( stdout, "\n" );
 #endif
@@ -455,28 +1265,28 @@ int inObj::handleLine()
       // processing
       switch( pstate ) {
        case OBJ_VERTEX:
-         ierr = handleVertex( strings );
+         ierr = handleVertex( toks );
        break;
        case OBJ_NORMAL:
-         ierr = handleNormal( strings );
+         ierr = handleNormal( toks );
        break;
        case OBJ_TEXEL:
-         ierr = handleTexel( strings );
+         ierr = handleTexel( toks );
        break;
        case OBJ_FACE:
-         ierr = handleFace( strings );
+         ierr = handleFace( toks );
        break;
        case OBJ_GROUP:
-         ierr = handleGroup( strings );
+         ierr = handleGroup( toks );
        break;
        case OBJ_SMOOTH:
-         ierr = handleSmooth( strings );
+         ierr = handleSmooth( toks );
        break;
        case OBJ_OBJECT:
-         ierr = handleObject( strings );
+         ierr = handleObject( toks );
        break;
        case OBJ_MTLLIB:
-         ierr = handleMtllib( strings );
+         ierr = handleMtllib( toks );
        break;
        case OBJ_USEMTL:
          // ...
@@ -490,122 +1300,195 @@ int inObj::handleLine()
    return ierr;
 }
 
+//
+// function to parse "n" numbers from the tokens following the keyword
+//
 
-int inObj::handleVertex( std::vector< std::string > & strings )
+static int parseFloats( const std::vector< inObj::inObjTok_s > & toks,
+                        int n, float* v )
 {
-   vec3_s v;
-   float r;
-   sscanf( strings[1].c_str(), "%f", &r );
-   v.x = r;
-   sscanf( strings[2].c_str(), "%f", &r );
-   v.y = r;
-   sscanf( strings[3].c_str(), "%f", &r );
-   v.z = r;
-   vertex.push_back( v );
+   if( (int) toks.size() < n+1 ) {
+      fprintf( stdout, " [Error]  Expected %d numbers after \"%.*s\" \n",
+               n, (int) ( toks[0].e - toks[0].s ), toks[0].s );
+      return 103;
+   }
+   for(int i=0;i<n;++i) {
+      const inObj::inObjTok_s & t = toks[i+1];
+      if( inflt_ParseFloat( t.s, t.e, &( v[i] ) ) != t.e ) {
+         fprintf( stdout, " [Error]  Bad number \"%.*s\" \n",
+                  (int) ( t.e - t.s ), t.s );
+         return 103;
+      }
+   }
 
    return 0;
 }
 
-int inObj::handleNormal( std::vector< std::string > & strings )
+//
+// function to parse a signed integer; returns the end of what was parsed
+//
+
+static const char* parseLong( const char* s, const char* e, long* l )
+{
+   int ineg=0;
+   if( s < e && ( *s == '-' || *s == '+' ) ) {
+      ineg = ( *s == '-' );
+      ++s;
+   }
+   if( s == e || (unsigned int) ( *s - '0' ) > 9 ) return NULL;
+
+   long r=0;
+   while( s < e && (unsigned int) ( *s - '0' ) <= 9 ) {
+      r = r*10 + (long) ( *s - '0' );
+      ++s;
+   }
+   *l = ( ineg ? -r : r );
+
+   return s;
+}
+
+int inObj::handleVertex( const std::vector< inObjTok_s > & toks )
 {
    vec3_s v;
-   float r;
-   sscanf( strings[1].c_str(), "%f", &r );
-   v.x = r;
-   sscanf( strings[2].c_str(), "%f", &r );
-   v.y = r;
-   sscanf( strings[3].c_str(), "%f", &r );
-   v.z = r;
-   normal.push_back( v );
+   int ierr = parseFloats( toks, 3, &( v.x ) );
+   if( ierr == 0 ) vertex.push_back( v );
 
-   return 0;
+   return ierr;
 }
 
-int inObj::handleTexel( std::vector< std::string > & strings )
+int inObj::handleNormal( const std::vector< inObjTok_s > & toks )
 {
-   vec2_s v;
-   float r;
-   sscanf( strings[1].c_str(), "%f", &r );
-   v.u = r;
-   sscanf( strings[2].c_str(), "%f", &r );
-   v.v = r;
-   texel.push_back( v );
+   vec3_s v;
+   int ierr = parseFloats( toks, 3, &( v.x ) );
+   if( ierr == 0 ) normal.push_back( v );
 
-   return 0;
+   return ierr;
 }
 
-int inObj::handleFace( std::vector< std::string > & strings )
+int inObj::handleTexel( const std::vector< inObjTok_s > & toks )
 {
-   int ierr=0,i,itype=0;
+   vec2_s v = { 0.0, 0.0 };
+   int ierr = parseFloats( toks, ( toks.size() > 2 ? 2 : 1 ), &( v.u ) );
+   if( ierr == 0 ) texel.push_back( v );
 
-   // determine format of polygon's members
-   const char* p = strings[1].c_str();
-   for( i=1; p[i] != '\0'; ++i ) {
-      if( p[i] == '/' ) {
-         if( p[i-1] == '/' ) itype += 1;
-         ++itype;
-      }
+   return ierr;
+}
+
+int inObj::handleFace( const std::vector< inObjTok_s > & toks )
+{
+   int ierr=0,i;
+
+   if( toks.size() < 2 ) {
+      fprintf( stdout, " [Error]  Face without vertices \n" );
+      return 101;
    }
 
    // intelligently increase icsr
-   icsr.push_back( icsr[ dgroup.fe ] );
+   icsr.push_back( icsr.back() );
 
    ( dgroup.fe )++;
    if( num_groups ) {
       ( groups[ num_groups-1 ].fe )++;
    }
 
-   for(i=1;i<(int) strings.size() && ierr==0;++i) {
-      unsigned long int ul=0,ul1=0,ul2=0,ul3=0;
-      p = strings[i].c_str();
-      switch( itype ) {
-       case 0:
-         ierr = sscanf( p, "%ld", &ul1 );
-         if( ierr == 1 ) ierr=0;
-       break;
-       case 1:
-         // this IS a valid format, but we will return an error
-         ierr=101;
-       break;
-       case 2:
-         ierr = sscanf( p, "%ld/%ld/%ld", &ul1, &ul2, &ul3 );
-         if( ierr == 3 ) ierr=0;
-       break;
-       case 3:
-         ierr = sscanf( p, "%ld//%ld", &ul1, &ul3 );
-         if( ierr == 2 ) ierr=0;
-       break;
+   // each member is one of "v", "v/vt", "v/vt/vn" or "v//vn"
+   for(i=1;i<(int) toks.size() && ierr==0;++i) {
+      long l1=0,l2=0,l3=0;
+      const char* p = parseLong( toks[i].s, toks[i].e, &l1 );
+      if( p != NULL && p < toks[i].e && *p == '/' ) {
+         ++p;
+         if( p < toks[i].e && *p != '/' ) p = parseLong( p, toks[i].e, &l2 );
+         if( p != NULL && p < toks[i].e && *p == '/' ) {
+            p = parseLong( p+1, toks[i].e, &l3 );
+         }
+      }
+      if( p != toks[i].e ) {
+         fprintf( stdout, " [Error]  Bad face member \"%.*s\" \n",
+                  (int) ( toks[i].e - toks[i].s ), toks[i].s );
+         ierr = 101;
+      }
+
+      // negative indices count backwards from the most recent element
+      int mask=0;
+      if( ierr == 0 ) ierr = resolveIndex( l1, vbase + (long) vertex.size(),
+                                           1, mask );
+      if( ierr == 0 ) ierr = resolveIndex( l2, tbase + (long) texel.size(),
+                                           2, mask );
+      if( ierr == 0 ) ierr = resolveIndex( l3, nbase + (long) normal.size(),
+                                           4, mask );
+
+      // indices flagged for fixing are kept aside until the merge
+      if( ierr == 0 && mask ) {
+         struct inObjFix_s f = { jv.size(), mask, l1, l2, l3 };
+         fixes.push_back( f );
+         if( mask & 1 ) l1 = 0;
+         if( mask & 2 ) l2 = 0;
+         if( mask & 4 ) l3 = 0;
+      }
+
+      // the indices must fit the index type (see _INOBJ_INDEX64_)
+      if( ierr == 0 && (unsigned long int) ( l1 | l2 | l3 ) >
+                       (unsigned long int) ( (inObjIdx_t) -1 ) ) {
+         fprintf( stdout, " [Error]  Face index too large for %d-bit storage\n",
+                  (int) ( 8*sizeof(inObjIdx_t) ) );
+         ierr = 104;
+      }
+
+      // so must the offset of the face's end in the file's members
+      if( ierr == 0 && (unsigned long int) ( cbase + (long) icsr.back() ) >=
+                       (unsigned long int) ( (inObjIdx_t) -1 ) ) {
+         fprintf( stdout, " [Error]  Face offsets too large for "
+                  "%d-bit storage\n", (int) ( 8*sizeof(inObjIdx_t) ) );
+         ierr = 104;
       }
 
       if( ierr == 0 ) {
-         ul = (ul1 << 40) | (ul2 << 20) | ul3;
-         // add to jcsr of CSR
-         ++( icsr[ dgroup.fe ] );
-         jcsr.push_back( ul );
+         // add to the CSR
+         ++( icsr.back() );
+         jv.push_back( (inObjIdx_t) l1 );
+         jt.push_back( (inObjIdx_t) l2 );
+         jn.push_back( (inObjIdx_t) l3 );
       }
    }
 #ifdef _DEBUG2_
-   const unsigned long int m3 = 0x0FFFFF;
-   const unsigned long int m2 = m3 << 20;
-   const unsigned long int m1 = m2 << 20;
-// fprintf( stdout, " [DEBUG:handleFace]  Masks: %.16lx %.16lx %.16lx \n",
-//          m1,m2,m3);
-   fprintf( stdout, " [DEBUG:handleFace]  Polygon %d (%d:%d) \n",
-            dgroup.fe-1, icsr[ dgroup.fe-1 ], icsr[ dgroup.fe ] );
-   for( i=icsr[ dgroup.fe-1 ]; i<icsr[ dgroup.fe ]; ++i ) {
-      const unsigned long int ul = jcsr[i];
-      fprintf( stdout, "  [%d]  %ld %ld %ld \n",
-               i, (ul & m1) >> 40, (ul & m2) >> 20, (ul & m3) );
+   fprintf( stdout, " [DEBUG:handleFace]  Polygon %d (%ld:%ld) \n",
+            dgroup.fe-1, (long) icsr[ icsr.size()-2 ], (long) icsr.back() );
+   for(size_t k=icsr[ icsr.size()-2 ]; k<icsr.back(); ++k ) {
+      fprintf( stdout, "  [%ld]  %ld %ld %ld \n",
+               (long) k, (long) jv[k], (long) jt[k], (long) jn[k] );
    }
 #endif
 
    return ierr;
 }
 
-int inObj::handleGroup( std::vector< std::string > & strings )
+//
+// function to turn a relative (negative) index in to an absolute one given the
+// number of elements read so far; in a chunk that number is only local, and
+// the index is flagged to be fixed when the chunks are merged
+//
+
+int inObj::resolveIndex( long & l, long n, int ibit, int & mask ) const
+{
+   if( l >= 0 ) return 0;
+
+   l = n + 1 + l;
+   if( chunk_mode ) {
+      mask |= ibit;
+   } else if( l < 1 ) {
+      fprintf( stdout, " [Error]  Relative face index out of range \n" );
+      return 102;
+   }
+
+   return 0;
+}
+
+int inObj::handleGroup( const std::vector< inObjTok_s > & toks )
 {
    struct inObjGrp_s ngroup = { .fs = dgroup.fe, .fe = dgroup.fe };
-   if( strings.size() > 1 ) { ngroup.name = strings[1].c_str(); }
+   if( toks.size() > 1 ) {
+      ngroup.name.assign( toks[1].s, (size_t) ( toks[1].e - toks[1].s ) );
+   }
    dgroup.fs = dgroup.fe;
    groups.push_back( ngroup );
    ++num_groups;
@@ -618,7 +1501,7 @@ int inObj::handleGroup( std::vector< std::string > & strings )
    return 0;
 }
 
-int inObj::handleSmooth( std::vector< std::string > & strings )
+int inObj::handleSmooth( const std::vector< inObjTok_s > & toks )
 {
    fprintf( stdout, " [Info]  Issues with \"s\" (\"smooth\") directives.\n" );
    fprintf( stdout, "%s\n%s\n%s\n%s\n",
@@ -629,7 +1512,7 @@ int inObj::handleSmooth( std::vector< std::string > & strings )
    return 0;
 }
 
-int inObj::handleObject( std::vector< std::string > & strings )
+int inObj::handleObject( const std::vector< inObjTok_s > & toks )
 {
    fprintf( stdout, " [Info]  Issues with \"o\" (\"object\") directives.\n" );
    fprintf( stdout, "%s\n%s\n%s\n",
@@ -639,10 +1522,28 @@ int inObj::handleObject( std::vector< std::string > & strings )
    return 0;
 }
 
-int inObj::handleMtllib( std::vector< std::string > & strings )
+//
+// Function to make a path named in a file relative to the directory of that
+// file, as files are opened relative to the working directory; absolute
+// paths and files in the working directory are left alone
+//
+
+static std::string resolvePath( const std::string & from,
+                                const std::string & name )
+{
+   const size_t k = from.rfind( '/' );
+
+   if( name.size() == 0 || name[0] == '/' || k == std::string::npos ) {
+      return name;
+   }
+   return from.substr( 0, k+1 ) + name;
+}
+
+int inObj::handleMtllib( const std::vector< inObjTok_s > & toks )
 {
-   if( strings.size() > 1 ) {
-      mtllib_name = strings[1].c_str();
+   if( toks.size() > 1 ) {
+      mtllib_name.assign( toks[1].s, (size_t) ( toks[1].e - toks[1].s ) );
+      mtllib_name = resolvePath( filename, mtllib_name );
 #ifdef _DEBUG_
       fprintf( stdout, " [DEBUG:handleMtllib]  Mtllib: \"%s\" \n",
                mtllib_name.c_str() );
@@ -705,13 +1606,24 @@ int inObj::parseMtllib()
 #ifdef _DEBUG_
       fprintf( stdout, " [DEBUG:parseMtllib]  Line %d ==>%s<==\n", nline+1, buf );
 #endif
-      if( iret == -1 && iret == 999 ) {
+      if( iret == -1 || iret == 999 ) {
          ierr = -1;     // the error is internal
       } else if( iret == 1 ) {
 #ifdef _DEBUG2_
          fprintf( stdout, " [DEBUG:parseMtllib]  End-of-file mid-line \n" );
 #endif
-         mstate = MTLLIB_ERROR;
+         // the last line has no newline, but it is still a valid line
+         ++nline;
+         ierr = handleMtlLine( mtl, have_one );
+         if( ierr == 0 && mstate != MTLLIB_ERROR ) {
+            if( have_one ) {
+#ifdef _DEBUG_
+               MTLLIB_VIEW( mtl )
+#endif
+               mtls.push_back( mtl );
+            }
+            mstate = MTLLIB_READY;
+         }
       } else if( iret == 2 ) {
 #ifdef _DEBUG2_
          fprintf( stdout, " [DEBUG:parseMtllib]  Inferred end-of-file \n" );
@@ -725,6 +1637,7 @@ int inObj::parseMtllib()
          }
          mstate = MTLLIB_READY;
       } else {
+         ++nline;
          ierr = handleMtlLine( mtl, have_one );
       }
 
@@ -740,97 +1653,24 @@ int inObj::parseMtllib()
 
 int inObj:: handleMtlLine( struct inObjMtl_s & mtl, int & have_one )
 {
-   int ierr=0, k=0;
-   memcpy( buf2, buf, nbytes+1 );
-   // clean-up what ChatGPT thought was cool to comment (how nice of her!)
-   while( buf2[k] != '\0' ) {
-      if( buf2[k] == '#' ) buf2[k] = '\0';
-      ++k;
-   }
+   int ierr=0;
+   tokenizeLine( line_s, line_e, toks );
 
-   if( buf[0] == '#' ) {
-#ifdef _DEBUG2_
-      fprintf( stdout, " [DEBUG:handleMtlLine]  Line is a comment \n" );
-#endif
-   } else if( buf[0] == '\0' ) {
+   if( toks.size() == 0 ) {
 #ifdef _DEBUG2_
-      fprintf( stdout, " [DEBUG:handleMtlLine]  Line is blank; doing nothing \n" );
+      fprintf( stdout, " [DEBUG:handleMtlLine]  Line is blank or a comment \n" );
 #endif
    } else {
 
-      std::vector< std::string > strings;
-      char *s, *saveptr=NULL;
       int i;
-      for( i=0, s=buf2; ; ++i, s=NULL ) {
-         char *token = strtok_r( s, " ", &saveptr );
-         if( token == NULL ) break;
-#ifdef _DEBUG3_
-         fprintf( stdout, " [DEBUG:handleMtlLine]  Token: \"%s\"\n", token );
-#endif
-         strings.push_back( token );
-         if( i == 0 ) {
-            if( strcmp( token, "newmtl" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleMtlLine]  Detected \"newmtl\"\n" );
-#endif
-               mstate = MTLLIB_NEWMTL;
-            } else
-            if( strcmp( token, "Ka" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleMtlLine]  Detected \"Ka\"\n" );
-#endif
-               mstate = MTLLIB_KA;
-            } else
-            if( strcmp( token, "Kd" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleMtlLine]  Detected \"\Kd\"\n" );
-#endif
-               mstate = MTLLIB_KD;
-            } else
-            if( strcmp( token, "Ks" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleMtlLine]  Detected \"Ks\"\n" );
-#endif
-               mstate = MTLLIB_KS;
-            } else
-            if( strcmp( token, "Ns" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleMtlLine]  Detected \"Ns\"\n" );
-#endif
-               mstate = MTLLIB_NS;
-            } else
-            if( strcmp( token, "Ni" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleMtlLine]  Detected \"Ni\"\n" );
-#endif
-               mstate = MTLLIB_NI;
-            } else
-            if( strcmp( token, "d" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleMtlLine]  Detected \"d\"\n" );
-#endif
-               mstate = MTLLIB_D;
-            } else
-            if( strcmp( token, "illum" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleMtlLine]  Detected \"illum\"\n" );
-#endif
-               mstate = MTLLIB_ILLUM;
-            } else
-            if( strcmp( token, "map_Kd" ) == 0 ) {
-#ifdef _DEBUG2_
-               fprintf( stdout, " [DEBUG:handleMtlLine]  Detected \"map_Kd\"\n" );
-#endif
-               mstate = MTLLIB_MAPKD;
-            } else {
-               mstate = MTLLIB_ERROR;
-            }
-         }
-      }
+      mstate = (inMtlParseState) keywordMtl( toks[0] );
 #ifdef _DEBUG2_
+      fprintf( stdout, " [DEBUG:handleMtlLine]  Detected \"%.*s\" (%d) \n",
+               (int) ( toks[0].e - toks[0].s ), toks[0].s, (int) mstate );
       fprintf( stdout, " [DEBUG:handleMtlLine]  " );
-      for(i=0;i<(int) strings.size();++i) {
-         fprintf( stdout, " [%d] \"%s\"", i, strings[i].c_str() );
+      for(i=0;i<(int) toks.size();++i) {
+         fprintf( stdout, " [%d] \"%.*s\"", i,
+                  (int) ( toks[i].e - toks[i].s ), toks[i].s );
       }
       fprintf( stdout, "\n" );
 #endif
@@ -842,7 +1682,6 @@ int inObj:: handleMtlLine( struct inObjMtl_s & mtl, int & have_one )
       }
 
       // processing
-      float r;
       struct inImage_s img = { .type = FILEMAGIC_UNKNOWN };
       switch( mstate ) {
        case MTLLIB_NEWMTL:
@@ -858,55 +1697,47 @@ int inObj:: handleMtlLine( struct inObjMtl_s & mtl, int & have_one )
          }
          // now we re-initialize the one we were using as storage
          MTLLIB_INIT( mtl );
-         mtl.name = strings[1].c_str();
+         if( toks.size() > 1 ) {
+            mtl.name.assign( toks[1].s, (size_t) ( toks[1].e - toks[1].s ) );
+         }
        break;
        case MTLLIB_KA:
-         sscanf( strings[1].c_str(), "%f", &r );
-         mtl.Ka[0] = r;
-         sscanf( strings[2].c_str(), "%f", &r );
-         mtl.Ka[1] = r;
-         sscanf( strings[3].c_str(), "%f", &r );
-         mtl.Ka[2] = r;
+         ierr = parseFloats( toks, 3, mtl.Ka );
        break;
        case MTLLIB_KD:
-         sscanf( strings[1].c_str(), "%f", &r );
-         mtl.Kd[0] = r;
-         sscanf( strings[2].c_str(), "%f", &r );
-         mtl.Kd[1] = r;
-         sscanf( strings[3].c_str(), "%f", &r );
-         mtl.Kd[2] = r;
+         ierr = parseFloats( toks, 3, mtl.Kd );
        break;
        case MTLLIB_KS:
-         sscanf( strings[1].c_str(), "%f", &r );
-         mtl.Ks[0] = r;
-         sscanf( strings[2].c_str(), "%f", &r );
-         mtl.Ks[1] = r;
-         sscanf( strings[3].c_str(), "%f", &r );
-         mtl.Ks[2] = r;
+         ierr = parseFloats( toks, 3, mtl.Ks );
        break;
        case MTLLIB_NS:
-         sscanf( strings[1].c_str(), "%f", &r );
-         mtl.Ns = r;
+         ierr = parseFloats( toks, 1, &( mtl.Ns ) );
        break;
        case MTLLIB_NI:
-         sscanf( strings[1].c_str(), "%f", &r );
-         mtl.Ni = r;
+         ierr = parseFloats( toks, 1, &( mtl.Ni ) );
        break;
        case MTLLIB_D:
-         sscanf( strings[1].c_str(), "%f", &r );
-         mtl.d = r;
+         ierr = parseFloats( toks, 1, &( mtl.d ) );
        break;
        case MTLLIB_ILLUM:
-         sscanf( strings[1].c_str(), "%d", &i );
-         mtl.illum = i;
+         {
+            long l=0;
+            if( toks.size() < 2 ||
+                parseLong( toks[1].s, toks[1].e, &l ) == NULL ) {
+               fprintf( stdout, " [Error]  Bad \"illum\" statement \n" );
+               ierr = 103;
+            }
+            mtl.illum = (unsigned short) l;
+         }
        break;
        case MTLLIB_MAPKD:
-         if( strings.size() > 1 ) {
-            mtl.map_Kd = strings[1];
-            for(i=2;i<(int) strings.size();++i) {
+         if( toks.size() > 1 ) {
+            mtl.map_Kd.assign( toks[1].s, (size_t) ( toks[1].e - toks[1].s ) );
+            for(i=2;i<(int) toks.size();++i) {
                mtl.map_Kd += " ";
-               mtl.map_Kd += strings[i];
+               mtl.map_Kd.append( toks[i].s, (size_t) ( toks[i].e - toks[i].s ) );
             }
+            mtl.map_Kd = resolvePath( mtllib_name, mtl.map_Kd );
             // handle texture reading
             ierr = determineFileType( mtl.map_Kd.c_str() );
 #ifdef _DEBUG_
@@ -1000,34 +1831,60 @@ int inObj::unifyTexture( struct inImage_s* s )
 {
    if( s == NULL ) return 1;
 
+   const size_t npix = (size_t) s->width * (size_t) s->height;
+
    if( s->type == FILEMAGIC_JPEG ) {
       if( s->irgb == 4 ) {
          return 0;
-      } else if( s->irgb == 3 ) {
+      } else if( s->irgb == 3 || s->irgb == 1 ) {
 #ifdef _DEBUG_
          fprintf( stdout, " [DEBUG]  Re-allocating raster \n" );
 #endif
-         size_t isize = (size_t) (s->width * s->height * 4);
-         unsigned char *tmp = (unsigned char*) malloc( isize );
+         unsigned char *tmp = (unsigned char*) malloc( npix * 4 );
          if( tmp == NULL ) {
             fprintf( stdout, " [Error]  Texture allocation failed \n" );
             return -1;
          }
          unsigned char *tmp0 = (unsigned char*) s->img_data;
-         for(size_t i=0;i<isize;++i) {
-            tmp[i*4  ] = tmp0[i*3  ];
-            tmp[i*4+1] = tmp0[i*3+1];
-            tmp[i*4+2] = tmp0[i*3+2];
-            tmp[i*4+2] = 0xFF;
+         for(size_t i=0;i<npix;++i) {
+            if( s->irgb == 3 ) {
+               tmp[i*4  ] = tmp0[i*3  ];
+               tmp[i*4+1] = tmp0[i*3+1];
+               tmp[i*4+2] = tmp0[i*3+2];
+            } else {
+               tmp[i*4  ] = tmp[i*4+1] = tmp[i*4+2] = tmp0[i];
+            }
+            tmp[i*4+3] = 0xFF;
          }
          free( tmp0 );
          s->img_data = (void*) tmp;
+         s->irgb = 4;
       } else {
          fprintf( stdout, " [Error]  JPEG file has %d components \n", s->irgb );
          return 101;
       }
 
    } else if( s->type == FILEMAGIC_TIFF ) {
+      // the raster is packed ABGR words from the bottom row up; make it RGBA
+      // bytes from the top row down, like the JPEG ones (in place)
+      uint32_t *r = (uint32_t*) s->img_data;
+      for(unsigned int j=0;j<s->height/2;++j) {
+         uint32_t *a = r + (size_t) j * s->width;
+         uint32_t *b = r + (size_t) ( s->height-1-j ) * s->width;
+         for(unsigned int i=0;i<s->width;++i) {
+            uint32_t t = a[i];
+            a[i] = b[i];
+            b[i] = t;
+         }
+      }
+      unsigned char *c = (unsigned char*) r;
+      for(size_t i=0;i<npix;++i) {
+         const uint32_t x = r[i];
+         c[i*4  ] = (unsigned char) ( x & 0xFF );
+         c[i*4+1] = (unsigned char) ( ( x >> 8 ) & 0xFF );
+         c[i*4+2] = (unsigned char) ( ( x >> 16 ) & 0xFF );
+         c[i*4+3] = (unsigned char) ( ( x >> 24 ) & 0xFF );
+      }
 
    } else {
       fprintf( stdout, " [Error]  Unhandled file type: %d \n", s->type );
@@ -1042,6 +1899,80 @@ int inObj::unifyTexture( struct inImage_s* s )
 // (For now all faces need to have normal vectors, and vertex-normal pairs are
 // unique.)
 
+// rows of the ASCII Tecplot file; the nodes are xyz or xyz-uvw triplets, or
+// unified corners, and "ibase" makes the point-indices 1-based
+struct inObjTecRows_s {
+   const float *v,*n;
+   const inObjIdx_t *icsr,*jv;
+   long ibase;
+};
+
+static char* inObjTecNode3( long i, char* p, void* user )
+{
+   const struct inObjTecRows_s* r = (const struct inObjTecRows_s*) user;
+   for(int k=0;k<3;++k) {
+      *p++ = ' ';
+      p = intec_FmtFixed( p, (double) r->v[3*i+k] );
+   }
+   return intec_FmtText( p, " \n" );
+}
+
+static char* inObjTecNode6( long i, char* p, void* user )
+{
+   const struct inObjTecRows_s* r = (const struct inObjTecRows_s*) user;
+   for(int k=0;k<3;++k) {
+      *p++ = ' ';
+      p = intec_FmtFixed( p, (double) r->v[3*i+k] );
+   }
+   *p++ = ' ';
+   for(int k=0;k<3;++k) {
+      *p++ = ' ';
+      p = intec_FmtFixed( p, (double) r->n[3*i+k] );
+   }
+   return intec_FmtText( p, " \n" );
+}
+
+// a unified corner: xyz, the normal as uvw, and the texel as st
+static char* inObjTecCorner( long i, char* p, void* user )
+{
+   const struct inObjTecRows_s* r = (const struct inObjTecRows_s*) user;
+   const float* c = &( r->v[ INOBJ_CORNER_FLOATS*i ] );
+   const int order[8] = { 0, 1, 2, 5, 6, 7, 3, 4 };
+   for(int k=0;k<8;++k) {
+      *p++ = ' ';
+      if( k == 3 || k == 6 ) *p++ = ' ';
+      p = intec_FmtFixed( p, (double) c[ order[k] ] );
+   }
+   return intec_FmtText( p, " \n" );
+}
+
+// a polygon as a fan of triangles, one per line
+static char* inObjTecPoly( long i, char* p, void* user )
+{
+   const struct inObjTecRows_s* r = (const struct inObjTecRows_s*) user;
+   const long uf = (long) r->jv[ r->icsr[i] ] + r->ibase;   // first point-index
+   long up=0;   // to store the "previous" point-index
+   for(size_t k=r->icsr[i];k<r->icsr[i+1];++k) {
+      const long ul = (long) r->jv[k] + r->ibase;
+      if( k - r->icsr[i] < 3 ) {
+         *p++ = ' ';
+         p = intec_FmtLong( p, ul );
+         *p++ = ' ';
+      } else {
+         if( k - r->icsr[i] == 3 ) *p++ = '\n';
+         const long u[3] = { uf, up, ul };
+         for(int m=0;m<3;++m) {
+            *p++ = ' ';
+            p = intec_FmtLong( p, u[m] );
+            *p++ = ' ';
+         }
+      }
+      up = ul;   // store the previous point-index
+   }
+   *p++ = '\n';
+   return p;
+}
+
 int inObj::dumpTecplot( const char filename[] ) const
 {
    if( filename == NULL ) return 1;
@@ -1049,73 +1980,275 @@ int inObj::dumpTecplot( const char filename[] ) const
    int nvert = (int) vertex.size();
    int nnorm = (int) normal.size();
    int npoly = (int) icsr.size() - 1;
+   // normals that are not one-to-one with vertices, or texels, need corners
+   if( ( nnorm > 0 && nvert != nnorm ) || texel.size() > 0 ) {
+      return dumpTecplotCorners( filename, 0 );
+   }
    // switch for only ploting normal vectors if they are pressumed one-to-one
    unsigned char ic=0;
    if( nvert != nnorm ) ic=1;
 
    // count polygons as collections of triangles
    int ntri=npoly;
+   long mmax=0;
    for(int i=0;i<npoly;++i) {
-      ntri += icsr[i+1] - icsr[i] - 3;
+      ntri += (int) ( icsr[i+1] - icsr[i] ) - 3;
+      if( (long) ( icsr[i+1] - icsr[i] ) > mmax ) mmax = icsr[i+1] - icsr[i];
    }
 #ifdef _DEBUG_
    fprintf( stdout, " [DEBUG:dumpTecplot]  Poly: %d  Tri: %d \n", npoly, ntri );
 #endif
 
-   FILE *fp = fopen( filename, "w" );
-   if( fp == NULL ) {
+   int fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+   if( fd == -1 ) {
       fprintf( stdout, " [Error]  Could not open \"%s\" for writing. \n",
                filename );
       return -1;
    }
 
-   if( ic ) {
-      fprintf( fp, "VARIABLES = x y z \n" );
-   } else {
-      fprintf( fp, "VARIABLES = x y z u v w \n" );
+   char head[512];
+   int nh = snprintf( head, 512, "%s"
+                      "ZONE T=\"obj file\" \n"
+                      "     NODES=%d, ELEMENTS=%d, \n"
+                      "     DATAPACKING=POINT, ZONETYPE=FETRIANGLE, \n"
+                      "%s",
+                      ( ic ? "VARIABLES = x y z \n" :
+                             "VARIABLES = x y z u v w \n" ),
+                      nvert, ntri,
+                      ( ic ? "     VARLOCATION=([1-3]=NODAL) \n" :
+                             "     VARLOCATION=([1-6]=NODAL) \n" ) );
+
+   struct inObjTecRows_s rows;
+   rows.v = (const float*) vertex.data();
+   rows.n = (const float*) normal.data();
+   rows.icsr = icsr.data();
+   rows.jv = jv.data();
+   rows.ibase = 0;
+
+   int ierr = intec_WriteText( fd, head, (size_t) nh );
+   if( ierr == 0 ) {
+      ierr = intec_WriteAscii( fd, nvert, 6*( INTEC_MAXFIXED + 2 ) + 4,
+                               ( ic ? inObjTecNode3 : inObjTecNode6 ),
+                               &rows, 0 );
    }
-   fprintf( fp, "ZONE T=\"obj file\" \n" );
-   fprintf( fp, "     NODES=%d, ELEMENTS=%d, \n", nvert, ntri );
-   fprintf( fp, "     DATAPACKING=POINT, ZONETYPE=FETRIANGLE, \n" );
-   if( ic ) {
-      fprintf( fp, "     VARLOCATION=([1-3]=NODAL) \n" );
-   } else {
-      fprintf( fp, "     VARLOCATION=([1-6]=NODAL) \n" );
+   if( ierr == 0 ) {
+      ierr = intec_WriteAscii( fd, npoly, (size_t) ( 3*mmax*24 + 8 ),
+                               inObjTecPoly, &rows, 0 );
    }
 
-   for(int n=0;n<nvert;++n) {
-      if( ic ) {
-         fprintf( fp, " %lf %lf %lf \n",
-                  vertex[n].x, vertex[n].y, vertex[n].z );
-      } else {
-         fprintf( fp, " %lf %lf %lf  %lf %lf %lf \n",
-                  vertex[n].x, vertex[n].y, vertex[n].z,
-                  normal[n].x, normal[n].y, normal[n].z );
+   if( close( fd ) != 0 || ierr != 0 ) {
+      fprintf( stdout, " [Error]  Failed writing \"%s\" \n", filename );
+      return 2;
+   }
+
+   return 0;
+}
+
+//
+// Method to dump the mesh as a binary Tecplot file (".plt"); the contents are
+// the same as those of dumpTecplot(), with polygons split as triangle fans
+//
+
+int inObj::dumpTecplotBinary( const char filename[] ) const
+{
+   if( filename == NULL ) return 1;
+
+   const long nvert = (long) vertex.size();
+   const long nnorm = (long) normal.size();
+   const long npoly = (long) icsr.size() - 1;
+   const int ic = ( nvert != nnorm ? 1 : 0 );
+   if( ( nnorm > 0 && ic ) || texel.size() > 0 ) {
+      return dumpTecplotCorners( filename, 1 );
+   }
+
+   long ntri=0;
+   for(long i=0;i<npoly;++i) {
+      const long m = (long) ( icsr[i+1] - icsr[i] );
+      if( m >= 3 ) ntri += m - 2;
+   }
+#ifdef _DEBUG_
+   fprintf( stdout, " [DEBUG:dumpTecplotBinary]  Poly: %ld  Tri: %ld \n",
+            npoly, ntri );
+#endif
+
+   double vmin[6],vmax[6];
+   for(int k=0;k<6;++k) {
+      vmin[k] =  HUGE_VAL;
+      vmax[k] = -HUGE_VAL;
+   }
+   const float* pv = (const float*) vertex.data();
+   const float* pn = (const float*) normal.data();
+   for(int k=0;k<3;++k) {
+      intec_Range( pv + k, nvert, sizeof(vec3_s), &( vmin[k] ), &( vmax[k] ) );
+      if( !ic ) intec_Range( pn + k, nnorm, sizeof(vec3_s),
+                             &( vmin[3+k] ), &( vmax[3+k] ) );
+   }
+
+   struct inTec_s tec;
+   if( intec_Open( &tec, filename, "obj file", "obj file",
+                   ( ic ? "x y z" : "x y z u v w" ), INTEC_FETRIANGLE,
+                   nvert, ntri, vmin, vmax ) != 0 ) {
+      fprintf( stdout, " [Error]  Could not open \"%s\" for writing. \n",
+               filename );
+      return -1;
+   }
+
+   int ierr=0;
+   for(int k=0;k<3 && ierr == 0;++k) {
+      ierr = intec_WriteStrided( &tec, pv + k, nvert, sizeof(vec3_s) );
+   }
+   for(int k=0;k<3 && ierr == 0 && !ic;++k) {
+      ierr = intec_WriteStrided( &tec, pn + k, nnorm, sizeof(vec3_s) );
+   }
+
+   // fans of triangles, staged and written in bulk
+   std::vector< int32_t > conn;
+   conn.reserve( 3*4096 + 3 );
+   for(long i=0;i<npoly && ierr == 0;++i) {
+      if( icsr[i+1] - icsr[i] < 3 ) continue;
+      const int32_t uf = (int32_t) jv[ icsr[i] ] - 1;
+      for(size_t k=icsr[i]+2;k<icsr[i+1];++k) {
+         conn.push_back( uf );
+         conn.push_back( (int32_t) jv[k-1] - 1 );
+         conn.push_back( (int32_t) jv[k] - 1 );
       }
+      if( conn.size() >= 3*4096 ) {
+         ierr = intec_WriteConnectivity( &tec, conn.data(),
+                                         (long) conn.size() );
+         conn.clear();
+      }
+   }
+   if( !conn.empty() && ierr == 0 ) {
+      ierr = intec_WriteConnectivity( &tec, conn.data(), (long) conn.size() );
    }
 
-   const unsigned long int m3 = 0x0FFFFF;
-   const unsigned long int m2 = m3 << 20;
-   const unsigned long int m1 = m2 << 20;
-   for(int i=0;i<npoly;++i) {
-      unsigned long int uf = jcsr[ icsr[i] ];   // store the first point-index
-      unsigned long int up;   // to store the "previous" point-index
-      for(int k=icsr[i];k<icsr[i+1];++k) {
-         unsigned long int ul = jcsr[k];
-         if( k - icsr[i] < 3 ) {
-            fprintf( fp, " %d ", (int) ( (ul & m1) >> 40 ) );
-         } else {
-            if( k - icsr[i] == 3 ) fprintf( fp, "\n" );
-            fprintf( fp, " %d ", (int) ( (uf & m1) >> 40 ) );
-            fprintf( fp, " %d ", (int) ( (up & m1) >> 40 ) );
-            fprintf( fp, " %d ", (int) ( (ul & m1) >> 40 ) );
-         }
-         up = ul;   // store the previous point-index
+   if( intec_Close( &tec ) != 0 || ierr != 0 ) {
+      fprintf( stdout, " [Error]  Failed writing \"%s\" \n", filename );
+      return 2;
+   }
+
+   return 0;
+}
+
+//
+// Method to dump the mesh with one node per unified corner, carrying the
+// normal (uvw) and the texel (st) of the corner, in ASCII or binary form;
+// polygons are split as triangle fans
+//
+
+int inObj::dumpTecplotCorners( const char filename[], int ibinary ) const
+{
+   std::vector< float > cv;
+   std::vector< inObjIdx_t > kc;
+   const float* pc = cvert.data();
+   const inObjIdx_t* pk = kcorner.data();
+   if( kcorner.size() != jv.size() ) {
+      if( makeCorners( cv, kc, num_threads ) != 0 ) return 1;
+      pc = cv.data();
+      pk = kc.data();
+   }
+   const long ncor = (long) ( ( kcorner.size() != jv.size() ? cv.size() :
+                                cvert.size() ) / INOBJ_CORNER_FLOATS );
+   const long npoly = (long) icsr.size() - 1;
+
+   long ntri=0,mmax=0;
+   for(long i=0;i<npoly;++i) {
+      const long m = (long) ( icsr[i+1] - icsr[i] );
+      if( m >= 3 ) ntri += m - 2;
+      if( m > mmax ) mmax = m;
+   }
+#ifdef _DEBUG_
+   fprintf( stdout, " [DEBUG:dumpTecplotCorners]  Corners: %ld  Tri: %ld \n",
+            ncor, ntri );
+#endif
+
+   if( !ibinary ) {
+      int fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+      if( fd == -1 ) {
+         fprintf( stdout, " [Error]  Could not open \"%s\" for writing. \n",
+                  filename );
+         return -1;
+      }
+
+      char head[512];
+      int nh = snprintf( head, 512, "VARIABLES = x y z u v w s t \n"
+                         "ZONE T=\"obj file\" \n"
+                         "     NODES=%ld, ELEMENTS=%ld, \n"
+                         "     DATAPACKING=POINT, ZONETYPE=FETRIANGLE, \n"
+                         "     VARLOCATION=([1-8]=NODAL) \n", ncor, ntri );
+
+      struct inObjTecRows_s rows;
+      rows.v = pc;
+      rows.n = NULL;
+      rows.icsr = icsr.data();
+      rows.jv = pk;
+      rows.ibase = 1;
+
+      int ierr = intec_WriteText( fd, head, (size_t) nh );
+      if( ierr == 0 ) {
+         ierr = intec_WriteAscii( fd, ncor, 8*( INTEC_MAXFIXED + 2 ) + 8,
+                                  inObjTecCorner, &rows, 0 );
+      }
+      if( ierr == 0 ) {
+         ierr = intec_WriteAscii( fd, npoly, (size_t) ( 3*mmax*24 + 8 ),
+                                  inObjTecPoly, &rows, 0 );
+      }
+
+      if( close( fd ) != 0 || ierr != 0 ) {
+         fprintf( stdout, " [Error]  Failed writing \"%s\" \n", filename );
+         return 2;
       }
-      fprintf( fp, "\n" );
+      return 0;
    }
 
-   fclose( fp );
+   // variables in the order x y z u v w s t of the ASCII file
+   const int order[8] = { 0, 1, 2, 5, 6, 7, 3, 4 };
+   const size_t stride = INOBJ_CORNER_FLOATS * sizeof(float);
+   double vmin[8],vmax[8];
+   for(int k=0;k<8;++k) {
+      vmin[k] =  HUGE_VAL;
+      vmax[k] = -HUGE_VAL;
+      intec_Range( pc + order[k], ncor, stride, &( vmin[k] ), &( vmax[k] ) );
+   }
+
+   struct inTec_s tec;
+   if( intec_Open( &tec, filename, "obj file", "obj file",
+                   "x y z u v w s t", INTEC_FETRIANGLE,
+                   ncor, ntri, vmin, vmax ) != 0 ) {
+      fprintf( stdout, " [Error]  Could not open \"%s\" for writing. \n",
+               filename );
+      return -1;
+   }
+
+   int ierr=0;
+   for(int k=0;k<8 && ierr == 0;++k) {
+      ierr = intec_WriteStrided( &tec, pc + order[k], ncor, stride );
+   }
+
+   std::vector< int32_t > conn;
+   conn.reserve( 3*4096 + 3 );
+   for(long i=0;i<npoly && ierr == 0;++i) {
+      if( icsr[i+1] - icsr[i] < 3 ) continue;
+      const int32_t uf = (int32_t) pk[ icsr[i] ];
+      for(size_t k=icsr[i]+2;k<icsr[i+1];++k) {
+         conn.push_back( uf );
+         conn.push_back( (int32_t) pk[k-1] );
+         conn.push_back( (int32_t) pk[k] );
+      }
+      if( conn.size() >= 3*4096 ) {
+         ierr = intec_WriteConnectivity( &tec, conn.data(),
+                                         (long) conn.size() );
+         conn.clear();
+      }
+   }
+   if( !conn.empty() && ierr == 0 ) {
+      ierr = intec_WriteConnectivity( &tec, conn.data(), (long) conn.size() );
+   }
+
+   if( intec_Close( &tec ) != 0 || ierr != 0 ) {
+      fprintf( stdout, " [Error]  Failed writing \"%s\" \n", filename );
+      return 2;
+   }
 
    return 0;
 }
@@ -1127,11 +2260,28 @@ int inObj::dumpTecplot( const char filename[] ) const
 //
 
 void* objReadFile( const char filename[] )
+{
+   return objReadFileMode( filename, ReadMmap );
+}
+
+void* objReadFileMode( const char filename[], int imode )
+{
+   return objReadFileOpts( filename, imode, 1 );
+}
+
+void* objReadFileParallel( const char filename[], int nthreads )
+{
+   return objReadFileOpts( filename, ReadMmap, nthreads );
+}
+
+void* objReadFileOpts( const char filename[], int imode, int nthreads )
 {
 #ifdef _DEBUG_
    fprintf( stdout, " [DEBUG]  C wrapper of OBJ file reader starting \n" );
 #endif
    inObj* objp = new inObj();
+   objp->setReadMode( imode );
+   objp->setNumThreads( nthreads );
 
    int iret = objp->read( filename );
    if( iret ) {
@@ -1151,6 +2301,123 @@ void* objReadFile( const char filename[] )
 }
 
 
+int objReadStream( const char filename[], long nbatch,
+                   inObjBatchFn fn, void* user )
+{
+   inObj* objp = new inObj();
+
+   int iret = objp->readStream( filename, nbatch, fn, user );
+   if( iret ) {
+      fprintf( stdout, " [Error]  Could not stream OBJ file \"%s\"\n", filename );
+   }
+   delete objp;
+
+   return iret;
+}
+
+// like objReadStream(), but the object is kept for its group table and its
+// materials (the mesh arrays are empty)
+void* objStreamFile( const char filename[], long nbatch,
+                     inObjBatchFn fn, void* user )
+{
+   inObj* objp = new inObj();
+
+   int iret = objp->readStream( filename, nbatch, fn, user );
+   if( iret ) {
+      fprintf( stdout, " [Error]  Could not stream OBJ file \"%s\"\n", filename );
+      delete objp;
+      objp = NULL;
+   }
+
+   return (void*) objp;
+}
+
+void* objReadSlice( const char filename[], int islice, int nslice )
+{
+   inObj* objp = new inObj();
+
+   int iret = objp->readSlice( filename, islice, nslice );
+   if( iret ) {
+      fprintf( stdout, " [Error]  Could not read slice %d of OBJ file \"%s\"\n",
+               islice, filename );
+      delete objp;
+      objp = NULL;
+   }
+
+   return (void*) objp;
+}
+
+int objResolveSlice( void* p, const struct inObjCounts_s* base )
+{
+   if( p == NULL ) return 1;
+
+   inObj* objp = (inObj*) p;
+
+   return objp->resolveSlice( base );
+}
+
+int objLoadMtllib( void* p, const char name[] )
+{
+   if( p == NULL ) return 1;
+
+   inObj* objp = (inObj*) p;
+
+   return objp->loadMtllib( name );
+}
+
+const char* objGetMtllibName( void* p )
+{
+   if( p == NULL ) return NULL;
+
+   inObj* objp = (inObj*) p;
+
+   return objp->getMtllibName();
+}
+
+int objPrescanFile( const char filename[], struct inObjCounts_s* c )
+{
+   return inObj::prescanFile( filename, c );
+}
+
+void objGetCounts( void* p, struct inObjCounts_s* c )
+{
+   if( p == NULL ) {
+      memset( c, 0, sizeof(struct inObjCounts_s) );
+      return;
+   }
+
+   inObj* objp = (inObj*) p;
+
+   objp->getCounts( c );
+}
+
+#define OBJ_GETTER( T, fname, method ) \
+T* fname( void* p, long* n ) \
+{ \
+   if( p == NULL ) { *n = 0; return NULL; } \
+   inObj* objp = (inObj*) p; \
+   return objp->method( n ); \
+}
+
+OBJ_GETTER( const float, objGetVertices, getVertices )
+OBJ_GETTER( const float, objGetNormals, getNormals )
+OBJ_GETTER( const float, objGetTexels, getTexels )
+OBJ_GETTER( const inObjIdx_t, objGetFaceOffsets, getFaceOffsets )
+OBJ_GETTER( const inObjIdx_t, objGetFaceVertexIndices, getFaceVertexIndices )
+OBJ_GETTER( const inObjIdx_t, objGetFaceTexelIndices, getFaceTexelIndices )
+OBJ_GETTER( const inObjIdx_t, objGetFaceNormalIndices, getFaceNormalIndices )
+OBJ_GETTER( const float, objGetCorners, getCorners )
+OBJ_GETTER( const inObjIdx_t, objGetCornerIndices, getCornerIndices )
+
+int objBuildCorners( void* p, int nthreads )
+{
+   if( p == NULL ) return 1;
+
+   inObj* objp = (inObj*) p;
+
+   return objp->buildCorners( nthreads );
+}
+
 int objClear( void* p )
 {
    if( p == NULL ) return 1;
@@ -1194,6 +2461,34 @@ const char* objGetGroupName( void* p, short n )
    return objp->getGroupName( n );
 }
 
+int objGetNumMaterials( void* p )
+{
+   if( p == NULL ) return 0;
+
+   inObj* objp = (inObj*) p;
+
+   return objp->getNumMaterials();
+}
+
+int objGetMaterial( void* p, int n, struct inObjMaterial_s* m )
+{
+   if( p == NULL ) return 1;
+
+   inObj* objp = (inObj*) p;
+
+   return objp->getMaterial( n, m );
+}
+
+const unsigned char* objGetTexture( void* p, int n,
+                                    unsigned int* width, unsigned int* height )
+{
+   if( p == NULL ) return NULL;
+
+   inObj* objp = (inObj*) p;
+
+   return objp->getTexture( n, width, height );
+}
+
 int dumpTecplot( void* p, const char filename[] )
 {
    if( p == NULL ) return 1;
@@ -1205,6 +2500,15 @@ int dumpTecplot( void* p, const char filename[] )
    return 0;
 }
 
+int dumpTecplotBinary( void* p, const char filename[] )
+{
+   if( p == NULL ) return 1;
+
+   inObj* objp = (inObj*) p;
+
+   return objp->dumpTecplotBinary( filename );
+}
+
 #ifdef __cplusplus
 }
 #endif
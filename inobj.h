@@ -35,6 +35,37 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+
+// the type of face indices; build with _INOBJ_INDEX64_ for huge meshes
+#ifdef _INOBJ_INDEX64_
+typedef uint64_t inObjIdx_t;
+#else
+typedef uint32_t inObjIdx_t;
+#endif
+
+// a group statement as seen in a stream of batches
+struct inObjGroupEvent_s {
+   const char* name;
+   long face_start;     // global (0-based) index of the group's first face
+};
+
+// a batch of records from a streamed OBJ file; element "i" of an array is
+// element "base+i" of the whole file, face members are the global 1-based
+// indices of the file, and "offsets" (nface+1 entries) point in to the
+// batch's own jv/jt/jn arrays
+struct inObjBatch_s {
+   long vertex_base, nvertex;   const float* vertex;   // xyz
+   long texel_base, ntexel;     const float* texel;    // uv
+   long normal_base, nnormal;   const float* normal;   // xyz
+   long face_base, nface;       const inObjIdx_t* offsets;
+   long corner_base, ncorner;   const inObjIdx_t *jv, *jt, *jn;
+   int ngroup;                  const struct inObjGroupEvent_s* groups;
+};
+
+// consumer of batches; the arrays are only valid during the call, and a
+// non-zero return aborts the parsing
+typedef int (*inObjBatchFn)( const struct inObjBatch_s* b, void* user );
 
 enum inObjState {
    Unknown = -1,
@@ -42,6 +73,35 @@ enum inObjState {
    Ready = 0
 };
 
+enum inObjReadMode {
+   ReadStdio = 0,       // line-by-line through a FILE* (works on pipes)
+   ReadMmap = 1,        // map the file and walk it in place (default)
+   ReadPrescan = 2      // flag: count records first and size the arrays
+};
+
+// a material of the OBJ file's material library; the strings belong to the
+// object
+struct inObjMaterial_s {
+   const char* name;
+   float Ka[3], Kd[3], Ks[3];
+   float Ns, Ni, d;
+   int illum;
+   const char* map_Kd;
+};
+
+// floats of a unified corner of the faces: x y z, s t (texel), nx ny nz
+#define INOBJ_CORNER_FLOATS 8
+
+// numbers of records in an OBJ file (from a pre-scan or after parsing)
+struct inObjCounts_s {
+   long nvertex;
+   long ntexel;
+   long nnormal;
+   long nface;
+   long ncorner;        // face members over all faces
+   long ngroup;
+};
+
 
 #ifdef __cplusplus
 
@@ -63,6 +123,17 @@ class inObj {
    int getState( void ) const;
 
    int read( const char filename_[] );
+   int readStream( const char filename_[], long nbatch,
+                   inObjBatchFn fn, void* user );
+   int readSlice( const char filename_[], int islice, int nslice );
+   int resolveSlice( const struct inObjCounts_s* base );
+   int loadMtllib( const char name[] );
+   const char* getMtllibName() const;
+   void setReadMode( int imode );
+   void setNumThreads( int n );
+   void setPrescan( int iflag );
+   void getCounts( struct inObjCounts_s* c ) const;
+   static int prescanFile( const char filename_[], struct inObjCounts_s* c );
 
    void clear();
 
@@ -70,7 +141,38 @@ class inObj {
    void getGroupBounds( short n, int* start, int* end ) const;
    const char* getGroupName( short n ) const;
 
+   int getNumMaterials() const;
+   int getMaterial( int n, struct inObjMaterial_s* m ) const;
+   const unsigned char* getTexture( int n, unsigned int* width,
+                                    unsigned int* height ) const;
+
    int dumpTecplot( const char filename[] ) const;
+   int dumpTecplotBinary( const char filename[] ) const;
+
+   // raw access to the mesh arrays; vertices and normals are xyz triplets,
+   // texels are uv pairs, and faces are in CSR form: face "n" has members
+   // [ offsets[n], offsets[n+1] ) in the three (1-based) index arrays, where
+   // a zero texel or normal index means "not given"
+   const float* getVertices( long* n ) const;
+   const float* getNormals( long* n ) const;
+   const float* getTexels( long* n ) const;
+   const inObjIdx_t* getFaceOffsets( long* n ) const;
+   const inObjIdx_t* getFaceVertexIndices( long* n ) const;
+   const inObjIdx_t* getFaceTexelIndices( long* n ) const;
+   const inObjIdx_t* getFaceNormalIndices( long* n ) const;
+
+   // unified corners: the distinct (v,vt,vn) triplets of the face members,
+   // numbered in the order of their first use and interleaved as
+   // INOBJ_CORNER_FLOATS floats (zeros for what is not given), with one
+   // 0-based index in to them per face member (in the CSR form of faces)
+   int buildCorners( int nthreads );
+   const float* getCorners( long* n ) const;
+   const inObjIdx_t* getCornerIndices( long* n ) const;
+
+   // a token of a line: a view in to the line's characters
+   struct inObjTok_s {
+      const char *s, *e;
+   };
 
  protected:
    unsigned int istate;
@@ -127,7 +229,7 @@ class inObj {
       inFileMagic type;
       unsigned int width,height;
       int irgb;
-      void* img_data;   // Interpreted differently for diff. types
+      void* img_data;   // RGBA bytes, top row first (see unifyTexture())
    };
 
    struct inObjMtl_s {
@@ -146,6 +248,10 @@ class inObj {
  private:
    std::string filename;
    FILE *fp=NULL;
+   int read_mode=ReadMmap;
+   const char *map_base=NULL, *map_end=NULL, *map_pos=NULL;
+   size_t map_size=0;
+   const char *line_s=NULL, *line_e=NULL;  // current line (not terminated)
    int num_lines=0;
    short num_groups=0;
    struct inObjGrp_s dgroup = { .fs=0, .fe=0 };
@@ -157,26 +263,61 @@ class inObj {
    std::vector< vec3_s > vertex;
    std::vector< vec2_s > texel;
    std::vector< vec3_s > normal;
-   std::vector< int > icsr;                    // CSR style segmented polygons
-   std::vector< unsigned long int > jcsr;      // CSR style segmentes polygons
+   std::vector< inObjIdx_t > icsr;             // CSR style segmented polygons
+   std::vector< inObjIdx_t > jv,jt,jn;         // v/vt/vn of polygon members
+   std::vector< float > cvert;                 // unified corners, if built
+   std::vector< inObjIdx_t > kcorner;
+
+   // state for parsing a piece of a mapped file on its own; relative face
+   // indices can only be resolved once the preceding pieces are counted
+   int num_threads=1;
+   int chunk_mode=0;
+   int iprescan=0;
+   struct inObjFix_s {
+      size_t k;            // position in jv/jt/jn
+      int mask;            // 1: vertex, 2: texel, 4: normal
+      long iv,it,in;       // index relative to the chunk's own counts
+   };
+   std::vector< struct inObjFix_s > fixes;
+
+   // state for streaming in batches; the bases count what was handed over
+   inObjBatchFn stream_fn=NULL;
+   void* stream_user=NULL;
+   long nbatch=0;
+   long vbase=0,tbase=0,nbase=0,cbase=0;
+   size_t gsent=0;
 
    int parse();
+   int flushBatch( int ifinal );
+   void prescan();
+   int parseParallel();
+   int mergeChunks( std::vector< inObj* > & parts );
+   int resolveIndex( long & l, long n, int ibit, int & mask ) const;
+   int mapFile( const char filename_[] );
+   void unmapFile();
    int readLine();
+   int readLineMap();
    int handleLine();
-   int handleVertex( std::vector< std::string > & strings );
-   int handleNormal( std::vector< std::string > & strings );
-   int handleTexel( std::vector< std::string > & strings );
-   int handleFace( std::vector< std::string > & strings );
-   int handleGroup( std::vector< std::string > & strings );
-   int handleSmooth( std::vector< std::string > & strings );
-   int handleObject( std::vector< std::string > & strings );
-   int handleMtllib( std::vector< std::string > & strings );
+   std::vector< inObjTok_s > toks;             // re-used for every line
+   static int keywordObj( const inObjTok_s & t );
+   static int keywordMtl( const inObjTok_s & t );
+   int handleVertex( const std::vector< inObjTok_s > & toks );
+   int handleNormal( const std::vector< inObjTok_s > & toks );
+   int handleTexel( const std::vector< inObjTok_s > & toks );
+   int handleFace( const std::vector< inObjTok_s > & toks );
+   int handleGroup( const std::vector< inObjTok_s > & toks );
+   int handleSmooth( const std::vector< inObjTok_s > & toks );
+   int handleObject( const std::vector< inObjTok_s > & toks );
+   int handleMtllib( const std::vector< inObjTok_s > & toks );
    int parseMtllib();
    int handleMtlLine( struct inObjMtl_s & mtl_, int & have_one );
    int determineFileType( const char* filepath ) const;
    int unifyTexture( struct inImage_s* s );
+   int makeCorners( std::vector< float > & cv, std::vector< inObjIdx_t > & kc,
+                    int nthreads ) const;
+   int dumpTecplotCorners( const char filename[], int ibinary ) const;
 
-   char* buf=NULL,*buf2=NULL;
+   char* buf=NULL;
    size_t nbytes=0;
 };
 
@@ -189,6 +330,50 @@ extern "C" {
 
 void* objReadFile( const char filename_[] );
 
+void* objReadFileMode( const char filename_[], int imode );
+
+void* objReadFileParallel( const char filename_[], int nthreads );
+
+void* objReadFileOpts( const char filename_[], int imode, int nthreads );
+
+int objReadStream( const char filename_[], long nbatch,
+                   inObjBatchFn fn, void* user );
+
+void* objStreamFile( const char filename_[], long nbatch,
+                     inObjBatchFn fn, void* user );
+
+void* objReadSlice( const char filename_[], int islice, int nslice );
+
+int objResolveSlice( void* p, const struct inObjCounts_s* base );
+
+int objLoadMtllib( void* p, const char name[] );
+
+const char* objGetMtllibName( void* p );
+
+int objPrescanFile( const char filename_[], struct inObjCounts_s* c );
+
+void objGetCounts( void* p, struct inObjCounts_s* c );
+
+const float* objGetVertices( void* p, long* n );
+
+const float* objGetNormals( void* p, long* n );
+
+const float* objGetTexels( void* p, long* n );
+
+const inObjIdx_t* objGetFaceOffsets( void* p, long* n );
+
+const inObjIdx_t* objGetFaceVertexIndices( void* p, long* n );
+
+const inObjIdx_t* objGetFaceTexelIndices( void* p, long* n );
+
+const inObjIdx_t* objGetFaceNormalIndices( void* p, long* n );
+
+int objBuildCorners( void* p, int nthreads );
+
+const float* objGetCorners( void* p, long* n );
+
+const inObjIdx_t* objGetCornerIndices( void* p, long* n );
+
 int objClear( void* p );
 
 short objGetNumGroups( void* p );
@@ -197,8 +382,17 @@ void objGetGroupBounds( void*p, short n, int* start, int* end );
 
 const char* objGetGroupName( void*p, short n );
 
+int objGetNumMaterials( void* p );
+
+int objGetMaterial( void* p, int n, struct inObjMaterial_s* m );
+
+const unsigned char* objGetTexture( void* p, int n,
+                                    unsigned int* width, unsigned int* height );
+
 int dumpTecplot( void* p, const char filename[]  );
 
+int dumpTecplotBinary( void* p, const char filename[]  );
+
 #ifdef __cplusplus
 }
 #endif
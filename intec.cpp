@@ -0,0 +1,540 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <charconv>
+#include <thread>
+#include <vector>
+
+#include "intec.h"
+
+// size of the staging buffer in values
+#define INTEC_NBUF 16384
+
+
+//
+// Functions to write the elementary items of the format; numbers are in the
+// byte order of the machine, which is declared by the leading integer "1"
+//
+
+static int intec_PutInt( FILE *fp, int32_t i )
+{
+   return( fwrite( &i, sizeof(int32_t), 1, fp ) == 1 ? 0 : 1 );
+}
+
+static int intec_PutFloat( FILE *fp, float f )
+{
+   return( fwrite( &f, sizeof(float), 1, fp ) == 1 ? 0 : 1 );
+}
+
+static int intec_PutDouble( FILE *fp, double d )
+{
+   return( fwrite( &d, sizeof(double), 1, fp ) == 1 ? 0 : 1 );
+}
+
+// a string is a zero-terminated sequence of 32bit characters
+static int intec_PutString( FILE *fp, const char *s, size_t n )
+{
+   int ierr=0;
+   size_t i;
+
+   for(i=0;i<n;++i) ierr += intec_PutInt( fp, (int32_t) (unsigned char) s[i] );
+   ierr += intec_PutInt( fp, 0 );
+
+   return ierr;
+}
+
+static int intec_IsSep( char c )
+{
+   return( c == ' ' || c == '\t' || c == ',' );
+}
+
+
+//
+// Function to open a file and write everything up to the zone's data
+//
+
+int intec_Open( struct inTec_s *t, const char *filename,
+                const char *title, const char *zone, const char *vars,
+                int itype, long nnode, long nelem,
+                const double *vmin, const double *vmax )
+#define FUNC "intec_Open"
+{
+   const char *s;
+   int ierr=0,n;
+
+
+   memset( t, 0, sizeof(struct inTec_s) );
+   if( filename == NULL || vars == NULL ) return 1;
+
+   switch( itype ) {
+    case INTEC_FELINESEG:  t->npe = 2; break;
+    case INTEC_FETRIANGLE: t->npe = 3; break;
+    case INTEC_FEQUAD:     t->npe = 4; break;
+    default:
+      fprintf( stderr, " e [%s]  Unsupported zone type %d \n", FUNC, itype );
+      return 1;
+   }
+   if( nnode > INT32_MAX || nelem > INT32_MAX ) {
+      fprintf( stderr, " e [%s]  Zone too large for the format \n", FUNC );
+      return 2;
+   }
+
+   // count the variables
+   t->nvar = 0;
+   for(s=vars;*s!='\0';) {
+      while( intec_IsSep( *s ) ) ++s;
+      if( *s == '\0' ) break;
+      ++t->nvar;
+      while( *s != '\0' && !intec_IsSep( *s ) ) ++s;
+   }
+   if( t->nvar == 0 ) {
+      fprintf( stderr, " e [%s]  No variables given \n", FUNC );
+      return 1;
+   }
+
+   t->buf = (float *) malloc( INTEC_NBUF * sizeof(float) );
+   if( t->buf == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate staging buffer \n", FUNC );
+      return 3;
+   }
+
+   t->fp = fopen( filename, "w" );
+   if( t->fp == NULL ) {
+      fprintf( stderr, " e [%s]  Could not write file: \"%s\"\n",FUNC,filename);
+      free( t->buf );
+      t->buf = NULL;
+      return 4;
+   } else {
+      fprintf( stderr, " i [%s]  Writing file: \"%s\"\n", FUNC, filename );
+   }
+   t->nnode = nnode;
+   t->nelem = nelem;
+
+   // header section: magic, byte order, file type (full), title, variables
+   ierr += ( fwrite( "#!TDV112", 1, 8, t->fp ) == 8 ? 0 : 1 );
+   ierr += intec_PutInt( t->fp, 1 );
+   ierr += intec_PutInt( t->fp, 0 );
+   if( title == NULL ) title = "";
+   ierr += intec_PutString( t->fp, title, strlen( title ) );
+   ierr += intec_PutInt( t->fp, t->nvar );
+   for(s=vars;*s!='\0';) {
+      while( intec_IsSep( *s ) ) ++s;
+      if( *s == '\0' ) break;
+      for(n=0;s[n]!='\0' && !intec_IsSep( s[n] );++n);
+      ierr += intec_PutString( t->fp, s, (size_t) n );
+      s += n;
+   }
+
+   // the zone's header
+   if( zone == NULL ) zone = "ZONE 001";
+   ierr += intec_PutFloat( t->fp, 299.0f );
+   ierr += intec_PutString( t->fp, zone, strlen( zone ) );
+   ierr += intec_PutInt( t->fp, -1 );          // parent zone
+   ierr += intec_PutInt( t->fp, -1 );          // strand (static)
+   ierr += intec_PutDouble( t->fp, 0.0 );      // solution time
+   ierr += intec_PutInt( t->fp, -1 );          // (not used)
+   ierr += intec_PutInt( t->fp, itype );
+   ierr += intec_PutInt( t->fp, 0 );           // all variables at nodes
+   ierr += intec_PutInt( t->fp, 0 );           // no face neighbours
+   ierr += intec_PutInt( t->fp, 0 );           // no user face connections
+   ierr += intec_PutInt( t->fp, (int32_t) nnode );
+   ierr += intec_PutInt( t->fp, (int32_t) nelem );
+   ierr += intec_PutInt( t->fp, 0 );           // I/J/K cell dimensions
+   ierr += intec_PutInt( t->fp, 0 );
+   ierr += intec_PutInt( t->fp, 0 );
+   ierr += intec_PutInt( t->fp, 0 );           // no auxiliary data
+   ierr += intec_PutFloat( t->fp, 357.0f );    // end of header
+
+   // data section: the zone's variable formats (all float) and ranges
+   ierr += intec_PutFloat( t->fp, 299.0f );
+   for(n=0;n<t->nvar;++n) ierr += intec_PutInt( t->fp, 1 );
+   ierr += intec_PutInt( t->fp, 0 );           // no passive variables
+   ierr += intec_PutInt( t->fp, 0 );           // no shared variables
+   ierr += intec_PutInt( t->fp, -1 );          // no shared connectivity
+   for(n=0;n<t->nvar;++n) {
+      ierr += intec_PutDouble( t->fp, ( vmin != NULL ? vmin[n] : 0.0 ) );
+      ierr += intec_PutDouble( t->fp, ( vmax != NULL ? vmax[n] : 0.0 ) );
+   }
+
+   if( ierr != 0 ) {
+      fprintf( stderr, " e [%s]  Failed writing the header \n", FUNC );
+      fclose( t->fp );
+      t->fp = NULL;
+      free( t->buf );
+      t->buf = NULL;
+      return 5;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to append contiguous values to the variables; a piece may run
+// over from one variable to the next
+//
+
+int intec_WriteBlock( struct inTec_s *t, const float *v, long n )
+#define FUNC "intec_WriteBlock"
+{
+   if( t->fp == NULL ) return 1;
+   if( n > ( (long) ( t->nvar - t->ivar ) ) * t->nnode - t->nval ) {
+      fprintf( stderr, " e [%s]  More values than the zone holds \n", FUNC );
+      return 2;
+   }
+
+   if( n > 0 && fwrite( v, sizeof(float), (size_t) n, t->fp ) != (size_t) n ) {
+      fprintf( stderr, " e [%s]  Failed to write values \n", FUNC );
+      return 3;
+   }
+
+   t->nval += n;
+   if( t->nnode > 0 ) {
+      t->ivar += (int) ( t->nval / t->nnode );
+      t->nval = t->nval % t->nnode;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to append values that are "stride" bytes apart in memory, such as
+// one component of an array of structures
+//
+
+int intec_WriteStrided( struct inTec_s *t, const void *p, long n,
+                        size_t stride )
+{
+   const char *c = (const char *) p;
+   long i,m;
+   int ierr;
+
+   while( n > 0 ) {
+      m = ( n < INTEC_NBUF ? n : INTEC_NBUF );
+      for(i=0;i<m;++i) {
+         memcpy( &( t->buf[i] ), c, sizeof(float) );
+         c += stride;
+      }
+      ierr = intec_WriteBlock( t, t->buf, m );
+      if( ierr != 0 ) return ierr;
+      n -= m;
+   }
+
+   return 0;
+}
+
+
+//
+// Function to append (zero-based) node indices of the elements
+//
+
+int intec_WriteConnectivity( struct inTec_s *t, const int32_t *c, long n )
+#define FUNC "intec_WriteConnectivity"
+{
+   if( t->fp == NULL ) return 1;
+   if( t->ivar != t->nvar ) {
+      fprintf( stderr, " e [%s]  Variables are incomplete \n", FUNC );
+      return 2;
+   }
+   if( n > t->nelem * t->npe - t->nconn ) {
+      fprintf( stderr, " e [%s]  More indices than the zone holds \n", FUNC );
+      return 2;
+   }
+
+   if( n > 0 &&
+       fwrite( c, sizeof(int32_t), (size_t) n, t->fp ) != (size_t) n ) {
+      fprintf( stderr, " e [%s]  Failed to write connectivity \n", FUNC );
+      return 3;
+   }
+   t->nconn += n;
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Function to finish the file
+//
+
+int intec_Close( struct inTec_s *t )
+#define FUNC "intec_Close"
+{
+   int ierr=0;
+
+   if( t->fp == NULL ) return 1;
+
+   if( t->ivar != t->nvar || t->nconn != t->nelem * t->npe ) {
+      fprintf( stderr, " e [%s]  Zone data are incomplete \n", FUNC );
+      ierr = 2;
+   }
+   if( fclose( t->fp ) != 0 ) {
+      fprintf( stderr, " e [%s]  Failed to finish the file \n", FUNC );
+      ierr = 3;
+   }
+   t->fp = NULL;
+   free( t->buf );
+   t->buf = NULL;
+
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// Function to widen a range by values that are "stride" bytes apart; the
+// range is to be initialized by the caller (e.g. to HUGE_VAL and -HUGE_VAL)
+//
+
+void intec_Range( const void *p, long n, size_t stride,
+                  double *vmin, double *vmax )
+{
+   const char *c = (const char *) p;
+   float f,fmin,fmax;
+   long i;
+
+   if( n <= 0 ) return;
+
+   memcpy( &fmin, c, sizeof(float) );
+   fmax = fmin;
+   for(i=1;i<n;++i) {
+      c += stride;
+      memcpy( &f, c, sizeof(float) );
+      if( f < fmin ) fmin = f;
+      if( f > fmax ) fmax = f;
+   }
+
+   if( (double) fmin < *vmin ) *vmin = (double) fmin;
+   if( (double) fmax > *vmax ) *vmax = (double) fmax;
+}
+
+
+
+//
+// Functions to format numbers and text in to a buffer without a terminator;
+// to_chars() with a precision is defined to give what printf() gives, and
+// without one it gives the fewest digits that read back to the same value
+//
+
+char* intec_FmtFixed( char *p, double v )
+{
+   return std::to_chars( p, p + INTEC_MAXFIXED + 16, v,
+                         std::chars_format::fixed, 6 ).ptr;
+}
+
+char* intec_FmtShortest( char *p, float v )
+{
+   return std::to_chars( p, p + INTEC_MAXSHORT + 16, v ).ptr;
+}
+
+char* intec_FmtLong( char *p, long l )
+{
+   return std::to_chars( p, p + 24, l ).ptr;
+}
+
+char* intec_FmtText( char *p, const char *s )
+{
+   while( *s != '\0' ) *p++ = *s++;
+   return p;
+}
+
+
+//
+// Function to write all of a buffer to a descriptor
+//
+
+int intec_WriteText( int fd, const char *s, size_t n )
+{
+   while( n > 0 ) {
+      ssize_t m = write( fd, s, n );
+      if( m < 0 ) {
+         if( errno == EINTR ) continue;
+         return 1;
+      }
+      s += m;
+      n -= (size_t) m;
+   }
+
+   return 0;
+}
+
+
+//
+// Function to write "n" items formatted by several threads; while the main
+// thread writes one round of blocks the workers format the next round
+//
+
+int intec_WriteAscii( int fd, long n, size_t maxrow,
+                      intecRowFn fn, void *user, int nthreads )
+#define FUNC "intec_WriteAscii"
+{
+   if( n <= 0 ) return 0;
+   if( nthreads <= 0 ) nthreads = (int) std::thread::hardware_concurrency();
+   if( nthreads <= 0 ) nthreads = 1;
+   if( maxrow == 0 ) maxrow = 1;
+
+   // items per block, so that a block fits in about a megabyte
+   long nb = (long) ( ( 1 << 20 ) / maxrow );
+   if( nb < 1 ) nb = 1;
+   const long nround = ( n + nb*nthreads - 1 ) / ( nb*nthreads );
+   if( nround == 1 ) nthreads = (int) ( ( n + nb - 1 ) / nb );
+
+   std::vector< char > bufs[2];
+   std::vector< size_t > len[2];
+   for(int j=0;j<2;++j) {
+      bufs[j].resize( (size_t) nthreads * (size_t) nb * maxrow );
+      len[j].resize( nthreads, 0 );
+   }
+
+   auto format = [&]( long ir, int it ) {
+      const int j = (int) ( ir % 2 );
+      const long i0 = ( ir*nthreads + it ) * nb;
+      const long i1 = ( i0 + nb < n ? i0 + nb : n );
+      char* b = &( bufs[j][ (size_t) it * (size_t) nb * maxrow ] );
+      char* p = b;
+      for(long i=i0;i<i1;++i) p = fn( i, p, user );
+      len[j][it] = ( i0 < i1 ? (size_t) ( p - b ) : 0 );
+   };
+
+   std::vector< std::thread > th;
+   auto launch = [&]( long ir ) {
+      for(int it=0;it<nthreads;++it) th.emplace_back( format, ir, it );
+   };
+   auto join = [&]() {
+      for(auto & t : th) t.join();
+      th.clear();
+   };
+
+   int ierr=0;
+   launch( 0 );
+   join();
+   for(long ir=0;ir<nround;++ir) {
+      if( ir+1 < nround ) launch( ir+1 );
+      const int j = (int) ( ir % 2 );
+      for(int it=0;it<nthreads && ierr == 0;++it) {
+         ierr = intec_WriteText( fd,
+                   &( bufs[j][ (size_t) it * (size_t) nb * maxrow ] ),
+                   len[j][it] );
+      }
+      join();
+      if( ierr != 0 ) {
+         fprintf( stderr, " e [%s]  Failed to write formatted data \n", FUNC );
+         return 1;
+      }
+   }
+
+   return 0;
+}
+#undef FUNC
+
+#ifdef _BENCH_
+//
+// Benchmark of the binary dumper against the ASCII dumper of the STL code,
+// with a synthetic soup of triangles. Build with "make bench" and run
+// "./bench_tec [triangles]".
+//
+
+#include <sys/time.h>
+#include <sys/stat.h>
+
+#include "stl.h"
+
+static double intec_Time()
+{
+   struct timeval tv;
+   gettimeofday( &tv, NULL );
+   return( (double) tv.tv_sec + 1.0e-6 * (double) tv.tv_usec );
+}
+
+static long intec_FileSize( const char *filename )
+{
+   struct stat st;
+   if( stat( filename, &st ) != 0 ) return 0;
+   return (long) st.st_size;
+}
+
+int main( int argc, char *argv[] )
+{
+   // the STL dumpers take writable names
+   char fdat[] = "bench_tec.dat", fplt[] = "bench_tec.plt";
+   struct inSTL_s stl;
+   unsigned int n,k;
+   double t0,t1,t2;
+
+   inSTL_InitSTLfile( &stl );
+   stl.ntri = 1000000;
+   if( argc > 1 ) stl.ntri = (unsigned int) atol( argv[1] );
+   stl.triangles = (struct inSTLtri_s *)
+             malloc( ((size_t) stl.ntri) * sizeof(struct inSTLtri_s) );
+   if( stl.triangles == NULL ) {
+      fprintf( stdout, " [Error]  Could not allocate benchmark triangles \n" );
+      return 1;
+   }
+   srand( 12345 );
+   for(n=0;n<stl.ntri;++n) {
+      float *f = stl.triangles[n].normal;
+      for(k=0;k<12;++k) f[k] = (float) rand() / (float) RAND_MAX - 0.5f;
+      stl.triangles[n].iatrib = 0;
+   }
+
+   t0 = intec_Time();
+   inSTL_DumpAsciiSTLTecplot( fdat, &stl );
+   t1 = intec_Time();
+   inSTL_DumpSTLTecplotBinary( fplt, &stl );
+   t2 = intec_Time();
+
+   fprintf( stdout, " Triangles: %u \n", stl.ntri );
+   fprintf( stdout, " ASCII  (.dat): %8.3f s  %8.1f MB  %8.1f Mtri/s \n",
+            t1-t0, 1.0e-6 * (double) intec_FileSize( fdat ),
+            1.0e-6 * (double) stl.ntri / ( t1-t0 ) );
+   fprintf( stdout, " Binary (.plt): %8.3f s  %8.1f MB  %8.1f Mtri/s \n",
+            t2-t1, 1.0e-6 * (double) intec_FileSize( fplt ),
+            1.0e-6 * (double) stl.ntri / ( t2-t1 ) );
+
+   free( stl.triangles );
+   unlink( fdat );
+   unlink( fplt );
+
+   return 0;
+}
+#endif
@@ -0,0 +1,122 @@
+/******************************************************************************
+ Copyright (c) 2023, Ioannis Nompelis
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without any
+ modification, are permitted provided that the following conditions are met:
+ 1. Redistribution of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+ 2. Redistribution in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+ 3. All advertising materials mentioning features or use of this software
+    must display the following acknowledgement:
+    "This product includes software developed by Ioannis Nompelis."
+ 4. Neither the name of Ioannis Nompelis and his partners/affiliates nor the
+    names of other contributors may be used to endorse or promote products
+    derived from this software without specific prior written permission.
+ 5. Redistribution or use of source code and binary forms for profit must
+    have written permission of the copyright holder.
+ 
+ THIS SOFTWARE IS PROVIDED BY IOANNIS NOMPELIS ''AS IS'' AND ANY
+ EXPRESSED OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL IOANNIS NOMPELIS BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ ******************************************************************************/
+
+#ifndef _INTEC_H_
+#define _INTEC_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+//
+// Writer of binary Tecplot files (".plt", format "#!TDV112") with a single
+// finite-element zone. Binary files keep the variables in block form: all
+// values of the first variable, then all of the second, and so on, followed by
+// the (zero-based) connectivity of the elements. The writer is used as:
+//   intec_Open()                         header and zone; needs the ranges
+//   intec_WriteBlock/Strided() ...       "nnode" values of each variable
+//   intec_WriteConnectivity() ...        "npe*nelem" node indices
+//   intec_Close()                        fails if anything is missing
+// Data can be handed over in pieces of any size, so a caller never has to
+// hold a transposed copy of its arrays.
+//
+
+//
+// The ASCII files are written by a parallel engine: items (rows of nodes,
+// elements) are formatted in blocks by several threads, each in to its own
+// buffer, and the buffers go to the file in order with large write() calls.
+// A row function formats item "i" at "p" and returns the end of its text,
+// using no more than the "maxrow" bytes given to intec_WriteAscii(). The
+// helpers produce exactly what printf() does for "%f" and "%ld", or the
+// shortest text that reads back to the same float.
+//
+
+typedef char* (*intecRowFn)( long i, char *p, void *user );
+
+#define INTEC_MAXFIXED 48        // longest "%f" of a float
+#define INTEC_MAXSHORT 16        // longest shortest round-trip float
+
+#define INTEC_FELINESEG  1
+#define INTEC_FETRIANGLE 2
+#define INTEC_FEQUAD     3
+
+struct inTec_s {
+   FILE *fp;
+   int nvar;            // number of variables
+   int npe;             // nodes per element
+   long nnode;
+   long nelem;
+   int ivar;            // variable being written
+   long nval;           // values of it written so far
+   long nconn;          // connectivity entries written so far
+   float *buf;          // staging for strided data
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int intec_Open( struct inTec_s *t, const char *filename,
+                const char *title, const char *zone, const char *vars,
+                int itype, long nnode, long nelem,
+                const double *vmin, const double *vmax );
+
+int intec_WriteBlock( struct inTec_s *t, const float *v, long n );
+
+int intec_WriteStrided( struct inTec_s *t, const void *p, long n,
+                        size_t stride );
+
+int intec_WriteConnectivity( struct inTec_s *t, const int32_t *c, long n );
+
+int intec_Close( struct inTec_s *t );
+
+void intec_Range( const void *p, long n, size_t stride,
+                  double *vmin, double *vmax );
+
+int intec_WriteAscii( int fd, long n, size_t maxrow,
+                      intecRowFn fn, void *user, int nthreads );
+
+int intec_WriteText( int fd, const char *s, size_t n );
+
+char* intec_FmtFixed( char *p, double v );
+
+char* intec_FmtShortest( char *p, float v );
+
+char* intec_FmtLong( char *p, long l );
+
+char* intec_FmtText( char *p, const char *s );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,18 +1,88 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-#include "inobj.h"
+#include "hdfy.h"
+#include "hdfy_batch.h"
+
+static void usage( const char *prog )
+{
+   fprintf( stderr, "Usage: %s [options] <file|directory> ... \n", prog );
+   fprintf( stderr, "   -j <n>      threads converting files (all cores) \n" );
+   fprintf( stderr, "   -o <dir>    directory of the .h5 files (next to "
+                    "the inputs) \n" );
+   fprintf( stderr, "   -l <list>   file with one path per line; \"-\" for "
+                    "standard input \n" );
+   fprintf( stderr, "   -z <level>  deflate level 0-9 \n" );
+   fprintf( stderr, "   -c <rows>   rows in a chunk \n" );
+   fprintf( stderr, "   -t          tune chunk and filters per array \n" );
+   fprintf( stderr, "   -s <weight> tuning weight of seconds per MB "
+                    "against size (10); implies -t \n" );
+   fprintf( stderr, "   -r <rows>   rows sampled when tuning an array "
+                    "(131072); implies -t \n" );
+   fprintf( stderr, "   -k          add unified (v,vt,vn) corners of OBJ "
+                    "faces \n" );
+   fprintf( stderr, "   -f          convert even unchanged inputs \n" );
+   fprintf( stderr, "   -v          report every file \n" );
+}
 
 int main( int argc, char *argv[] )
 {
-   fprintf( stdout, "Hello world \n" );
+   struct hdfyBatchOpts_s b;
+   struct hdfyOpts_s o;
+   char **paths,**lists;
+   int n,npath=0,nlist=0,ierr;
 
-   printf("================= Reading OBJ file =========================== \n" );
-   void *p=NULL;
-   p = readObjFile( "cube.obj" );
-   dumpTecplot( p, "tecplot.dat" );
-   clearObj( p );
+   hdfy_InitBatchOpts( &b );
+   hdfy_InitOpts( &o );
+   paths = (char **) malloc( (size_t) argc * sizeof(char *) );
+   lists = (char **) malloc( (size_t) argc * sizeof(char *) );
+   if( paths == NULL || lists == NULL ) return 1;
 
-   return 0;
-}
+   for(n=1;n<argc;++n) {
+      if( strcmp( argv[n], "-j" ) == 0 && n+1 < argc ) {
+         b.nthreads = atoi( argv[++n] );
+      } else if( strcmp( argv[n], "-o" ) == 0 && n+1 < argc ) {
+         b.outdir = argv[++n];
+      } else if( strcmp( argv[n], "-l" ) == 0 && n+1 < argc ) {
+         lists[ nlist++ ] = argv[++n];
+      } else if( strcmp( argv[n], "-z" ) == 0 && n+1 < argc ) {
+         o.ideflate = atoi( argv[++n] );
+      } else if( strcmp( argv[n], "-c" ) == 0 && n+1 < argc ) {
+         o.chunk = atol( argv[++n] );
+      } else if( strcmp( argv[n], "-t" ) == 0 ) {
+         o.itune = 1;
+      } else if( strcmp( argv[n], "-s" ) == 0 && n+1 < argc ) {
+         o.tune_speed = atof( argv[++n] );
+         o.itune = 1;
+      } else if( strcmp( argv[n], "-r" ) == 0 && n+1 < argc ) {
+         o.tune_rows = atol( argv[++n] );
+         o.itune = 1;
+      } else if( strcmp( argv[n], "-k" ) == 0 ) {
+         o.icorners = 1;
+      } else if( strcmp( argv[n], "-f" ) == 0 ) {
+         b.iforce = 1;
+      } else if( strcmp( argv[n], "-v" ) == 0 ) {
+         b.iverbose = 1;
+      } else if( argv[n][0] == '-' && argv[n][1] != '\0' ) {
+         usage( argv[0] );
+         free( paths );
+         free( lists );
+         return 1;
+      } else {
+         paths[ npath++ ] = argv[n];
+      }
+   }
+   if( npath + nlist == 0 || o.tune_rows < 1 || o.tune_speed < 0.0 ) {
+      usage( argv[0] );
+      free( paths );
+      free( lists );
+      return 1;
+   }
+
+   ierr = hdfy_Batch( npath, paths, nlist, lists, &b, &o );
 
+   free( paths );
+   free( lists );
+   return ierr;
+}
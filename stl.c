@@ -42,14 +42,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
+#include <errno.h>
 
 #include <unistd.h>
+#include <stdint.h>
+#include <pthread.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "stl.h"
+#include "infloat.h"
+#include "intec.h"
+#include "inhash.h"
 
 
 //
@@ -71,6 +82,8 @@ void inSTL_InitSTLfile( struct inSTL_s *sp )
 int inSTL_ProbeSTLfile( char *filename, int *itype )
 #define FUNC "inSTL_ProbeSTLfile"
 {
+   struct stat st;
+   unsigned int ntri;
    int ierr,handle;
    char data[2*80];
    int i;
@@ -89,6 +102,18 @@ int inSTL_ProbeSTLfile( char *filename, int *itype )
       return 2;
    }
 
+   // a binary file is known by its size, whatever its header says (and it
+   // should not say "solid")
+   if( fstat( handle, &st ) == 0 && pread( handle, &ntri, 4, 80 ) == 4 &&
+       (size_t) st.st_size == 84 + 50 * (size_t) ntri ) {
+      for(i=0;i<80 && data[i]!='\0' && data[i]!='\n';++i) data[80+i] = data[i];
+      data[80+i] = '\0';
+      fprintf( stdout, " i [%s]  File header: \"%s\" \n", FUNC, &(data[80]) );
+      *itype = 1;
+      close( handle );
+      return 0;
+   }
+
    // see if it is an STL file by checking the header
    if( strncmp(data, "solid ", 6 ) != 0 &&
        strncmp(data, " solid ",7 ) != 0 ) {
@@ -133,7 +158,10 @@ int inSTL_ReadBinarySTL( char *filename, struct inSTL_s *sp, size_t isize )
 #define FUNC "inSTL_ReadBinarySTL"
 {
    int ierr,handle;
-   unsigned int n;
+   unsigned int n,m;
+   size_t k;
+   ssize_t ir;
+   char *buf;
 
 
    handle = open( filename, O_RDONLY );
@@ -168,39 +196,35 @@ int inSTL_ReadBinarySTL( char *filename, struct inSTL_s *sp, size_t isize )
       return 2;
    }
 
-   for(n=0;n<sp->ntri;++n) {
-      ierr = (int) read( handle, &(sp->triangles[n]), isize );
-      if( ierr < (int) isize ) {
-         fprintf( stderr," e [%s]  Failed to read all triangles; (truncated?) \n",FUNC);
+   // records are read in blocks and spread out to the (padded) structures
+   buf = (char *) malloc( 8192 * isize );
+   if( buf == NULL ) {
+      fprintf( stderr," e [%s]  Could not allocate space for triangles\n",FUNC);
+      close( handle );
+      free( sp->triangles );
+      sp->triangles = NULL;
+      return 2;
+   }
+   for(n=0;n<sp->ntri;n+=m) {
+      m = ( sp->ntri - n < 8192 ? sp->ntri - n : 8192 );
+      for(k=0;k<m*isize;k+=(size_t) ir) {
+         ir = read( handle, buf + k, m*isize - k );
+         if( ir <= 0 ) break;
+      }
+      if( k < m*isize ) {
+         fprintf( stderr," e [%s]  Failed to read all triangles; "
+                  "(truncated?) \n", FUNC );
          close( handle );
+         free( buf );
          free( sp->triangles );
          sp->triangles = NULL;
          return 3;
       }
-/*
-printf(" facet normal %f %f %F \n",
-sp->triangles[n].normal[0],
-sp->triangles[n].normal[1],
-sp->triangles[n].normal[2]
-);
-printf("     vertex1  %f %f %F \n",
-sp->triangles[n].vertex1[0],
-sp->triangles[n].vertex1[1],
-sp->triangles[n].vertex1[2]
-);
-printf("     vertex1  %f %f %F \n",
-sp->triangles[n].vertex2[0],
-sp->triangles[n].vertex2[1],
-sp->triangles[n].vertex2[2]
-);
-printf("     vertex1  %f %f %F \n\n",
-sp->triangles[n].vertex3[0],
-sp->triangles[n].vertex3[1],
-sp->triangles[n].vertex3[2]
-);
-*/
-
+      for(k=0;k<m;++k) {
+         memcpy( &( sp->triangles[n+k] ), buf + k*isize, isize );
+      }
    }
+   free( buf );
 
    close( handle );
 
@@ -210,241 +234,1835 @@ sp->triangles[n].vertex3[2]
 
 
 //
-// Function to read STL ASCII data
+// Function to read slice "islice" of "nslice" equal slices of the triangles
+// of a binary STL file; the file is positioned at the first record of the
+// slice and the records are read in one go
 //
 
-int inSTL_ReadAsciiSTL( char *filename, struct inSTL_s *sp )
-#define FUNC "inSTL_ReadAsciiSTL"
+int inSTL_ReadBinarySTLSlice( char *filename, struct inSTL_s *sp, size_t isize,
+                              int islice, int nslice )
+#define FUNC "inSTL_ReadBinarySTLSlice"
 {
-   FILE *fp;
-   unsigned int n;
-   char data[100];
-   char name[80];
-   int ic,iend,itri=0;
+   unsigned int ntot,n,n1,n2;
+   char *buf;
+   size_t nb,k;
+   ssize_t ir;
+   int handle;
+
 
+   if( islice < 0 || nslice < 1 || islice >= nslice ) return 1;
 
-   fp = fopen( filename,"r" );
-   if( fp == NULL ) {
+   handle = open( filename, O_RDONLY );
+   if( handle == -1 ) {
       fprintf( stderr," e [%s]  Failed to open file \"%s\" for reading\n",
                FUNC,filename);
       return 1;
    }
 
+   if( read( handle, sp->header, 80 ) < 80 ||
+       read( handle, &ntot, sizeof(unsigned int) ) <
+                                              (ssize_t) sizeof(unsigned int) ) {
+      fprintf( stderr," e [%s]  Could not read header of file\n", FUNC );
+      close( handle );
+      return 2;
+   }
+
+   n1 = (unsigned int) ( ( (size_t) ntot * (size_t) islice ) /
+                         (size_t) nslice );
+   n2 = (unsigned int) ( ( (size_t) ntot * (size_t) ( islice + 1 ) ) /
+                         (size_t) nslice );
+   sp->ntri = n2 - n1;
+   sp->triangles = NULL;
+   if( sp->ntri == 0 ) {
+      close( handle );
+      return 0;
+   }
 
-   fgets( data, 100, fp );
-   ic = sscanf( data, "solid %s", name );
-   if( ic != 1 ) {
-      fprintf( stderr, " e [%s]  Could not find a valid STL header\n", FUNC );
-      fclose( fp );
+   nb = ( (size_t) sp->ntri ) * isize;
+   buf = (char *) malloc( nb );
+   sp->triangles = (struct inSTLtri_s *)
+             malloc( ((size_t) sp->ntri) * sizeof(struct inSTLtri_s) );
+   if( buf == NULL || sp->triangles == NULL ) {
+      fprintf( stderr," e [%s]  Could not allocate space for triangles\n",FUNC);
+      close( handle );
+      if( buf != NULL ) free( buf );
+      if( sp->triangles != NULL ) free( sp->triangles );
+      sp->triangles = NULL;
       return 2;
    }
-   fprintf( stderr," i [%s]  Name in file: \"%s\"\n", FUNC, name );
 
+   if( lseek( handle, (off_t) ( 84 + ( (size_t) n1 ) * isize ),
+              SEEK_SET ) < 0 ) {
+      k = 0;
+   } else {
+      for(k=0;k<nb;k+=(size_t) ir) {
+         ir = read( handle, buf + k, nb - k );
+         if( ir <= 0 ) break;
+      }
+   }
+   close( handle );
+   if( k < nb ) {
+      fprintf( stderr," e [%s]  Failed to read all triangles; (truncated?) \n",
+               FUNC );
+      free( buf );
+      free( sp->triangles );
+      sp->triangles = NULL;
+      return 3;
+   }
 
-   n = 0;
-   iend = 0;
-   while( iend == 0 ) {
-      if( !feof( fp ) ) {
-         fgets( data, 100, fp );
-#ifdef _DEBUG_
-         fprintf( stdout, " Read: %s", data );
-#endif
-         if( strstr( data, "endsolid" ) != NULL ) {
-#ifdef _DEBUG_
-            fprintf( stderr," i [%s]  Found \"endsolid\" in file\n", FUNC );
+   for(n=0;n<sp->ntri;++n) {
+      memcpy( &( sp->triangles[n] ), buf + ( (size_t) n ) * isize, isize );
+   }
+   free( buf );
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Decoding of binary records in to separate arrays. A record is 50 bytes:
+// four float triplets (normal and vertices) and a 16-bit attribute. With
+// SSE2 every triplet is moved with one unaligned 16-byte load and store; the
+// store spills one float in to the next triplet of the same array, which the
+// next record overwrites, so the last record of a range is moved without it
+// (and without reading past the mapped file).
+//
+
+struct inSTLdecode_s {
+   const unsigned char *rec;   // first record of the file
+   struct inSTLsoa_s *sp;
+   unsigned int n0, n1;
+};
+
+static void inSTL_DecodeOne( const unsigned char *r, struct inSTLsoa_s *sp,
+                             size_t i )
+{
+   memcpy( &( sp->normals[3*i] ), r, 12 );
+   memcpy( &( sp->vertex1[3*i] ), r + 12, 12 );
+   memcpy( &( sp->vertex2[3*i] ), r + 24, 12 );
+   memcpy( &( sp->vertex3[3*i] ), r + 36, 12 );
+   memcpy( &( sp->attributes[i] ), r + 48, 2 );
+}
+
+static void* inSTL_DecodeRange( void *arg )
+{
+   const struct inSTLdecode_s *d = (const struct inSTLdecode_s *) arg;
+   struct inSTLsoa_s *sp = d->sp;
+   const unsigned char *r;
+   size_t i;
+
+   if( d->n1 <= d->n0 ) return NULL;
+   for(i=d->n0;i<(size_t) d->n1-1;++i) {
+      r = d->rec + 50*i;
+#ifdef __SSE2__
+      _mm_storeu_si128( (__m128i *) &( sp->normals[3*i] ),
+                        _mm_loadu_si128( (const __m128i *) r ) );
+      _mm_storeu_si128( (__m128i *) &( sp->vertex1[3*i] ),
+                        _mm_loadu_si128( (const __m128i *) ( r + 12 ) ) );
+      _mm_storeu_si128( (__m128i *) &( sp->vertex2[3*i] ),
+                        _mm_loadu_si128( (const __m128i *) ( r + 24 ) ) );
+      _mm_storeu_si128( (__m128i *) &( sp->vertex3[3*i] ),
+                        _mm_loadu_si128( (const __m128i *) ( r + 36 ) ) );
+      memcpy( &( sp->attributes[i] ), r + 48, 2 );
+#else
+      inSTL_DecodeOne( r, sp, i );
 #endif
-            iend = 1;
-         }
+   }
+   inSTL_DecodeOne( d->rec + 50*i, sp, i );
 
-         if( strstr( data, "facet normal" ) != NULL ) {
-            itri = 6;
-         }
+   return NULL;
+}
 
-         if( strstr( data, "outer loop" ) != NULL ) {
-            itri = itri - 1;
-         }
+static void* inSTL_AlignedAlloc( size_t n )
+{
+   void *p = NULL;
 
-         if( strstr( data, "vertex" ) != NULL ) {
-            itri = itri - 1;
-         }
+   if( posix_memalign( &p, 64, ( n > 0 ? n : 1 ) ) != 0 ) return NULL;
+   return p;
+}
 
-         if( strstr( data, "endloop" ) != NULL ) {
-            itri = itri - 1;
-         }
+void inSTL_FreeSTLsoa( struct inSTLsoa_s *sp )
+{
+   if( sp->normals != NULL ) free( sp->normals );
+   if( sp->vertex1 != NULL ) free( sp->vertex1 );
+   if( sp->vertex2 != NULL ) free( sp->vertex2 );
+   if( sp->vertex3 != NULL ) free( sp->vertex3 );
+   if( sp->attributes != NULL ) free( sp->attributes );
+   sp->normals = sp->vertex1 = sp->vertex2 = sp->vertex3 = NULL;
+   sp->attributes = NULL;
+   sp->ntri = 0;
+}
 
-         if( strstr( data, "endfacet" ) != NULL ) {
-            itri = itri - 1;
-            n = n + 1;
-         }
 
-      } else {
-         iend = -1;
+//
+// Function to read a binary STL file in to separate arrays; the file is
+// mapped, its size is checked against the count of triangles before any
+// decoding, and ranges of records are decoded by "nthreads" threads (zero
+// for all cores)
+//
+
+int inSTL_ReadBinarySTLSoA( char *filename, struct inSTLsoa_s *sp,
+                            int nthreads )
+#define FUNC "inSTL_ReadBinarySTLSoA"
+{
+   struct inSTLdecode_s d[64];
+   pthread_t th[64];
+   struct stat st;
+   const unsigned char *map;
+   size_t need,nf;
+   long nc;
+   int handle,it,nrun=0;
+
+
+   memset( sp, 0, sizeof(struct inSTLsoa_s) );
+
+   handle = open( filename, O_RDONLY );
+   if( handle == -1 ) {
+      fprintf( stderr," e [%s]  Failed to open file \"%s\" for reading\n",
+               FUNC,filename);
+      return 1;
+   }
+   if( fstat( handle, &st ) != 0 || st.st_size < 84 ) {
+      fprintf( stderr," e [%s]  Could not read header of file\n", FUNC );
+      close( handle );
+      return 2;
+   }
+   map = (const unsigned char *) mmap( NULL, (size_t) st.st_size, PROT_READ,
+                                       MAP_PRIVATE, handle, 0 );
+   close( handle );
+   if( map == (const unsigned char *) MAP_FAILED ) {
+      fprintf( stderr," e [%s]  Could not map file \"%s\"\n", FUNC, filename );
+      return 2;
+   }
+   nf = (size_t) st.st_size;
+
+   memcpy( sp->header, map, 80 );
+   memcpy( &( sp->ntri ), map + 80, 4 );
+   need = 84 + 50 * (size_t) sp->ntri;
+   if( nf < need ) {
+      fprintf( stderr, " e [%s]  File has %ld bytes for %u triangles, "
+               "which need %ld (truncated?) \n", FUNC, (long) nf, sp->ntri,
+               (long) need );
+      munmap( (void *) map, nf );
+      sp->ntri = 0;
+      return 3;
+   } else if( nf > need ) {
+      fprintf( stderr, " i [%s]  Ignoring %ld bytes after the triangles \n",
+               FUNC, (long) ( nf - need ) );
+   }
+   fprintf( stderr, " i [%s]  File has %d triangles \n", FUNC, sp->ntri );
+   madvise( (void *) map, nf, MADV_SEQUENTIAL );
+
+   sp->normals = (float *) inSTL_AlignedAlloc( 12 * (size_t) sp->ntri );
+   sp->vertex1 = (float *) inSTL_AlignedAlloc( 12 * (size_t) sp->ntri );
+   sp->vertex2 = (float *) inSTL_AlignedAlloc( 12 * (size_t) sp->ntri );
+   sp->vertex3 = (float *) inSTL_AlignedAlloc( 12 * (size_t) sp->ntri );
+   sp->attributes = (unsigned short *)
+                    inSTL_AlignedAlloc( 2 * (size_t) sp->ntri );
+   if( sp->normals == NULL || sp->vertex1 == NULL || sp->vertex2 == NULL ||
+       sp->vertex3 == NULL || sp->attributes == NULL ) {
+      fprintf( stderr," e [%s]  Could not allocate space for triangles\n",FUNC);
+      munmap( (void *) map, nf );
+      inSTL_FreeSTLsoa( sp );
+      return 2;
+   }
+
+   if( nthreads <= 0 ) {
+      nc = sysconf( _SC_NPROCESSORS_ONLN );
+      nthreads = ( nc > 0 ? (int) nc : 1 );
+   }
+   if( nthreads > 64 ) nthreads = 64;
+   if( (size_t) nthreads > sp->ntri / 65536 + 1 ) {
+      nthreads = (int) ( sp->ntri / 65536 + 1 );
+   }
+   for(it=0;it<nthreads;++it) {
+      d[it].rec = map + 84;
+      d[it].sp = sp;
+      d[it].n0 = (unsigned int) ( (size_t) sp->ntri * (size_t) it /
+                                  (size_t) nthreads );
+      d[it].n1 = (unsigned int) ( (size_t) sp->ntri * (size_t) ( it + 1 ) /
+                                  (size_t) nthreads );
+   }
+   for(it=1;it<nthreads;++it) {
+      if( pthread_create( &( th[it] ), NULL, inSTL_DecodeRange, &( d[it] ) ) ) {
+         break;
+      }
+      ++nrun;
+   }
+   inSTL_DecodeRange( &( d[0] ) );
+   for(it=nrun+1;it<nthreads;++it) inSTL_DecodeRange( &( d[it] ) );
+   for(it=1;it<=nrun;++it) pthread_join( th[it], NULL );
+
+   munmap( (void *) map, nf );
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// ASCII parsing. The text is walked once as words separated by any white
+// space; a state machine follows the keywords
+//    solid <name> { facet normal x y z  outer loop  vertex x y z (x3)
+//                   endloop  endfacet } endsolid [<name>]
+// for any number of solids, which all go to the same soup, and the numbers
+// are parsed in place. Triangles are appended to an array that grows by
+// doubling from a guess made from the size of the text.
+//
+
+enum inSTLascii {
+   STLA_TOP,           // between solids
+   STLA_SOLID,         // in a solid, between facets
+   STLA_NORMAL,        // after "facet"
+   STLA_OUTER,         // after the normal
+   STLA_LOOP,          // after "outer"
+   STLA_VERTEX,        // in the loop; "vertex" or "endloop"
+   STLA_ENDFACET       // after "endloop"
+};
+
+struct inSTLgrow_s {
+   struct inSTLtri_s *t;
+   size_t n, cap;
+};
+
+static int inSTL_GrowTri( struct inSTLgrow_s *g )
+{
+   struct inSTLtri_s *t;
+   size_t nc;
+
+   if( g->n < g->cap ) return 0;
+   nc = ( g->cap > 0 ? 2*g->cap : 1024 );
+   t = (struct inSTLtri_s *) realloc( g->t, nc * sizeof(struct inSTLtri_s) );
+   if( t == NULL ) return 1;
+   g->t = t;
+   g->cap = nc;
+
+   return 0;
+}
+
+static int inSTL_IsSpace( char c )
+{
+   return ( c == ' ' || c == '\n' || c == '\r' || c == '\t' ||
+            c == '\f' || c == '\v' );
+}
+
+// the next word at or after "p"; NULL at the end of the text
+static const char* inSTL_Word( const char *p, const char *e, const char **we )
+{
+   const char *q;
+
+   while( p < e && inSTL_IsSpace( *p ) ) ++p;
+   if( p == e ) return NULL;
+   for(q=p;q<e && !inSTL_IsSpace( *q );++q) {}
+   *we = q;
+   return p;
+}
+
+static int inSTL_IsWord( const char *w, const char *we, const char *key )
+{
+   const size_t n = strlen( key );
+
+   return ( (size_t) ( we - w ) == n && memcmp( w, key, n ) == 0 );
+}
+
+static const char* inSTL_Words3( const char *p, const char *e, float *v )
+{
+   const char *w,*we;
+   int k;
+
+   for(k=0;k<3;++k) {
+      w = inSTL_Word( p, e, &we );
+      if( w == NULL || inflt_ParseFloat( w, we, &( v[k] ) ) != we ) {
+         return NULL;
       }
+      p = we;
    }
+   return p;
+}
 
-   if( iend == -1 && itri == 0 ) {
-       fprintf( stderr, " e [%s]  File seems to be truncated\n", FUNC );
-       fclose( fp );
-       return 3;
+// the rest of the line after "p", without surrounding blanks
+static const char* inSTL_RestOfLine( const char *p, const char *e,
+                                     char *name, size_t nname )
+{
+   const char *q,*r;
+   size_t n;
+
+   while( p < e && ( *p == ' ' || *p == '\t' ) ) ++p;
+   for(q=p;q<e && *q != '\n' && *q != '\r';++q) {}
+   for(r=q;r>p && ( r[-1] == ' ' || r[-1] == '\t' );--r) {}
+   if( name != NULL && nname > 0 ) {
+      n = (size_t) ( r - p );
+      if( n > nname - 1 ) n = nname - 1;
+      memcpy( name, p, n );
+      name[n] = '\0';
    }
-   if( iend == 1 && itri == 0 ) {
-       fprintf( stderr, " i [%s]  Counted %i triangles \n", FUNC, n );
+   return q;
+}
+
+//
+// Function to parse the text [s,e) starting in state "*istate" and append
+// its facets; the state at the end is returned in "*istate", and "*perr"
+// points at the offending word of an error. The names of the solids are
+// counted in "*nsolid" and the first one is kept in "name".
+//
+
+static int inSTL_ParseAscii( const char *s, const char *e, int *istate,
+                             struct inSTLgrow_s *g, int *nsolid,
+                             char *name, size_t nname, const char **perr )
+{
+   struct inSTLtri_s *tp = NULL;
+   const char *p = s, *w, *we;
+   int st = *istate, nv = 0;
+
+
+   if( st != STLA_TOP && st != STLA_SOLID ) return 1;
+   while( ( w = inSTL_Word( p, e, &we ) ) != NULL ) {
+      *perr = w;
+      p = we;
+      switch( st ) {
+       case STLA_TOP:
+         if( !inSTL_IsWord( w, we, "solid" ) ) return 2;
+         p = inSTL_RestOfLine( p, e, ( *nsolid == 0 ? name : NULL ), nname );
+         ++( *nsolid );
+         st = STLA_SOLID;
+         break;
+       case STLA_SOLID:
+         if( inSTL_IsWord( w, we, "endsolid" ) ) {
+            p = inSTL_RestOfLine( p, e, NULL, 0 );
+            st = STLA_TOP;
+         } else if( inSTL_IsWord( w, we, "facet" ) ) {
+            if( inSTL_GrowTri( g ) ) return 9;
+            tp = &( g->t[ g->n ] );
+            tp->iatrib = 0;
+            st = STLA_NORMAL;
+         } else {
+            return 2;
+         }
+         break;
+       case STLA_NORMAL:
+         if( !inSTL_IsWord( w, we, "normal" ) ) return 2;
+         p = inSTL_Words3( p, e, tp->normal );
+         if( p == NULL ) return 3;
+         st = STLA_OUTER;
+         break;
+       case STLA_OUTER:
+         if( !inSTL_IsWord( w, we, "outer" ) ) return 2;
+         st = STLA_LOOP;
+         break;
+       case STLA_LOOP:
+         if( !inSTL_IsWord( w, we, "loop" ) ) return 2;
+         nv = 0;
+         st = STLA_VERTEX;
+         break;
+       case STLA_VERTEX:
+         if( inSTL_IsWord( w, we, "vertex" ) ) {
+            if( nv == 3 ) return 4;
+            p = inSTL_Words3( p, e, ( nv == 0 ? tp->vertex1 :
+                                    ( nv == 1 ? tp->vertex2 : tp->vertex3 ) ) );
+            if( p == NULL ) return 3;
+            ++nv;
+         } else if( inSTL_IsWord( w, we, "endloop" ) ) {
+            if( nv != 3 ) return 4;
+            st = STLA_ENDFACET;
+         } else {
+            return 2;
+         }
+         break;
+       case STLA_ENDFACET:
+         if( !inSTL_IsWord( w, we, "endfacet" ) ) return 2;
+         ++( g->n );
+         st = STLA_SOLID;
+         break;
+      }
    }
 
-   // creating storage for all triangles
-   sp->ntri = n;
-   sp->triangles = (struct inSTLtri_s *)
-             malloc( ((size_t) sp->ntri) * sizeof(struct inSTLtri_s) );
-   if( sp->triangles == NULL ) {
-      fprintf( stderr, " e [%s]  Could not allocate space for triangles \n", FUNC );
-      fclose( fp );
-      return 2;
+   *perr = e;
+   *istate = st;
+   return 0;
+}
+
+// the line of a position in the text, for messages
+static long inSTL_LineOf( const char *s, const char *p )
+{
+   long n = 1;
+
+   for(;s<p;++s) if( *s == '\n' ) ++n;
+   return n;
+}
+
+
+//
+// Parallel parsing: the text is cut in to pieces at "facet" words, every
+// piece is parsed by a thread in to its own array starting inside a solid,
+// and the arrays are joined in order. Pieces that do not end inside a solid,
+// or any error, send the whole text to the serial parser, so the result and
+// the messages are always those of a single pass.
+//
+
+struct inSTLpiece_s {
+   const char *s, *e;
+   int istate, ierr, nsolid;
+   struct inSTLgrow_s g;
+   char name[80];
+   const char *perr;
+   struct inSTLtri_s *dst;   // where the piece goes in the joined array
+};
+
+static void* inSTL_ParsePiece( void *arg )
+{
+   struct inSTLpiece_s *pc = (struct inSTLpiece_s *) arg;
+
+   pc->g.cap = (size_t) ( pc->e - pc->s ) / 256 + 16;
+   pc->g.t = (struct inSTLtri_s *)
+             malloc( pc->g.cap * sizeof(struct inSTLtri_s) );
+   if( pc->g.t == NULL ) {
+      pc->g.cap = 0;
+      pc->ierr = 9;
+      return NULL;
    }
+   pc->name[0] = '\0';
+   pc->ierr = inSTL_ParseAscii( pc->s, pc->e, &( pc->istate ), &( pc->g ),
+                                &( pc->nsolid ), pc->name, sizeof(pc->name),
+                                &( pc->perr ) );
+   return NULL;
+}
 
-   rewind( fp );
+static void* inSTL_CopyPiece( void *arg )
+{
+   struct inSTLpiece_s *pc = (struct inSTLpiece_s *) arg;
 
-   fgets( data, 100, fp );
-   for(n=0;n<sp->ntri;++n) {
-      struct inSTLtri_s *tp = &(sp->triangles[n]);
+   if( pc->g.n > 0 ) {
+      memcpy( pc->dst, pc->g.t, pc->g.n * sizeof(struct inSTLtri_s) );
+   }
+   return NULL;
+}
+
+static void inSTL_RunPieces( struct inSTLpiece_s *pc, int n,
+                             void* (*fn)( void * ) )
+{
+   pthread_t th[64];
+   int it,nrun=0;
+
+   for(it=1;it<n;++it) {
+      if( pthread_create( &( th[it] ), NULL, fn, &( pc[it] ) ) ) break;
+      ++nrun;
+   }
+   fn( &( pc[0] ) );
+   for(it=nrun+1;it<n;++it) fn( &( pc[it] ) );
+   for(it=1;it<=nrun;++it) pthread_join( th[it], NULL );
+}
 
-      fgets( data, 100, fp );
-      sscanf(data, " facet normal %f %f %f",
-        &(tp->normal[0]),
-        &(tp->normal[1]),
-        &(tp->normal[2]) );
+// the start of the first "facet" word at or after "p"; "e" if there is none
+static const char* inSTL_NextFacet( const char *p, const char *s,
+                                    const char *e )
+{
+   const char *q;
+
+   while( p < e ) {
+      q = (const char *) memchr( p, 'f', (size_t) ( e - p ) );
+      if( q == NULL || e - q < 6 ) return e;
+      if( memcmp( q, "facet", 5 ) == 0 && inSTL_IsSpace( q[5] ) &&
+          ( q == s || inSTL_IsSpace( q[-1] ) ) ) return q;
+      p = q + 1;
+   }
+   return e;
+}
 
-      fgets( data, 100, fp );
+//
+// Function to parse the text in "npc" pieces; returns non-zero when the
+// serial parser should be used instead
+//
 
-      fgets( data, 100, fp );
-      sscanf( data, " vertex %f %f %f",
-        &(tp->vertex1[0]),
-        &(tp->vertex1[1]),
-        &(tp->vertex1[2]));
+static int inSTL_ParsePieces( const char *text, size_t nf, int npc,
+                              struct inSTLgrow_s *g, int *istate,
+                              int *nsolid, char *name, size_t nname )
+{
+   struct inSTLpiece_s pc[64];
+   size_t ntot=0;
+   int k,ierr=0;
+
+   memset( pc, 0, sizeof(pc) );
+   pc[0].s = text;
+   for(k=1;k<npc;++k) {
+      const char *c = text + nf * (size_t) k / (size_t) npc;
+      if( c < pc[k-1].s ) c = pc[k-1].s;
+      c = inSTL_NextFacet( c, text, text + nf );
+      pc[k-1].e = c;
+      pc[k].s = c;
+   }
+   pc[npc-1].e = text + nf;
+   for(k=0;k<npc;++k) pc[k].istate = ( k == 0 ? STLA_TOP : STLA_SOLID );
 
-      fgets( data, 100, fp );
-      sscanf( data, " vertex %f %f %f",
-        &(tp->vertex2[0]),
-        &(tp->vertex2[1]),
-        &(tp->vertex2[2]));
+   inSTL_RunPieces( pc, npc, inSTL_ParsePiece );
 
-      fgets( data, 100, fp );
-      sscanf( data, " vertex %f %f %f",
-        &(tp->vertex3[0]),
-        &(tp->vertex3[1]),
-        &(tp->vertex3[2]));
+   for(k=0;k<npc;++k) {
+      if( pc[k].ierr != 0 ) ierr = 1;
+      if( k < npc-1 && pc[k].istate != STLA_SOLID ) ierr = 1;
+      ntot += pc[k].g.n;
+   }
+   if( pc[0].nsolid == 0 ) ierr = 1;
 
-      fgets( data, 100, fp );
-      fgets( data, 100, fp );
+   if( ierr == 0 ) {
+      g->t = (struct inSTLtri_s *)
+             malloc( ( ntot > 0 ? ntot : 1 ) * sizeof(struct inSTLtri_s) );
+      if( g->t == NULL ) ierr = 1;
    }
+   if( ierr == 0 ) {
+      g->n = g->cap = ntot;
+      for(ntot=0,k=0;k<npc;++k) {
+         pc[k].dst = g->t + ntot;
+         ntot += pc[k].g.n;
+      }
+      inSTL_RunPieces( pc, npc, inSTL_CopyPiece );
 
-   fclose( fp );
+      *istate = pc[npc-1].istate;
+      *nsolid = 0;
+      for(k=0;k<npc;++k) *nsolid += pc[k].nsolid;
+      strncpy( name, pc[0].name, nname - 1 );
+      name[nname-1] = '\0';
+   }
 
-   return 0;
+   for(k=0;k<npc;++k) if( pc[k].g.t != NULL ) free( pc[k].g.t );
+   return ierr;
 }
-#undef FUNC
 
 
 //
-// Function to dump an STL file
+// Functions to map the text of an open file of "nf" bytes, or to read it in
+// one go in to "*buf" if it cannot be mapped; NULL when there is no text
 //
 
-int inSTL_DumpAsciiSTL( char *filename, struct inSTL_s *sp )
-#define FUNC "inSTL_DumpAsciiSTL"
+static const char* inSTL_MapText( int handle, size_t nf, char **buf )
 {
-   FILE *fp;
-   unsigned int n;
+   const char *text;
+   ssize_t ir;
+   size_t k;
 
+   *buf = NULL;
+   if( nf == 0 ) return NULL;
 
-   fp = fopen( filename, "w" );
-   if( fp == NULL ) {
-      fprintf( stderr, " e [%s]  Could not write file: \"%s\"\n",FUNC,filename);
+   text = (const char *) mmap( NULL, nf, PROT_READ, MAP_PRIVATE, handle, 0 );
+   if( text != (const char *) MAP_FAILED ) {
+      madvise( (void *) text, nf, MADV_SEQUENTIAL );
+      return text;
+   }
+
+   *buf = (char *) malloc( nf );
+   if( *buf == NULL ) return NULL;
+   for(k=0;k<nf;k+=(size_t) ir) {
+      ir = read( handle, *buf + k, nf - k );
+      if( ir <= 0 ) break;
+   }
+   if( k < nf ) {
+      free( *buf );
+      *buf = NULL;
+      return NULL;
+   }
+   return *buf;
+}
+
+static void inSTL_UnmapText( const char *text, size_t nf, char *buf )
+{
+   if( buf != NULL ) {
+      free( buf );
+   } else if( text != NULL ) {
+      munmap( (void *) text, nf );
+   }
+}
+
+
+//
+// Function to read STL ASCII data; the file is mapped (or read in one go if
+// it cannot be) and parsed in a single pass
+//
+
+int inSTL_ReadAsciiSTL( char *filename, struct inSTL_s *sp )
+{
+   return inSTL_ReadAsciiSTLParallel( filename, sp, 1 );
+}
+
+//
+// Function to read STL ASCII data with "nthreads" threads (zero for all
+// cores), each parsing a piece of at least a megabyte
+//
+
+int inSTL_ReadAsciiSTLParallel( char *filename, struct inSTL_s *sp,
+                                int nthreads )
+#define FUNC "inSTL_ReadAsciiSTL"
+{
+   const char *msg[] = { "", "", "Unexpected word", "Bad number",
+                         "Facet is not a triangle" };
+   struct inSTLgrow_s g;
+   struct stat st;
+   const char *text,*perr;
+   char *buf = NULL;
+   char name[80];
+   size_t nf;
+   long nc;
+   int handle,ierr,istate=STLA_TOP,nsolid=0;
+
+
+   handle = open( filename, O_RDONLY );
+   if( handle == -1 || fstat( handle, &st ) != 0 ) {
+      fprintf( stderr," e [%s]  Failed to open file \"%s\" for reading\n",
+               FUNC,filename);
+      if( handle != -1 ) close( handle );
       return 1;
-   } else {
-      fprintf( stderr, " i [%s]  Writing file: \"%s\"\n", FUNC, filename );
+   }
+   nf = (size_t) st.st_size;
+   text = inSTL_MapText( handle, nf, &buf );
+   close( handle );
+   if( text == NULL ) {
+      fprintf( stderr, " e [%s]  Could not find a valid STL header\n", FUNC );
+      return 2;
    }
 
-   fprintf( fp, "solid ASCII_STL_by_IN (%d triangles) \n",sp->ntri );
-   for(n=0;n<sp->ntri;++n) {
-      fprintf( fp, "  facet normal   %f  %f  %f \n",
-           sp->triangles[n].normal[0],
-           sp->triangles[n].normal[1],
-           sp->triangles[n].normal[2] );
-      fprintf( fp, "   outer loop\n");
-      fprintf( fp, "    vertex  %f  %f  %f\n",
-           sp->triangles[n].vertex1[0],
-           sp->triangles[n].vertex1[1],
-           sp->triangles[n].vertex1[2]);
-      fprintf( fp, "    vertex  %f  %f  %f\n",
-           sp->triangles[n].vertex2[0],
-           sp->triangles[n].vertex2[1],
-           sp->triangles[n].vertex2[2]);
-      fprintf( fp, "    vertex  %f  %f  %f\n",
-           sp->triangles[n].vertex3[0],
-           sp->triangles[n].vertex3[1],
-           sp->triangles[n].vertex3[2]);
-      fprintf( fp, "   endloop\n");
-      fprintf( fp, "  endfacet\n");
-   }
-
-   fprintf( fp, "endsolid ASCII_STL_by_IN \n" );
-
-   fclose( fp );
+   if( nthreads <= 0 ) {
+      nc = sysconf( _SC_NPROCESSORS_ONLN );
+      nthreads = ( nc > 0 ? (int) nc : 1 );
+   }
+   if( nthreads > 64 ) nthreads = 64;
+   if( (size_t) nthreads > nf / ( 1 << 20 ) + 1 ) {
+      nthreads = (int) ( nf / ( 1 << 20 ) + 1 );
+   }
+
+   memset( &g, 0, sizeof(g) );
+   name[0] = '\0';
+   ierr = 1;
+   if( nthreads > 1 ) {
+      ierr = inSTL_ParsePieces( text, nf, nthreads, &g, &istate, &nsolid,
+                                name, sizeof(name) );
+   }
+   if( ierr != 0 ) {
+      // a guess of the facets at about 250 bytes each
+      g.cap = nf / 256 + 16;
+      g.t = (struct inSTLtri_s *) malloc( g.cap * sizeof(struct inSTLtri_s) );
+      ierr = ( g.t == NULL ? 9 :
+               inSTL_ParseAscii( text, text + nf, &istate, &g, &nsolid,
+                                 name, sizeof(name), &perr ) );
+   }
+
+   if( ierr == 0 && nsolid == 0 ) {
+      fprintf( stderr, " e [%s]  Could not find a valid STL header\n", FUNC );
+      ierr = 2;
+   } else if( ierr == 9 ) {
+      fprintf( stderr, " e [%s]  Could not allocate space for triangles \n",
+               FUNC );
+   } else if( ierr != 0 ) {
+      fprintf( stderr, " e [%s]  %s at line %ld of \"%s\"\n", FUNC,
+               msg[ierr], inSTL_LineOf( text, perr ), filename );
+      ierr = 4;
+   } else if( istate != STLA_TOP && istate != STLA_SOLID ) {
+      fprintf( stderr, " e [%s]  File seems to be truncated\n", FUNC );
+      ierr = 3;
+   } else if( istate == STLA_SOLID ) {
+      fprintf( stderr, " i [%s]  No \"endsolid\" at the end \n", FUNC );
+   }
+
+   inSTL_UnmapText( text, nf, buf );
+   if( ierr != 0 ) {
+      if( g.t != NULL ) free( g.t );
+      return ierr;
+   }
+
+   fprintf( stderr," i [%s]  Name in file: \"%s\"\n", FUNC, name );
+   if( nsolid > 1 ) {
+      fprintf( stderr, " i [%s]  Joined %d solids \n", FUNC, nsolid );
+   }
+   fprintf( stderr, " i [%s]  Counted %u triangles \n", FUNC,
+            (unsigned int) g.n );
+
+   sp->ntri = (unsigned int) g.n;
+   sp->triangles = g.t;
+   if( g.n > 0 && g.n < g.cap ) {
+      struct inSTLtri_s *t = (struct inSTLtri_s *)
+                 realloc( g.t, g.n * sizeof(struct inSTLtri_s) );
+      if( t != NULL ) sp->triangles = t;
+   }
 
    return 0;
 }
 #undef FUNC
 
-/*
- * Function to dump a TecPlot file
- */
 
-int inSTL_DumpAsciiSTLTecplot(char *filename, struct inSTL_s *sp)
-#define FUNC "inSTL_DumpAsciiSTLTecplot"
+//
+// Function to read slice "islice" of "nslice" slices of the text of an STL
+// ASCII file. The text is mapped and cut in equal parts that are moved to
+// the next "facet" word, as for the parallel parser, and only the part of
+// the slice is parsed; a slice other than the first one starts inside a
+// solid. A slice that cannot be parsed on its own returns 5 without a
+// message, and the whole file should then be read to find the error.
+//
+
+int inSTL_ReadAsciiSTLSlice( char *filename, struct inSTL_s *sp,
+                             int islice, int nslice )
+#define FUNC "inSTL_ReadAsciiSTLSlice"
 {
-   FILE *fp;
-   unsigned int n;
+   struct inSTLgrow_s g;
+   struct stat st;
+   const char *text,*s,*e,*perr;
+   char *buf = NULL;
+   size_t nf;
+   int handle,ierr,istate,nsolid=0;
 
 
-   fp = fopen( filename, "w" );
-   if( fp == NULL ) {
-      fprintf( stderr, " e [%s]  Could not write file: \"%s\"\n",FUNC,filename);
+   if( islice < 0 || nslice < 1 || islice >= nslice ) return 1;
+
+   handle = open( filename, O_RDONLY );
+   if( handle == -1 || fstat( handle, &st ) != 0 ) {
+      fprintf( stderr," e [%s]  Failed to open file \"%s\" for reading\n",
+               FUNC,filename);
+      if( handle != -1 ) close( handle );
       return 1;
-   } else {
-      fprintf( stderr, " i [%s]  Writing file: \"%s\"\n", FUNC, filename );
    }
+   nf = (size_t) st.st_size;
+   text = inSTL_MapText( handle, nf, &buf );
+   close( handle );
+   if( text == NULL ) return 5;
 
-   fprintf( fp, "variables = x y z nx ny nz \n" );
-   fprintf( fp, "ZONE NODES=%d, ELEMENTS=%d, ",sp->ntri*3, sp->ntri );
-   fprintf( fp, "     ZONETYPE=FETRIANGLE, DATAPACKING=POINT \n" );
-
-   for(n=0;n<sp->ntri;++n) {
-      fprintf( fp, " %f  %f  %f   %lf %lf %lf \n",
-           sp->triangles[n].vertex1[0],
-           sp->triangles[n].vertex1[1],
-           sp->triangles[n].vertex1[2],
-           sp->triangles[n].normal[0],
-           sp->triangles[n].normal[1],
-           sp->triangles[n].normal[2] );
-      fprintf( fp, " %f  %f  %f   %lf %lf %lf \n",
-           sp->triangles[n].vertex2[0],
-           sp->triangles[n].vertex2[1],
-           sp->triangles[n].vertex2[2],
-           sp->triangles[n].normal[0],
-           sp->triangles[n].normal[1],
-           sp->triangles[n].normal[2] );
-      fprintf( fp, " %f  %f  %f   %lf %lf %lf \n",
-           sp->triangles[n].vertex3[0],
-           sp->triangles[n].vertex3[1],
-           sp->triangles[n].vertex3[2],
-           sp->triangles[n].normal[0],
-           sp->triangles[n].normal[1],
-           sp->triangles[n].normal[2] );
+   s = text;
+   if( islice > 0 ) {
+      s = text + nf * (size_t) islice / (size_t) nslice;
+      s = inSTL_NextFacet( s, text, text + nf );
    }
-   for(n=0;n<sp->ntri;++n) {
-      fprintf( fp, " %d %d %d \n", n*3+1, n*3+2, n*3+3 );
+   e = text + nf;
+   if( islice < nslice-1 ) {
+      e = text + nf * (size_t) ( islice + 1 ) / (size_t) nslice;
+      e = inSTL_NextFacet( ( e < s ? s : e ), text, text + nf );
+   }
+   istate = ( islice == 0 ? STLA_TOP : STLA_SOLID );
+
+   memset( &g, 0, sizeof(g) );
+   g.cap = (size_t) ( e - s ) / 256 + 16;
+   g.t = (struct inSTLtri_s *) malloc( g.cap * sizeof(struct inSTLtri_s) );
+   if( g.t == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate space for triangles \n",
+               FUNC );
+      inSTL_UnmapText( text, nf, buf );
+      return 9;
+   }
+   ierr = inSTL_ParseAscii( s, e, &istate, &g, &nsolid, NULL, 0, &perr );
+
+   // a slice that stops before the end of the text stops between facets
+   if( ierr == 0 && islice == 0 && nsolid == 0 ) ierr = 5;
+   if( ierr == 0 && e < text + nf && istate != STLA_SOLID ) ierr = 5;
+   if( ierr == 0 && istate != STLA_TOP && istate != STLA_SOLID ) ierr = 5;
+   inSTL_UnmapText( text, nf, buf );
+   if( ierr != 0 ) {
+      free( g.t );
+      return ( ierr == 9 ? 9 : 5 );
    }
 
-   fclose( fp );
+   sp->ntri = (unsigned int) g.n;
+   sp->triangles = g.t;
+   if( g.n > 0 && g.n < g.cap ) {
+      struct inSTLtri_s *t = (struct inSTLtri_s *)
+                 realloc( g.t, g.n * sizeof(struct inSTLtri_s) );
+      if( t != NULL ) sp->triangles = t;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+
+//
+// Streaming: the file is read in windows and the triangles are handed over
+// in batches of at most "nbatch", so that the memory in use depends on the
+// size of a batch and not on the size of the file. Binary records are read
+// a batch at a time. ASCII text is read in windows of at least a megabyte
+// that are cut after their last "endfacet" word; the rest of the window
+// moves to the front of the next one. A window without a complete facet is
+// doubled, which only happens for pathological white space.
+//
+
+static int inSTL_Hand( struct inSTLtri_s *t, size_t n, unsigned int nbatch,
+                       unsigned long *nsent, inSTLbatchFn fn, void *user )
+{
+   struct inSTLbatch_s b;
+   size_t k;
+
+   for(k=0;k<n;k+=b.ntri) {
+      b.first = *nsent;
+      b.ntri = (unsigned int) ( n - k < nbatch ? n - k : nbatch );
+      b.triangles = t + k;
+      if( fn( &b, user ) != 0 ) return 1;
+      *nsent += b.ntri;
+   }
+   return 0;
+}
+
+// the end of the last "endfacet" word of [s,e) that is followed by white
+// space; NULL if there is none
+static const char* inSTL_LastEndFacet( const char *s, const char *e )
+{
+   const char *q;
+
+   for(q=e-9;q>=s;--q) {
+      if( *q == 'e' && memcmp( q, "endfacet", 8 ) == 0 &&
+          inSTL_IsSpace( q[8] ) && ( q == s || inSTL_IsSpace( q[-1] ) ) ) {
+         return q + 8;
+      }
+   }
+   return NULL;
+}
+
+static int inSTL_StreamBinary( int handle, size_t nf, struct inSTL_s *sp,
+                               unsigned int nbatch, inSTLbatchFn fn,
+                               void *user )
+#define FUNC "inSTL_StreamSTL"
+{
+   struct inSTLtri_s *t;
+   unsigned long nsent=0;
+   unsigned int n,m,k;
+   size_t need,i;
+   ssize_t ir;
+   char *buf;
+   int ierr=0;
+
+
+   for(i=0;i<84;i+=(size_t) ir) {
+      ir = read( handle, ( i < 80 ? sp->header + i :
+                           (char *) &( sp->ntri ) + ( i - 80 ) ),
+                 ( i < 80 ? 80 - i : 84 - i ) );
+      if( ir <= 0 ) break;
+   }
+   need = 84 + 50 * (size_t) sp->ntri;
+   if( i < 84 || nf < need ) {
+      fprintf( stderr, " e [%s]  File has %ld bytes for %u triangles, "
+               "which need %ld (truncated?) \n", FUNC, (long) nf, sp->ntri,
+               (long) need );
+      sp->ntri = 0;
+      return 3;
+   }
+   fprintf( stderr, " i [%s]  File has %d triangles \n", FUNC, sp->ntri );
+   posix_fadvise( handle, 0, 0, POSIX_FADV_SEQUENTIAL );
+
+   buf = (char *) malloc( 50 * (size_t) nbatch );
+   t = (struct inSTLtri_s *)
+       malloc( (size_t) nbatch * sizeof(struct inSTLtri_s) );
+   if( buf == NULL || t == NULL ) {
+      fprintf( stderr," e [%s]  Could not allocate space for triangles\n",FUNC);
+      if( buf != NULL ) free( buf );
+      if( t != NULL ) free( t );
+      return 2;
+   }
+
+   for(n=0;n<sp->ntri && ierr == 0;n+=m) {
+      m = ( sp->ntri - n < nbatch ? sp->ntri - n : nbatch );
+      for(i=0;i<50*(size_t) m;i+=(size_t) ir) {
+         ir = read( handle, buf + i, 50*(size_t) m - i );
+         if( ir <= 0 ) break;
+      }
+      if( i < 50*(size_t) m ) {
+         fprintf( stderr," e [%s]  Failed to read all triangles; "
+                  "(truncated?) \n", FUNC );
+         ierr = 3;
+         break;
+      }
+      for(k=0;k<m;++k) memcpy( &( t[k] ), buf + 50*k, 50 );
+      if( inSTL_Hand( t, m, nbatch, &nsent, fn, user ) ) ierr = 5;
+   }
+
+   free( buf );
+   free( t );
+   return ierr;
+}
+#undef FUNC
+
+static int inSTL_StreamAscii( int handle, const char *filename,
+                              struct inSTL_s *sp, unsigned int nbatch,
+                              inSTLbatchFn fn, void *user )
+#define FUNC "inSTL_StreamSTL"
+{
+   const char *msg[] = { "", "", "Unexpected word", "Bad number",
+                         "Facet is not a triangle" };
+   struct inSTLgrow_s g;
+   unsigned long nsent=0;
+   const char *cut,*perr=NULL;
+   char *buf,*tmp;
+   char name[80];
+   size_t cap,len=0,nw;
+   ssize_t ir;
+   long nline=0;
+   int ieof=0,ierr=0,istate=STLA_TOP,nsolid=0;
+
+
+   cap = 64 * (size_t) nbatch;
+   if( cap < ( 1 << 20 ) ) cap = 1 << 20;
+   buf = (char *) malloc( cap );
+   memset( &g, 0, sizeof(g) );
+   if( buf == NULL ) {
+      fprintf( stderr," e [%s]  Could not allocate space for text\n",FUNC);
+      return 9;
+   }
+   posix_fadvise( handle, 0, 0, POSIX_FADV_SEQUENTIAL );
+   name[0] = '\0';
+
+   while( ierr == 0 && !( ieof && len == 0 ) ) {
+      while( !ieof && len < cap ) {
+         ir = read( handle, buf + len, cap - len );
+         if( ir < 0 && errno == EINTR ) continue;
+         if( ir <= 0 ) {
+            ieof = 1;
+         } else {
+            len += (size_t) ir;
+         }
+      }
+
+      cut = ( ieof ? buf + len : inSTL_LastEndFacet( buf, buf + len ) );
+      if( cut == NULL ) {
+         tmp = (char *) realloc( buf, 2*cap );
+         if( tmp == NULL ) {
+            ierr = 9;
+            break;
+         }
+         buf = tmp;
+         cap *= 2;
+         continue;
+      }
+
+      ierr = inSTL_ParseAscii( buf, cut, &istate, &g, &nsolid,
+                               name, sizeof(name), &perr );
+      if( ierr != 0 ) {
+         nline += inSTL_LineOf( buf, perr ) - 1;
+         break;
+      }
+      if( inSTL_Hand( g.t, g.n, nbatch, &nsent, fn, user ) ) {
+         ierr = 5;
+         break;
+      }
+      g.n = 0;
+      nline += inSTL_LineOf( buf, cut ) - 1;
+
+      nw = (size_t) ( cut - buf );
+      memmove( buf, cut, len - nw );
+      len -= nw;
+   }
+
+   if( ierr == 0 && nsolid == 0 ) {
+      fprintf( stderr, " e [%s]  Could not find a valid STL header\n", FUNC );
+      ierr = 2;
+   } else if( ierr == 9 ) {
+      fprintf( stderr, " e [%s]  Could not allocate space for triangles \n",
+               FUNC );
+   } else if( ierr == 5 ) {
+      fprintf( stderr, " e [%s]  Stopped by the consumer of triangles \n",
+               FUNC );
+   } else if( ierr != 0 ) {
+      fprintf( stderr, " e [%s]  %s at line %ld of \"%s\"\n", FUNC,
+               msg[ierr], nline + 1, filename );
+      ierr = 4;
+   } else if( istate != STLA_TOP && istate != STLA_SOLID ) {
+      fprintf( stderr, " e [%s]  File seems to be truncated\n", FUNC );
+      ierr = 3;
+   } else if( istate == STLA_SOLID ) {
+      fprintf( stderr, " i [%s]  No \"endsolid\" at the end \n", FUNC );
+   }
+
+   free( buf );
+   if( g.t != NULL ) free( g.t );
+   if( ierr != 0 ) return ierr;
+
+   fprintf( stderr," i [%s]  Name in file: \"%s\"\n", FUNC, name );
+   if( nsolid > 1 ) {
+      fprintf( stderr, " i [%s]  Joined %d solids \n", FUNC, nsolid );
+   }
+   fprintf( stderr, " i [%s]  Counted %lu triangles \n", FUNC, nsent );
+   sp->ntri = (unsigned int) nsent;
+
+   return 0;
+}
+#undef FUNC
+
+//
+// Function to read an STL file (binary or ASCII) and hand its triangles to
+// "fn" in batches of at most "nbatch"; "sp" receives the header and the
+// number of triangles but no array
+//
+
+int inSTL_StreamSTL( char *filename, unsigned int nbatch,
+                     inSTLbatchFn fn, void *user, struct inSTL_s *sp )
+#define FUNC "inSTL_StreamSTL"
+{
+   struct stat st;
+   int handle,itype=0,ierr;
+
+
+   inSTL_InitSTLfile( sp );
+   if( nbatch == 0 ) nbatch = 262144;
+
+   handle = open( filename, O_RDONLY );
+   if( handle == -1 || fstat( handle, &st ) != 0 ) {
+      fprintf( stderr," e [%s]  Failed to open file \"%s\" for reading\n",
+               FUNC,filename);
+      if( handle != -1 ) close( handle );
+      return 1;
+   }
+
+   ierr = inSTL_ProbeSTLfile( filename, &itype );
+   if( ierr != 0 ) {
+      close( handle );
+      return ierr;
+   }
+
+   if( itype == 1 ) {
+      ierr = inSTL_StreamBinary( handle, (size_t) st.st_size, sp, nbatch,
+                                 fn, user );
+   } else {
+      ierr = inSTL_StreamAscii( handle, filename, sp, nbatch, fn, user );
+   }
+   close( handle );
+
+   return ierr;
+}
+#undef FUNC
+
+
+//
+// ASCII STL output. Facets are formatted in blocks by the threads of the
+// Tecplot engine and go to the file in large writes. The numbers are either
+// "%f" (what this file always wrote) or the shortest text that reads back to
+// the same float, so that a round trip through ASCII loses nothing.
+//
+
+static char* inSTL_StlVector( char *p, const float *v, int iexact )
+{
+   int k;
+
+   for(k=0;k<3;++k) {
+      p = intec_FmtText( p, "  " );
+      if( iexact ) {
+         p = intec_FmtShortest( p, v[k] );
+      } else {
+         p = intec_FmtFixed( p, (double) v[k] );
+      }
+   }
+   return p;
+}
+
+static char* inSTL_StlFacet( long i, char *p, const struct inSTLtri_s *tp,
+                             int iexact )
+{
+   tp += i;
+   p = intec_FmtText( p, "  facet normal " );
+   p = inSTL_StlVector( p, tp->normal, iexact );
+   p = intec_FmtText( p, " \n   outer loop\n    vertex" );
+   p = inSTL_StlVector( p, tp->vertex1, iexact );
+   p = intec_FmtText( p, "\n    vertex" );
+   p = inSTL_StlVector( p, tp->vertex2, iexact );
+   p = intec_FmtText( p, "\n    vertex" );
+   p = inSTL_StlVector( p, tp->vertex3, iexact );
+   return intec_FmtText( p, "\n   endloop\n  endfacet\n" );
+}
+
+static char* inSTL_StlFacetFixed( long i, char *p, void *user )
+{
+   return inSTL_StlFacet( i, p, (const struct inSTLtri_s *) user, 0 );
+}
+
+static char* inSTL_StlFacetExact( long i, char *p, void *user )
+{
+   return inSTL_StlFacet( i, p, (const struct inSTLtri_s *) user, 1 );
+}
+
+static int inSTL_DumpAscii( char *filename, struct inSTL_s *sp, int iexact,
+                            int nthreads, const char *func )
+{
+   int fd,ierr,nh;
+   char head[256];
+   size_t maxrow;
+
+
+   fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+   if( fd == -1 ) {
+      fprintf( stderr, " e [%s]  Could not write file: \"%s\"\n",func,filename);
+      return 1;
+   } else {
+      fprintf( stderr, " i [%s]  Writing file: \"%s\"\n", func, filename );
+   }
+
+   nh = snprintf( head, 256, "solid ASCII_STL_by_IN (%d triangles) \n",
+                  sp->ntri );
+   ierr = intec_WriteText( fd, head, (size_t) nh );
+
+   maxrow = 12*( ( iexact ? INTEC_MAXSHORT : INTEC_MAXFIXED ) + 2 ) + 128;
+   if( ierr == 0 ) {
+      ierr = intec_WriteAscii( fd, (long) sp->ntri, maxrow,
+                               ( iexact ? inSTL_StlFacetExact :
+                                          inSTL_StlFacetFixed ),
+                               sp->triangles, nthreads );
+   }
+   if( ierr == 0 ) {
+      nh = snprintf( head, 256, "endsolid ASCII_STL_by_IN \n" );
+      ierr = intec_WriteText( fd, head, (size_t) nh );
+   }
+
+   if( close( fd ) != 0 || ierr != 0 ) {
+      fprintf( stderr, " e [%s]  Failed writing file: \"%s\"\n", func,
+               filename );
+      return 2;
+   }
+
+   return 0;
+}
+
+//
+// Function to dump an ASCII STL file with "%f" numbers
+//
+
+int inSTL_DumpAsciiSTL( char *filename, struct inSTL_s *sp )
+{
+   return inSTL_DumpAscii( filename, sp, 0, 0, "inSTL_DumpAsciiSTL" );
+}
+
+//
+// Function to dump an ASCII STL file that reads back to the same floats
+//
+
+int inSTL_DumpAsciiSTLExact( char *filename, struct inSTL_s *sp,
+                             int nthreads )
+{
+   return inSTL_DumpAscii( filename, sp, 1, nthreads,
+                           "inSTL_DumpAsciiSTLExact" );
+}
+
+
+//
+// Binary STL output. Every thread packs the 50-byte records of its range of
+// triangles in to an aligned buffer a block at a time and puts each block at
+// its place in the file with pwrite(), so there is one system call per
+// block. The header is kept if it is one that the probe accepts.
+//
+
+struct inSTLpack_s {
+   int fd;
+   const struct inSTLtri_s *t;
+   unsigned int n0,n1;
+   int ierr;
+};
+
+static void* inSTL_PackRange( void *arg )
+{
+   struct inSTLpack_s *d = (struct inSTLpack_s *) arg;
+   const unsigned int nb = 16384;
+   unsigned int n,m,k;
+   size_t nw;
+   off_t off;
+   ssize_t iw;
+   char *buf;
+
+   buf = (char *) inSTL_AlignedAlloc( 50 * (size_t) nb );
+   if( buf == NULL ) {
+      d->ierr = 1;
+      return NULL;
+   }
+   for(n=d->n0;n<d->n1 && d->ierr == 0;n+=m) {
+      m = ( d->n1 - n < nb ? d->n1 - n : nb );
+      for(k=0;k<m;++k) {
+         memcpy( buf + 50*k, d->t[n+k].normal, 48 );
+         memcpy( buf + 50*k + 48, &( d->t[n+k].iatrib ), 2 );
+      }
+      off = (off_t) 84 + (off_t) 50 * (off_t) n;
+      for(nw=0;nw<50*(size_t) m;nw+=(size_t) iw) {
+         iw = pwrite( d->fd, buf + nw, 50*(size_t) m - nw, off + (off_t) nw );
+         if( iw < 0 && errno == EINTR ) {
+            iw = 0;
+         } else if( iw <= 0 ) {
+            d->ierr = 2;
+            break;
+         }
+      }
+   }
+   free( buf );
+
+   return NULL;
+}
+
+int inSTL_DumpBinarySTL( char *filename, struct inSTL_s *sp, int nthreads )
+#define FUNC "inSTL_DumpBinarySTL"
+{
+   struct inSTLpack_s d[64];
+   pthread_t th[64];
+   char head[84];
+   ssize_t iw;
+   long nc;
+   int fd,it,nrun=0,ierr=0;
+
+
+   fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+   if( fd == -1 ) {
+      fprintf( stderr, " e [%s]  Could not write file: \"%s\"\n",FUNC,filename);
+      return 1;
+   } else {
+      fprintf( stderr, " i [%s]  Writing file: \"%s\"\n", FUNC, filename );
+   }
+
+   // the header is kept unless it starts like an ASCII file
+   memset( head, '\0', 84 );
+   for(it=0;it<80 && sp->header[it]==' ';++it) {}
+   if( sp->header[0] != '\0' && strncmp( &( sp->header[it] ), "solid", 5 ) ) {
+      memcpy( head, sp->header, 80 );
+   } else {
+      snprintf( head, 80, "BINARY_STL_by_IN (%u triangles)", sp->ntri );
+   }
+   memcpy( head + 80, &( sp->ntri ), 4 );
+   iw = pwrite( fd, head, 84, 0 );
+   if( iw != 84 ) ierr = 1;
+
+   if( nthreads <= 0 ) {
+      nc = sysconf( _SC_NPROCESSORS_ONLN );
+      nthreads = ( nc > 0 ? (int) nc : 1 );
+   }
+   if( nthreads > 64 ) nthreads = 64;
+   if( (size_t) nthreads > sp->ntri / 65536 + 1 ) {
+      nthreads = (int) ( sp->ntri / 65536 + 1 );
+   }
+   for(it=0;it<nthreads;++it) {
+      d[it].fd = fd;
+      d[it].t = sp->triangles;
+      d[it].n0 = (unsigned int) ( (size_t) sp->ntri * (size_t) it /
+                                  (size_t) nthreads );
+      d[it].n1 = (unsigned int) ( (size_t) sp->ntri * (size_t) ( it + 1 ) /
+                                  (size_t) nthreads );
+      d[it].ierr = ierr;
+   }
+   for(it=1;it<nthreads;++it) {
+      if( pthread_create( &( th[it] ), NULL, inSTL_PackRange, &( d[it] ) ) ) {
+         break;
+      }
+      ++nrun;
+   }
+   inSTL_PackRange( &( d[0] ) );
+   for(it=nrun+1;it<nthreads;++it) inSTL_PackRange( &( d[it] ) );
+   for(it=1;it<=nrun;++it) pthread_join( th[it], NULL );
+   for(it=0;it<nthreads;++it) if( d[it].ierr != 0 ) ierr = d[it].ierr;
+
+   if( close( fd ) != 0 || ierr != 0 ) {
+      fprintf( stderr, " e [%s]  Failed writing file: \"%s\"\n", FUNC,
+               filename );
+      return 2;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+/*
+ * Rows of the ASCII TecPlot file: three nodes per triangle, then triangles
+ */
+
+static char* inSTL_TecNode( long i, char *p, void *user )
+{
+   const struct inSTLtri_s *tp = &( ((const struct inSTLtri_s *) user)[i/3] );
+   const float *v = ( i%3 == 0 ? tp->vertex1 :
+                    ( i%3 == 1 ? tp->vertex2 : tp->vertex3 ) );
+
+   *p++ = ' ';
+   p = intec_FmtFixed( p, (double) v[0] );
+   p = intec_FmtText( p, "  " );
+   p = intec_FmtFixed( p, (double) v[1] );
+   p = intec_FmtText( p, "  " );
+   p = intec_FmtFixed( p, (double) v[2] );
+   p = intec_FmtText( p, "   " );
+   p = intec_FmtFixed( p, (double) tp->normal[0] );
+   *p++ = ' ';
+   p = intec_FmtFixed( p, (double) tp->normal[1] );
+   *p++ = ' ';
+   p = intec_FmtFixed( p, (double) tp->normal[2] );
+   return intec_FmtText( p, " \n" );
+}
+
+static char* inSTL_TecElement( long i, char *p, void *user )
+{
+   *p++ = ' ';
+   p = intec_FmtLong( p, i*3+1 );
+   *p++ = ' ';
+   p = intec_FmtLong( p, i*3+2 );
+   *p++ = ' ';
+   p = intec_FmtLong( p, i*3+3 );
+   return intec_FmtText( p, " \n" );
+}
+
+/*
+ * Function to dump a TecPlot file
+ */
+
+int inSTL_DumpAsciiSTLTecplot(char *filename, struct inSTL_s *sp)
+#define FUNC "inSTL_DumpAsciiSTLTecplot"
+{
+   int fd,ierr,nh;
+   char head[256];
+
+
+   fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+   if( fd == -1 ) {
+      fprintf( stderr, " e [%s]  Could not write file: \"%s\"\n",FUNC,filename);
+      return 1;
+   } else {
+      fprintf( stderr, " i [%s]  Writing file: \"%s\"\n", FUNC, filename );
+   }
+
+   nh = snprintf( head, 256, "variables = x y z nx ny nz \n"
+                             "ZONE NODES=%d, ELEMENTS=%d, "
+                             "     ZONETYPE=FETRIANGLE, DATAPACKING=POINT \n",
+                  sp->ntri*3, sp->ntri );
+   ierr = intec_WriteText( fd, head, (size_t) nh );
+
+   if( ierr == 0 ) {
+      ierr = intec_WriteAscii( fd, 3 * (long) sp->ntri,
+                               6*( INTEC_MAXFIXED + 3 ) + 4,
+                               inSTL_TecNode, sp->triangles, 0 );
+   }
+   if( ierr == 0 ) {
+      ierr = intec_WriteAscii( fd, (long) sp->ntri, 3*24 + 4,
+                               inSTL_TecElement, NULL, 0 );
+   }
+
+   if( close( fd ) != 0 || ierr != 0 ) {
+      fprintf( stderr, " e [%s]  Failed writing file: \"%s\"\n", FUNC,
+               filename );
+      return 2;
+   }
+
+   return 0;
+}
+#undef FUNC
+
+/*
+ * Function to dump a binary TecPlot file (".plt") with the same contents
+ */
+
+int inSTL_DumpSTLTecplotBinary( char *filename, struct inSTL_s *sp )
+#define FUNC "inSTL_DumpSTLTecplotBinary"
+{
+   struct inTec_s tec;
+   double vmin[6],vmax[6];
+   float *buf;
+   int32_t *conn;
+   size_t stride = sizeof(struct inSTLtri_s);
+   unsigned int n,m,k,nb = 4096;
+   int i,ierr;
+
+
+   for(i=0;i<6;++i) {
+      vmin[i] =  HUGE_VAL;
+      vmax[i] = -HUGE_VAL;
+   }
+   for(i=0;i<3;++i) {
+      intec_Range( &( sp->triangles[0].vertex1[i] ), sp->ntri, stride,
+                   &( vmin[i] ), &( vmax[i] ) );
+      intec_Range( &( sp->triangles[0].vertex2[i] ), sp->ntri, stride,
+                   &( vmin[i] ), &( vmax[i] ) );
+      intec_Range( &( sp->triangles[0].vertex3[i] ), sp->ntri, stride,
+                   &( vmin[i] ), &( vmax[i] ) );
+      intec_Range( &( sp->triangles[0].normal[i] ), sp->ntri, stride,
+                   &( vmin[3+i] ), &( vmax[3+i] ) );
+   }
+
+   buf = (float *) malloc( ((size_t) nb) * 3 * sizeof(float) );
+   if( buf == NULL ) {
+      fprintf( stderr, " e [%s]  Could not allocate buffer \n", FUNC );
+      return 1;
+   }
+   conn = (int32_t *) buf;
+
+   ierr = intec_Open( &tec, filename, "STL", "STL triangles",
+                      "x y z nx ny nz", INTEC_FETRIANGLE,
+                      3 * (long) sp->ntri, (long) sp->ntri, vmin, vmax );
+   if( ierr != 0 ) {
+      free( buf );
+      return 2;
+   }
+
+   // every triangle has its own three nodes, which carry the facet normal
+   for(i=0;i<6 && ierr == 0;++i) {
+      for(n=0;n<sp->ntri && ierr == 0;n+=m) {
+         m = ( sp->ntri - n < nb ? sp->ntri - n : nb );
+         for(k=0;k<m;++k) {
+            const struct inSTLtri_s *tp = &( sp->triangles[n+k] );
+            if( i < 3 ) {
+               buf[3*k  ] = tp->vertex1[i];
+               buf[3*k+1] = tp->vertex2[i];
+               buf[3*k+2] = tp->vertex3[i];
+            } else {
+               buf[3*k  ] = tp->normal[i-3];
+               buf[3*k+1] = tp->normal[i-3];
+               buf[3*k+2] = tp->normal[i-3];
+            }
+         }
+         ierr = intec_WriteBlock( &tec, buf, 3 * (long) m );
+      }
+   }
+
+   for(n=0;n<sp->ntri && ierr == 0;n+=m) {
+      m = ( sp->ntri - n < nb ? sp->ntri - n : nb );
+      for(k=0;k<3*m;++k) conn[k] = (int32_t) ( 3*n + k );
+      ierr = intec_WriteConnectivity( &tec, conn, 3 * (long) m );
+   }
+
+   free( buf );
+   if( intec_Close( &tec ) != 0 || ierr != 0 ) return 3;
+
+   return 0;
+}
+#undef FUNC
+
+
+/*
+ * Welding of the triangle soup into an indexed mesh. The corners (three per
+ * triangle) are keyed by their coordinates, either the exact bits of the
+ * floats or the cell of a grid of spacing "eps", and grouped by their keys
+ * with inhash_Build(); the first corner of a cell leads it. With a
+ * tolerance, every corner looks at the corners of the neighbouring cells,
+ * and two cells are joined when any of their corners are within "eps" of
+ * each other; the joined cells form a tree whose root is their earliest
+ * leader, whatever the order of the joins. The numbering is a last serial
+ * pass in the order of the corners, so the result does not depend on the
+ * number of threads.
+ */
+
+#define INSTL_NONE    0xffffffffu
+
+struct inSTLweld_s {
+   const struct inSTLtri_s *tp;
+   size_t n;                  // corners
+   float eps;
+   struct inhash_s h;         // cells of the corners
+   inhashIdx_t *rep;          // [n] leaders of the cells of the corners
+   unsigned int *link;        // [n] parent of a leader in its tree
+   unsigned int *mstart;      // [n+1] corners of the cell of a leader
+   unsigned int *memb;        // [n]   in "memb[mstart[l]:mstart[l+1]]"
+};
+
+static const float* inSTL_Corner( const struct inSTLtri_s *tp, size_t i )
+{
+   const struct inSTLtri_s *t = &( tp[i/3] );
+   return ( i%3 == 0 ? t->vertex1 : ( i%3 == 1 ? t->vertex2 : t->vertex3 ) );
+}
+
+static void inSTL_CellKey( const struct inSTLweld_s *w, const float *x,
+                           int64_t *k )
+{
+   uint32_t u;
+   float f;
+   int j;
+
+   for(j=0;j<3;++j) {
+      if( w->eps > 0.0f ) {
+         // cells centred on the multiples of eps, where round numbers sit
+         k[j] = (int64_t) floor( (double) x[j] / (double) w->eps + 0.5 );
+      } else {
+         f = ( x[j] == 0.0f ? 0.0f : x[j] );      // -0 is +0
+         memcpy( &u, &f, 4 );
+         k[j] = (int64_t) u;
+      }
+   }
+}
+
+static uint64_t inSTL_CellHash( const int64_t *k )
+{
+   return inhash_Mix( (uint64_t) k[0], (uint64_t) k[1], (uint64_t) k[2] );
+}
+
+static uint64_t inSTL_WeldKey( size_t i, void *user )
+{
+   const struct inSTLweld_s *w = (const struct inSTLweld_s *) user;
+   int64_t k[3];
+
+   inSTL_CellKey( w, inSTL_Corner( w->tp, i ), k );
+   return inSTL_CellHash( k );
+}
+
+static int inSTL_WeldMatch( size_t l, const void *key, void *user )
+{
+   const struct inSTLweld_s *w = (const struct inSTLweld_s *) user;
+   const int64_t *k = (const int64_t *) key;
+   int64_t kl[3];
+
+   inSTL_CellKey( w, inSTL_Corner( w->tp, l ), kl );
+   return( kl[0] == k[0] && kl[1] == k[1] && kl[2] == k[2] );
+}
+
+static int inSTL_WeldSame( size_t l, size_t i, void *user )
+{
+   const struct inSTLweld_s *w = (const struct inSTLweld_s *) user;
+   int64_t k[3];
+
+   inSTL_CellKey( w, inSTL_Corner( w->tp, i ), k );
+   return inSTL_WeldMatch( l, k, user );
+}
+
+//
+// Function to join the trees of two leaders; the larger root is hung under
+// the smaller, so the root of a tree is its earliest leader
+//
+
+static void inSTL_WeldJoin( unsigned int *link, unsigned int a,
+                            unsigned int b )
+{
+   unsigned int t;
+
+   for(;;) {
+      while( ( t = __atomic_load_n( &( link[a] ), __ATOMIC_RELAXED ) ) != a ) {
+         a = t;
+      }
+      while( ( t = __atomic_load_n( &( link[b] ), __ATOMIC_RELAXED ) ) != b ) {
+         b = t;
+      }
+      if( a == b ) return;
+      if( a > b ) {
+         t = a;
+         a = b;
+         b = t;
+      }
+      t = b;
+      if( __atomic_compare_exchange_n( &( link[b] ), &t, a, 0,
+                                       __ATOMIC_RELAXED,
+                                       __ATOMIC_RELAXED ) ) return;
+   }
+}
+
+//
+// Links between neighbouring cells with corners within the tolerance; a
+// corner need only be within "eps" of corners in the 26 cells around its
+// own, and every pair of cells is seen once from the first of the 13
+// directions, by each corner of the first cell against all of the second
+//
+
+static void inSTL_WeldLinks( int it, void *arg )
+{
+   struct inSTLweld_s *w = (struct inSTLweld_s *) arg;
+   const size_t i0 = w->n * (size_t) it / (size_t) w->h.nthreads;
+   const size_t i1 = w->n * (size_t) ( it + 1 ) / (size_t) w->h.nthreads;
+   const float e2 = w->eps * w->eps;
+   int64_t k[3],kn[3];
+   const float *x,*y;
+   size_t i,m;
+   unsigned int j;
+   int di,dj,dk;
+
+   for(i=i0;i<i1;++i) {
+      x = inSTL_Corner( w->tp, i );
+      inSTL_CellKey( w, x, k );
+      for(di=0;di<=1;++di)
+      for(dj=( di > 0 ? -1 : 0 );dj<=1;++dj)
+      for(dk=( di > 0 || dj > 0 ? -1 : 1 );dk<=1;++dk) {
+         kn[0] = k[0] + di;
+         kn[1] = k[1] + dj;
+         kn[2] = k[2] + dk;
+         m = inhash_Find( &( w->h ), inSTL_CellHash( kn ),
+                          inSTL_WeldMatch, kn );
+         if( m == INHASH_NONE ) continue;
+         for(j=w->mstart[m];j<w->mstart[m+1];++j) {
+            y = inSTL_Corner( w->tp, w->memb[j] );
+            if( (x[0]-y[0])*(x[0]-y[0]) + (x[1]-y[1])*(x[1]-y[1]) +
+                (x[2]-y[2])*(x[2]-y[2]) <= e2 ) {
+               inSTL_WeldJoin( w->link, (unsigned int) w->rep[i],
+                               (unsigned int) m );
+               break;
+            }
+         }
+      }
+   }
+}
+
+
+/*
+ * Function to weld the vertices of a triangle soup into an indexed mesh;
+ * corners with identical coordinates are merged when "eps" is zero, and
+ * corners that fall in the same cell of a grid of spacing "eps", or in
+ * neighbouring cells with any two corners within "eps" of each other (and
+ * so on, transitively), otherwise
+ */
+
+int inSTL_WeldSTL( struct inSTL_s *sp, struct inSTLmesh_s *mp,
+                   float eps, int nthreads )
+#define FUNC "inSTL_WeldSTL"
+{
+   struct inSTLweld_s w;
+   size_t i,n,l;
+   inhashIdx_t *rep;
+   unsigned int nv=0,*vid;
+   int ierr=0;
+   long nc;
+
+
+   memset( mp, 0, sizeof(struct inSTLmesh_s) );
+   n = 3 * (size_t) sp->ntri;
+   if( n >= (size_t) INSTL_NONE ) {
+      fprintf( stderr, " e [%s]  Too many triangles \n", FUNC );
+      return 1;
+   }
+   if( nthreads <= 0 ) {
+      nc = sysconf( _SC_NPROCESSORS_ONLN );
+      nthreads = ( nc > 0 ? (int) nc : 1 );
+   }
+
+   memset( &w, 0, sizeof(w) );
+   w.tp = sp->triangles;
+   w.n = n;
+   w.eps = ( eps > 0.0f ? eps : 0.0f );
+   mp->tris = (unsigned int *) malloc( ( n > 0 ? n : 1 ) *
+                                       sizeof(unsigned int) );
+   w.rep = (inhashIdx_t *) malloc( ( n > 0 ? n : 1 ) * sizeof(inhashIdx_t) );
+   if( w.eps > 0.0f ) {
+      w.link = (unsigned int *) malloc( ( n > 0 ? n : 1 ) *
+                                        sizeof(unsigned int) );
+      w.mstart = (unsigned int *) calloc( n + 1, sizeof(unsigned int) );
+      w.memb = (unsigned int *) malloc( ( n > 0 ? n : 1 ) *
+                                        sizeof(unsigned int) );
+   }
+   if( mp->tris == NULL || w.rep == NULL ||
+       ( w.eps > 0.0f &&
+         ( w.link == NULL || w.mstart == NULL || w.memb == NULL ) ) ) {
+      fprintf( stderr, " e [%s]  Could not allocate arrays \n", FUNC );
+      ierr = 1;
+   }
+   if( ierr == 0 ) {
+      ierr = inhash_Build( &( w.h ), n, nthreads,
+                           inSTL_WeldKey, inSTL_WeldSame, &w, w.rep );
+   }
+   if( ierr == 0 && w.eps > 0.0f ) {
+      // the corners of every cell, in order, behind its leader
+      for(i=0;i<n;++i) ++( w.mstart[ w.rep[i] + 1 ] );
+      for(l=0;l<n;++l) w.mstart[l+1] += w.mstart[l];
+      for(i=0;i<n;++i) w.memb[ ( w.mstart[ w.rep[i] ] )++ ] = (unsigned int) i;
+      for(l=n;l>0;--l) w.mstart[l] = w.mstart[l-1];
+      w.mstart[0] = 0;
+
+      for(i=0;i<n;++i) w.link[i] = (unsigned int) i;
+      inhash_Run( w.h.nthreads, inSTL_WeldLinks, &w );
+   }
+
+   if( ierr == 0 ) {
+      // final leaders and the numbering, in the order of the corners
+      rep = w.rep;
+      vid = mp->tris;
+      for(i=0;i<n;++i) {
+         if( (size_t) rep[i] == i ) {
+            if( w.link != NULL && w.link[i] != (unsigned int) i ) {
+               rep[i] = rep[ w.link[i] ];
+            }
+         } else {
+            rep[i] = rep[ rep[i] ];
+         }
+         vid[i] = ( (size_t) rep[i] == i ? nv++ : vid[ rep[i] ] );
+      }
+
+      mp->vertices = (float *) malloc( ( nv > 0 ? (size_t) nv : 1 ) *
+                                       3 * sizeof(float) );
+      if( mp->vertices == NULL ) {
+         fprintf( stderr, " e [%s]  Could not allocate vertices \n", FUNC );
+         ierr = 1;
+      } else {
+         for(i=0;i<n;++i) {
+            if( (size_t) rep[i] == i ) {
+               memcpy( &( mp->vertices[ 3*(size_t) vid[i] ] ),
+                       inSTL_Corner( w.tp, i ), 3*sizeof(float) );
+            }
+         }
+         mp->nvert = nv;
+         mp->ntri = sp->ntri;
+      }
+   }
+
+   inhash_Free( &( w.h ) );
+   if( w.rep != NULL ) free( w.rep );
+   if( w.link != NULL ) free( w.link );
+   if( w.mstart != NULL ) free( w.mstart );
+   if( w.memb != NULL ) free( w.memb );
+   if( ierr ) {
+      inSTL_FreeMesh( mp );
+      return 2;
+   }
+#ifdef _DEBUG_
+   fprintf( stderr, " i [%s]  Welded %ld corners to %u vertices \n",
+            FUNC, (long) n, nv );
+#endif
+
+   return 0;
+}
+#undef FUNC
+
+void inSTL_FreeMesh( struct inSTLmesh_s *mp )
+{
+   if( mp->vertices != NULL ) free( mp->vertices );
+   if( mp->tris != NULL ) free( mp->tris );
+   memset( mp, 0, sizeof(struct inSTLmesh_s) );
+}
+
+/*
+ * Rows of the ASCII TecPlot file of a welded mesh
+ */
+
+static char* inSTL_TecMeshNode( long i, char *p, void *user )
+{
+   const float *v = &( ((const float *) user)[3*i] );
+
+   *p++ = ' ';
+   p = intec_FmtFixed( p, (double) v[0] );
+   p = intec_FmtText( p, "  " );
+   p = intec_FmtFixed( p, (double) v[1] );
+   p = intec_FmtText( p, "  " );
+   p = intec_FmtFixed( p, (double) v[2] );
+   return intec_FmtText( p, " \n" );
+}
+
+static char* inSTL_TecMeshElement( long i, char *p, void *user )
+{
+   const unsigned int *t = &( ((const unsigned int *) user)[3*i] );
+
+   *p++ = ' ';
+   p = intec_FmtLong( p, (long) t[0] + 1 );
+   *p++ = ' ';
+   p = intec_FmtLong( p, (long) t[1] + 1 );
+   *p++ = ' ';
+   p = intec_FmtLong( p, (long) t[2] + 1 );
+   return intec_FmtText( p, " \n" );
+}
+
+/*
+ * Function to dump a TecPlot file of a welded mesh; one node per vertex
+ */
+
+int inSTL_DumpMeshTecplot( char *filename, struct inSTLmesh_s *mp )
+#define FUNC "inSTL_DumpMeshTecplot"
+{
+   int fd,ierr,nh;
+   char head[256];
+
+
+   fd = open( filename, O_WRONLY | O_CREAT | O_TRUNC, 0666 );
+   if( fd == -1 ) {
+      fprintf( stderr, " e [%s]  Could not write file: \"%s\"\n",FUNC,filename);
+      return 1;
+   } else {
+      fprintf( stderr, " i [%s]  Writing file: \"%s\"\n", FUNC, filename );
+   }
+
+   nh = snprintf( head, 256, "variables = x y z \n"
+                             "ZONE NODES=%u, ELEMENTS=%u, "
+                             "     ZONETYPE=FETRIANGLE, DATAPACKING=POINT \n",
+                  mp->nvert, mp->ntri );
+   ierr = intec_WriteText( fd, head, (size_t) nh );
+
+   if( ierr == 0 ) {
+      ierr = intec_WriteAscii( fd, (long) mp->nvert,
+                               3*( INTEC_MAXFIXED + 2 ) + 4,
+                               inSTL_TecMeshNode, mp->vertices, 0 );
+   }
+   if( ierr == 0 ) {
+      ierr = intec_WriteAscii( fd, (long) mp->ntri, 3*24 + 4,
+                               inSTL_TecMeshElement, mp->tris, 0 );
+   }
+
+   if( close( fd ) != 0 || ierr != 0 ) {
+      fprintf( stderr, " e [%s]  Failed writing file: \"%s\"\n", FUNC,
+               filename );
+      return 2;
+   }
 
    return 0;
 }
@@ -463,6 +2081,14 @@ int main() {
    if(itype == 1) (void) inSTL_ReadBinarySTL("file.stl",&stl, isize);
    (void) inSTL_DumpAsciiSTL("dump.stl",&stl);
    inSTL_DumpAsciiSTLTecplot("dump.dat", &stl );
+   inSTL_DumpSTLTecplotBinary("dump.plt", &stl );
+   {
+      struct inSTLmesh_s mesh;
+      if( inSTL_WeldSTL( &stl, &mesh, 0.0f, 0 ) == 0 ) {
+         inSTL_DumpMeshTecplot( "weld.dat", &mesh );
+         inSTL_FreeMesh( &mesh );
+      }
+   }
 
    return 0;
 }
@@ -39,6 +39,10 @@
  SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  ******************************************************************************/
 
+#ifndef _STL_H_
+#define _STL_H_
+
+#include <stdlib.h>
 
 struct inSTLtri_s {
    float normal[3];      // these 12 numbers are little endian !!!!!
@@ -54,3 +58,90 @@ struct inSTL_s {
    struct inSTLtri_s *triangles;
 };
 
+// a binary STL file decoded in to one array per column of the records; the
+// arrays are aligned to 64 bytes
+struct inSTLsoa_s {
+   char header[80];
+   unsigned int ntri;
+   float *normals;       // [ntri][3]
+   float *vertex1;       // [ntri][3]
+   float *vertex2;       // [ntri][3]
+   float *vertex3;       // [ntri][3]
+   unsigned short *attributes;
+};
+
+// indexed mesh of a welded triangle soup; vertices are numbered in the order
+// of their first appearance (triangle by triangle) and take the coordinates
+// of that appearance
+struct inSTLmesh_s {
+   unsigned int nvert;
+   unsigned int ntri;
+   float *vertices;      // [nvert][3]
+   unsigned int *tris;   // [ntri][3] zero-based vertex indices
+};
+
+// a batch of triangles handed over by inSTL_StreamSTL(); "first" is the
+// index of its first triangle in the file, and the array is only valid
+// during the call
+struct inSTLbatch_s {
+   unsigned long first;
+   unsigned int ntri;
+   const struct inSTLtri_s *triangles;
+};
+
+// consumer of batches; a non-zero return stops the reading
+typedef int (*inSTLbatchFn)( const struct inSTLbatch_s *b, void *user );
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void inSTL_InitSTLfile( struct inSTL_s *sp );
+
+int inSTL_ProbeSTLfile( char *filename, int *itype );
+
+int inSTL_ReadBinarySTL( char *filename, struct inSTL_s *sp, size_t isize );
+
+int inSTL_ReadBinarySTLSlice( char *filename, struct inSTL_s *sp, size_t isize,
+                              int islice, int nslice );
+
+int inSTL_ReadBinarySTLSoA( char *filename, struct inSTLsoa_s *sp,
+                            int nthreads );
+
+void inSTL_FreeSTLsoa( struct inSTLsoa_s *sp );
+
+int inSTL_ReadAsciiSTL( char *filename, struct inSTL_s *sp );
+
+int inSTL_ReadAsciiSTLParallel( char *filename, struct inSTL_s *sp,
+                                int nthreads );
+
+int inSTL_ReadAsciiSTLSlice( char *filename, struct inSTL_s *sp,
+                             int islice, int nslice );
+
+int inSTL_StreamSTL( char *filename, unsigned int nbatch,
+                     inSTLbatchFn fn, void *user, struct inSTL_s *sp );
+
+int inSTL_DumpAsciiSTL( char *filename, struct inSTL_s *sp );
+
+int inSTL_DumpAsciiSTLExact( char *filename, struct inSTL_s *sp,
+                             int nthreads );
+
+int inSTL_DumpBinarySTL( char *filename, struct inSTL_s *sp, int nthreads );
+
+int inSTL_DumpAsciiSTLTecplot( char *filename, struct inSTL_s *sp );
+
+int inSTL_DumpSTLTecplotBinary( char *filename, struct inSTL_s *sp );
+
+int inSTL_WeldSTL( struct inSTL_s *sp, struct inSTLmesh_s *mp,
+                   float eps, int nthreads );
+
+void inSTL_FreeMesh( struct inSTLmesh_s *mp );
+
+int inSTL_DumpMeshTecplot( char *filename, struct inSTLmesh_s *mp );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif